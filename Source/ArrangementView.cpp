@@ -22,6 +22,7 @@ ArrangementView::ArrangementView()
         editingTrack = -1;
         suppressInlineCommit = false;
     };
+    addAndMakeVisible(playheadOverlay);
 }
 
 void ArrangementView::setTracks(const juce::Array<Track>* tracksIn, double sampleRateIn)
@@ -60,7 +61,50 @@ void ArrangementView::setSelectedClip(int trackIndexIn, int clipIndexIn)
 
 void ArrangementView::setPlayheadSample(int64 playheadIn)
 {
-    playheadSample = juce::jmax<int64>(0, playheadIn);
+    playheadIn = juce::jmax<int64>(0, playheadIn);
+    if (playheadIn == playheadSample)
+        return;
+
+    if (tracks == nullptr)
+    {
+        playheadSample = playheadIn;
+        return;
+    }
+
+    // Called at the UI refresh rate while playing: only the strips each playhead leaves and
+    // enters are repainted, plus the bar:beat readout of focused tracks.
+    juce::Array<juce::Rectangle<int>> oldStrips;
+    for (int i = 0; i < tracks->size(); ++i)
+        oldStrips.add(getPlayheadStripBounds(i));
+
+    playheadSample = playheadIn;
+
+    for (int i = 0; i < tracks->size(); ++i)
+    {
+        const auto newStrip = getPlayheadStripBounds(i);
+        if (newStrip != oldStrips.getReference(i))
+        {
+            playheadOverlay.repaint(oldStrips.getReference(i));
+            playheadOverlay.repaint(newStrip);
+        }
+        if (isTrackFocused(i))
+            repaint(getPlayheadReadoutBounds(i));
+    }
+}
+
+void ArrangementView::setSamplesLoading(bool isLoading)
+{
+    if (samplesLoading == isLoading)
+        return;
+    samplesLoading = isLoading;
+    if (!samplesLoading)
+        pendingPeaks.clear();
+    repaint();
+}
+
+void ArrangementView::setPendingPeaks(const juce::String& sourceFilePath, std::shared_ptr<const SamplePeaks> peaks)
+{
+    pendingPeaks[sourceFilePath] = std::move(peaks);
     repaint();
 }
 
@@ -237,6 +281,48 @@ int64 ArrangementView::getClipPlaybackLengthSamples(const Track& track, const Tr
     return track.getClipPlaybackLengthSamples(clip, sampleRate);
 }
 
+int64 ArrangementView::chooseSubdivisionStep(int trackIndex, int64 beatSamples) const
+{
+    int64 step = juce::jmax<int64>(1, beatSamples / 8); // start at 32nd-note style density
+    const int x0 = sampleToXForTrack(trackIndex, 0);
+    while (step < beatSamples)
+    {
+        const int x1 = sampleToXForTrack(trackIndex, step);
+        if (x1 - x0 >= 9)
+            break;
+        step *= 2;
+    }
+    return juce::jmax<int64>(1, step);
+}
+
+int64 ArrangementView::getTrackPlayheadSample(int trackIndex) const
+{
+    if (tracks == nullptr || trackIndex < 0 || trackIndex >= tracks->size())
+        return 0;
+
+    // The transport runs at the 120 BPM reference tempo; each track scales it to its own.
+    const auto& t = tracks->getReference(trackIndex);
+    const double tempoFactor = (t.getTempoBpm() / 120.0) * (4.0 / (double)t.getTimeSigDenominator());
+    const int64 trackPlayheadRaw = juce::jmax<int64>(0, (int64)std::llround((double)playheadSample * tempoFactor));
+    return t.mapTransportSampleToTrackSample(trackPlayheadRaw);
+}
+
+juce::Rectangle<int> ArrangementView::getPlayheadStripBounds(int trackIndex) const
+{
+    if (tracks == nullptr || trackIndex < 0 || trackIndex >= tracks->size())
+        return {};
+
+    const int playX = sampleToXForTrack(trackIndex, getTrackPlayheadSample(trackIndex));
+    if (playX < getTimelineStartX() || playX > getWidth())
+        return {};
+    return { playX - 3, getTrackTop(trackIndex), 7, getTrackHeight(trackIndex) };
+}
+
+juce::Rectangle<int> ArrangementView::getPlayheadReadoutBounds(int trackIndex) const
+{
+    return getTrackHeaderBounds(trackIndex).removeFromBottom(14);
+}
+
 juce::Rectangle<int> ArrangementView::getClipRect(int trackIndex, int clipIndex) const
 {
     if (tracks == nullptr || trackIndex < 0 || trackIndex >= tracks->size())
@@ -581,6 +667,11 @@ bool ArrangementView::isTrackSelected(int trackIndex) const
     return selectedTracks.contains(trackIndex);
 }
 
+bool ArrangementView::isTrackFocused(int trackIndex) const
+{
+    return isTrackSelected(trackIndex) || (selectionType == SelectionType::clip && selectedTrack == trackIndex);
+}
+
 bool ArrangementView::isClipSelected(int trackIndex, int clipIndex) const
 {
     return findClipSelectionIndex(trackIndex, clipIndex) >= 0;
@@ -723,21 +814,8 @@ void ArrangementView::paint(juce::Graphics& g)
     if (tracks == nullptr)
         return;
 
+    removeStaleImages();
     const int trackCount = tracks->size();
-    constexpr double referenceTempoBpm = 120.0;
-    auto chooseSubdivisionStep = [this](int trackIndex, int64 beatSamples) -> int64
-    {
-        int64 step = juce::jmax<int64>(1, beatSamples / 8); // start at 32nd-note style density
-        const int x0 = sampleToXForTrack(trackIndex, 0);
-        while (step < beatSamples)
-        {
-            const int x1 = sampleToXForTrack(trackIndex, step);
-            if (x1 - x0 >= 9)
-                break;
-            step *= 2;
-        }
-        return juce::jmax<int64>(1, step);
-    };
     const int timelineStartXGlobal = getTimelineStartX();
     const int divider0 = getDividerX(0);
     const int divider1 = getDividerX(1);
@@ -791,13 +869,11 @@ void ArrangementView::paint(juce::Graphics& g)
     for (int i = 0; i < trackCount; ++i)
     {
         const auto& track = tracks->getReference(i);
-        const bool focusedTrack = isTrackSelected(i) || (selectionType == SelectionType::clip && selectedTrack == i);
+        const bool focusedTrack = isTrackFocused(i);
         const int y = getTrackTop(i);
         const int h = getTrackHeight(i);
-
-        const double tempoFactor = (track.getTempoBpm() / referenceTempoBpm) * (4.0 / (double)track.getTimeSigDenominator());
-        const int64 trackPlayheadRaw = juce::jmax<int64>(0, (int64)std::llround((double)playheadSample * tempoFactor));
-        const int64 trackPlayheadSample = track.mapTransportSampleToTrackSample(trackPlayheadRaw);
+        if (!g.clipRegionIntersects(juce::Rectangle<int>(0, y, width, h)))
+            continue;
 
         auto headerRect = getTrackHeaderBounds(i);
         const int timelineStartX = getTimelineStartX();
@@ -833,48 +909,87 @@ void ArrangementView::paint(juce::Graphics& g)
             g.fillRect(fullRow.reduced(2, 2));
         }
 
-        auto nameRect = getNameFieldBounds(i);
-        auto tempoRect = getTempoFieldBounds(i);
-        auto numRect = getTimeSigNumFieldBounds(i);
-        auto denRect = getTimeSigDenFieldBounds(i);
-        auto automationButtonRect = getAutomationToggleBounds(i);
-        g.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.12f : 0.10f));
-        g.drawRoundedRectangle(nameRect.toFloat(), 4.0f, 1.0f);
-        g.drawRoundedRectangle(tempoRect.toFloat(), 4.0f, 1.0f);
-        g.drawRoundedRectangle(numRect.toFloat(), 4.0f, 1.0f);
-        g.drawRoundedRectangle(denRect.toFloat(), 4.0f, 1.0f);
-        g.drawRoundedRectangle(automationButtonRect.toFloat(), 4.0f, 1.0f);
-
-        g.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.88f : 0.75f));
-        g.drawText(track.getName(), nameRect.reduced(6, 0), juce::Justification::centredLeft, true);
-        g.drawText(juce::String(track.getTempoBpm(), 1), tempoRect, juce::Justification::centred, false);
-        g.drawText(juce::String(track.getTimeSigNumerator()), numRect, juce::Justification::centred, false);
-        g.drawText(juce::String(track.getTimeSigDenominator()), denRect, juce::Justification::centred, false);
-        g.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.6f : 0.45f));
-        g.drawText("/", numRect.getRight(), numRect.getY(), denRect.getX() - numRect.getRight(), numRect.getHeight(), juce::Justification::centred, false);
-        g.setColour(juce::Colours::white.withAlpha(0.75f));
-        g.drawText((i < automationExpanded.size() && automationExpanded.getUnchecked(i)) ? "A-" : "A+",
-                   automationButtonRect, juce::Justification::centred, false);
-
-        const int64 beatSamples = track.getBeatLengthSamples(sampleRate);
-        int bar = 1;
-        int beat = 1;
-        int step = 1;
-        if (beatSamples > 0)
-        {
-            const int64 totalBeats = trackPlayheadSample / beatSamples;
-            bar = (int)(totalBeats / juce::jmax(1, track.getTimeSigNumerator())) + 1;
-            beat = (int)(totalBeats % juce::jmax(1, track.getTimeSigNumerator())) + 1;
-            const int64 beatOffsetSamples = trackPlayheadSample % beatSamples;
-            step = (int)((beatOffsetSamples * 4) / juce::jmax<int64>(1, beatSamples)) + 1;
-            step = juce::jlimit(1, 4, step);
-        }
-        if (focusedTrack)
+        // Header and mixer controls; skipped when only the timeline needs repainting.
+        if (g.clipRegionIntersects(juce::Rectangle<int>(0, y, timelineStartX, h)))
         {
-            g.drawText(juce::String(bar) + ":" + juce::String(beat) + ":" + juce::String(step),
-                       headerRect.removeFromBottom(14).reduced(8, 0),
-                       juce::Justification::centredRight,
-                       false);
+            auto nameRect = getNameFieldBounds(i);
+            auto tempoRect = getTempoFieldBounds(i);
+            auto numRect = getTimeSigNumFieldBounds(i);
+            auto denRect = getTimeSigDenFieldBounds(i);
+            auto automationButtonRect = getAutomationToggleBounds(i);
+            g.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.12f : 0.10f));
+            g.drawRoundedRectangle(nameRect.toFloat(), 4.0f, 1.0f);
+            g.drawRoundedRectangle(tempoRect.toFloat(), 4.0f, 1.0f);
+            g.drawRoundedRectangle(numRect.toFloat(), 4.0f, 1.0f);
+            g.drawRoundedRectangle(denRect.toFloat(), 4.0f, 1.0f);
+            g.drawRoundedRectangle(automationButtonRect.toFloat(), 4.0f, 1.0f);
+
+            g.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.88f : 0.75f));
+            g.drawText(track.getName(), nameRect.reduced(6, 0), juce::Justification::centredLeft, true);
+            g.drawText(juce::String(track.getTempoBpm(), 1), tempoRect, juce::Justification::centred, false);
+            g.drawText(juce::String(track.getTimeSigNumerator()), numRect, juce::Justification::centred, false);
+            g.drawText(juce::String(track.getTimeSigDenominator()), denRect, juce::Justification::centred, false);
+            g.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.6f : 0.45f));
+            g.drawText("/", numRect.getRight(), numRect.getY(), denRect.getX() - numRect.getRight(), numRect.getHeight(), juce::Justification::centred, false);
+            g.setColour(juce::Colours::white.withAlpha(0.75f));
+            g.drawText((i < automationExpanded.size() && automationExpanded.getUnchecked(i)) ? "A-" : "A+",
+                       automationButtonRect, juce::Justification::centred, false);
+
+            const int64 trackPlayheadSample = getTrackPlayheadSample(i);
+            const int64 beatSamples = track.getBeatLengthSamples(sampleRate);
+            int bar = 1;
+            int beat = 1;
+            int step = 1;
+            if (beatSamples > 0)
+            {
+                const int64 totalBeats = trackPlayheadSample / beatSamples;
+                bar = (int)(totalBeats / juce::jmax(1, track.getTimeSigNumerator())) + 1;
+                beat = (int)(totalBeats % juce::jmax(1, track.getTimeSigNumerator())) + 1;
+                const int64 beatOffsetSamples = trackPlayheadSample % beatSamples;
+                step = (int)((beatOffsetSamples * 4) / juce::jmax<int64>(1, beatSamples)) + 1;
+                step = juce::jlimit(1, 4, step);
+            }
+            if (focusedTrack)
+            {
+                g.drawText(juce::String(bar) + ":" + juce::String(beat) + ":" + juce::String(step),
+                           headerRect.removeFromBottom(14).reduced(8, 0),
+                           juce::Justification::centredRight,
+                           false);
+            }
+
+            g.setColour(juce::Colours::white.withAlpha(0.40f));
+            g.drawText("MIX", getMixPadBounds(i).getX(), getMixPadBounds(i).getY() - 10, getMixPadBounds(i).getWidth(), 10, juce::Justification::centred, false);
+
+            const auto mixPad = getMixPadBounds(i);
+            juce::ColourGradient mixGrad(juce::Colour(60, 63, 72), (float)mixPad.getX(), (float)mixPad.getY(),
+                                         juce::Colour(46, 49, 57), (float)mixPad.getRight(), (float)mixPad.getBottom(), false);
+            g.setGradientFill(mixGrad);
+            g.fillRoundedRectangle(mixPad.toFloat(), 4.0f);
+            g.setColour(juce::Colours::white.withAlpha(0.16f));
+            g.drawRoundedRectangle(mixPad.toFloat(), 4.0f, 1.0f);
+            g.setColour(juce::Colours::white.withAlpha(0.10f));
+            g.drawLine((float)mixPad.getCentreX(), (float)mixPad.getY(), (float)mixPad.getCentreX(), (float)mixPad.getBottom(), 1.0f);
+            g.drawLine((float)mixPad.getX(), (float)mixPad.getCentreY(), (float)mixPad.getRight(), (float)mixPad.getCentreY(), 1.0f);
+
+            const float panNorm = (float)juce::jmap(track.getPan(), -1.0, 1.0, 0.0, 1.0);
+            const float volNorm = (float)juce::jmap(track.getVolume(), 0.0, 2.0, 0.0, 1.0);
+            const float knobX = mixPad.getX() + panNorm * (float)mixPad.getWidth();
+            const float knobY = mixPad.getBottom() - volNorm * (float)mixPad.getHeight();
+            g.setColour(juce::Colour(210, 230, 255).withAlpha(0.95f));
+            g.fillEllipse(knobX - 4.0f, knobY - 4.0f, 8.0f, 8.0f);
+
+            const auto zoomPad = getZoomPadBounds(i);
+            g.setColour(juce::Colour(18, 20, 24).withAlpha(0.85f));
+            g.fillRoundedRectangle(zoomPad.toFloat(), 3.0f);
+            g.setColour(juce::Colours::white.withAlpha(0.24f));
+            g.drawRoundedRectangle(zoomPad.toFloat(), 3.0f, 1.0f);
+            const float zoomXNorm = (float)juce::jmap(track.getZoomX(), 0.25, 8.0, 0.0, 1.0);
+            const float zoomKnobX = zoomPad.getX() + zoomXNorm * (float)zoomPad.getWidth();
+            const float zoomKnobY = (float)zoomPad.getCentreY();
+            g.setColour(juce::Colour(220, 228, 240).withAlpha(0.95f));
+            g.fillEllipse(zoomKnobX - 5.0f, zoomKnobY - 5.0f, 10.0f, 10.0f);
+            g.setColour(juce::Colours::white.withAlpha(0.55f));
+            g.drawText("ZOOM X", zoomPad.getX() - 52, zoomPad.getY() - 1, 48, zoomPad.getHeight() + 2, juce::Justification::centredRight, false);
         }
 
         if ((i % 2) == 1)
@@ -882,75 +997,10 @@ void ArrangementView::paint(juce::Graphics& g)
             g.setColour(juce::Colour(255, 255, 255).withAlpha(0.02f));
             g.fillRect(timelineRect);
         }
-        g.setColour(juce::Colours::white.withAlpha(0.40f));
-        g.drawText("MIX", getMixPadBounds(i).getX(), getMixPadBounds(i).getY() - 10, getMixPadBounds(i).getWidth(), 10, juce::Justification::centred, false);
-
-        const auto mixPad = getMixPadBounds(i);
-        juce::ColourGradient mixGrad(juce::Colour(60, 63, 72), (float)mixPad.getX(), (float)mixPad.getY(),
-                                     juce::Colour(46, 49, 57), (float)mixPad.getRight(), (float)mixPad.getBottom(), false);
-        g.setGradientFill(mixGrad);
-        g.fillRoundedRectangle(mixPad.toFloat(), 4.0f);
-        g.setColour(juce::Colours::white.withAlpha(0.16f));
-        g.drawRoundedRectangle(mixPad.toFloat(), 4.0f, 1.0f);
-        g.setColour(juce::Colours::white.withAlpha(0.10f));
-        g.drawLine((float)mixPad.getCentreX(), (float)mixPad.getY(), (float)mixPad.getCentreX(), (float)mixPad.getBottom(), 1.0f);
-        g.drawLine((float)mixPad.getX(), (float)mixPad.getCentreY(), (float)mixPad.getRight(), (float)mixPad.getCentreY(), 1.0f);
-
-        const float panNorm = (float)juce::jmap(track.getPan(), -1.0, 1.0, 0.0, 1.0);
-        const float volNorm = (float)juce::jmap(track.getVolume(), 0.0, 2.0, 0.0, 1.0);
-        const float knobX = mixPad.getX() + panNorm * (float)mixPad.getWidth();
-        const float knobY = mixPad.getBottom() - volNorm * (float)mixPad.getHeight();
-        g.setColour(juce::Colour(210, 230, 255).withAlpha(0.95f));
-        g.fillEllipse(knobX - 4.0f, knobY - 4.0f, 8.0f, 8.0f);
-
-        const auto zoomPad = getZoomPadBounds(i);
-        g.setColour(juce::Colour(18, 20, 24).withAlpha(0.85f));
-        g.fillRoundedRectangle(zoomPad.toFloat(), 3.0f);
-        g.setColour(juce::Colours::white.withAlpha(0.24f));
-        g.drawRoundedRectangle(zoomPad.toFloat(), 3.0f, 1.0f);
-        const float zoomXNorm = (float)juce::jmap(track.getZoomX(), 0.25, 8.0, 0.0, 1.0);
-        const float zoomKnobX = zoomPad.getX() + zoomXNorm * (float)zoomPad.getWidth();
-        const float zoomKnobY = (float)zoomPad.getCentreY();
-        g.setColour(juce::Colour(220, 228, 240).withAlpha(0.95f));
-        g.fillEllipse(zoomKnobX - 5.0f, zoomKnobY - 5.0f, 10.0f, 10.0f);
-        g.setColour(juce::Colours::white.withAlpha(0.55f));
-        g.drawText("ZOOM X", zoomPad.getX() - 52, zoomPad.getY() - 1, 48, zoomPad.getHeight() + 2, juce::Justification::centredRight, false);
-
-        const int64 maxVisibleSamples = xToSampleForTrack(i, (float)width);
-        const int64 barSamples = track.getBarLengthSamples(sampleRate);
-        if (beatSamples > 0 && barSamples > 0)
-        {
-            const int64 subStep = chooseSubdivisionStep(i, beatSamples);
-            for (int64 gridSample = 0; gridSample <= maxVisibleSamples; gridSample += subStep)
-            {
-                const int x = sampleToXForTrack(i, gridSample);
-                const bool isBarLine = (gridSample % barSamples) == 0;
-                const bool isBeatLine = (gridSample % beatSamples) == 0;
-                if (isBarLine)
-                {
-                    g.setColour(juce::Colours::white.withAlpha(0.32f));
-                    g.drawLine((float)x, (float)(y + 1), (float)x, (float)(y + h - 2), 1.3f);
-                }
-                else if (isBeatLine)
-                {
-                    g.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.18f : 0.12f));
-                    g.drawLine((float)x, (float)(y + 1), (float)x, (float)(y + h - 2), 1.0f);
-                }
-                else if (focusedTrack)
-                {
-                    g.setColour(juce::Colours::white.withAlpha(0.08f));
-                    g.drawLine((float)x, (float)(y + 1), (float)x, (float)(y + h - 2), 1.0f);
-                }
-            }
-        }
 
-        const int playX = sampleToXForTrack(i, trackPlayheadSample);
+        drawLaneGrid(g, i, focusedTrack);
+
         const int timelineRightX = width;
-        if (playX >= timelineStartX && playX <= timelineRightX)
-        {
-            g.setColour(juce::Colour(250, 252, 255).withAlpha(0.92f));
-            g.drawLine((float)playX, (float)(y + 2), (float)playX, (float)(y + h - 3), 2.0f);
-        }
 
         if (track.hasLoopMarker(0))
         {
@@ -1062,75 +1112,21 @@ void ArrangementView::paint(juce::Graphics& g)
         {
             const auto& clip = clips.getReference(c);
             const auto clipRectI = getClipRect(i, c);
+            // The value popups drawn while dragging can stick out past the clip's sides.
+            if (!g.clipRegionIntersects(clipRectI.expanded(64, 0)))
+                continue;
             const int x = clipRectI.getX();
             const int w = clipRectI.getWidth();
             const juce::Rectangle<float> clipRect = clipRectI.toFloat();
 
-            juce::ColourGradient clipGrad(juce::Colour(93, 170, 132), clipRect.getX(), clipRect.getY(),
-                                          juce::Colour(56, 118, 89), clipRect.getX(), clipRect.getBottom(), false);
-            g.setGradientFill(clipGrad);
-            g.fillRoundedRectangle(clipRect, 5.0f);
-            g.setColour(juce::Colour(255, 255, 255).withAlpha(0.20f));
-            g.drawRoundedRectangle(clipRect, 5.0f, 1.0f);
+            drawClipBody(g, i, c, clipRectI);
 
-            // Draw waveform preview inside clip.
-            if (clip.sample != nullptr && clip.sample->getNumSamples() > 0 && clipRect.getWidth() > 12.0f && clipRect.getHeight() > 16.0f)
+            if (clip.sample == nullptr && clipRect.getWidth() > 24.0f)
             {
-                const auto waveRect = clipRect.reduced(3.0f, 3.0f);
-                const int waveW = juce::jmax(1, (int)waveRect.getWidth());
-                const float midY = waveRect.getCentreY();
-                const float maxHalf = waveRect.getHeight() * 0.49f;
-                const int sampleChannels = juce::jmax(1, clip.sample->getNumChannels());
-
-                juce::Graphics::ScopedSaveState ss(g);
-                g.reduceClipRegion(waveRect.toNearestInt());
-                g.setColour(juce::Colours::white.withAlpha(0.14f));
-                g.drawLine(waveRect.getX(), midY, waveRect.getRight(), midY, 1.0f);
-
-                const double srcStart = juce::jlimit(0.0, 1.0, (double)clip.sourceStartNorm);
-                const double srcEnd = juce::jlimit(srcStart, 1.0, (double)clip.sourceEndNorm);
-                const int analysisSteps = 256;
-                float analysisPeak = 0.001f;
-                for (int a = 0; a < analysisSteps; ++a)
-                {
-                    const double n = (double)a / (double)juce::jmax(1, analysisSteps - 1);
-                    const double srcNorm = juce::jmap(n, srcStart, srcEnd);
-                    const double samplePos = srcNorm * (double)(clip.sample->getNumSamples() - 1);
-                    float v = 0.0f;
-                    for (int ch = 0; ch < sampleChannels; ++ch)
-                        v = juce::jmax(v, std::abs(clip.sample->getSampleAt(ch, samplePos)));
-                    analysisPeak = juce::jmax(analysisPeak, v);
-                }
-                const float previewGain = juce::jlimit(1.0f, 8.0f, 0.95f / analysisPeak);
-
-                g.setColour(juce::Colours::white.withAlpha(0.48f));
-                for (int px = 0; px < waveW; ++px)
-                {
-                    const double n = (double)px / (double)juce::jmax(1, waveW - 1);
-                    const double srcNorm = juce::jmap(n, srcStart, srcEnd);
-                    const double samplePos = srcNorm * (double)(clip.sample->getNumSamples() - 1);
-                    float s = 0.0f;
-                    for (int ch = 0; ch < sampleChannels; ++ch)
-                        s = juce::jmax(s, std::abs(clip.sample->getSampleAt(ch, samplePos)));
-                    const float amp = juce::jlimit(0.0f, maxHalf, s * previewGain * maxHalf);
-                    const float drawX = waveRect.getX() + (float)px;
-                    g.drawLine(drawX, midY - amp, drawX, midY + amp);
-                }
-
-                // Draw beat-slice boundaries if present.
-                if (!clip.slicing.slices.isEmpty())
-                {
-                    g.setColour(juce::Colour(255, 220, 130).withAlpha(0.85f));
-                    const double srcRange = juce::jmax(0.000001, srcEnd - srcStart);
-                    for (int s = 1; s < clip.slicing.slices.size(); ++s)
-                    {
-                        const auto& slice = clip.slicing.slices.getReference(s);
-                        const double clipNorm = juce::jlimit(0.0, 1.0, slice.startNorm);
-                        const double viewNorm = juce::jlimit(0.0, 1.0, (clipNorm - srcStart) / srcRange);
-                        const float sx = waveRect.getX() + (float)viewNorm * waveRect.getWidth();
-                        g.drawLine(sx, waveRect.getY(), sx, waveRect.getBottom(), 1.6f);
-                    }
-                }
+                g.setColour(juce::Colours::white.withAlpha(0.62f));
+                g.setFont(juce::FontOptions(11.0f));
+                g.drawText(samplesLoading ? "Loading..." : "Not loaded", clipRect.reduced(6.0f, 3.0f),
+                           juce::Justification::centred, true);
             }
 
             const float fadeInPx = clipRect.getWidth() * juce::jlimit(0.0f, 0.98f, clip.fadeInNorm);
@@ -1262,6 +1258,231 @@ void ArrangementView::paint(juce::Graphics& g)
     }
 }
 
+void ArrangementView::drawClipBody(juce::Graphics& g, int trackIndex, int clipIndex, const juce::Rectangle<int>& clipBounds)
+{
+    const auto& clip = tracks->getReference(trackIndex).getClips().getReference(clipIndex);
+    std::shared_ptr<const SamplePeaks> pending;
+    if (clip.sample == nullptr)
+    {
+        const auto found = pendingPeaks.find(clip.sourceFilePath);
+        if (found != pendingPeaks.end())
+            pending = found->second;
+    }
+
+    juce::Array<double> sliceStarts;
+    for (const auto& slice : clip.slicing.slices)
+        sliceStarts.add(slice.startNorm);
+
+    auto sameObject = [](const auto& weak, const auto& shared)
+    {
+        return !weak.owner_before(shared) && !shared.owner_before(weak);
+    };
+
+    const float scale = juce::jmax(1.0f, g.getInternalContext().getPhysicalPixelScaleFactor());
+    auto& cached = clipImages[{ trackIndex, clipIndex }];
+    if (!cached.image.isValid()
+        || !sameObject(cached.sample, clip.sample)
+        || !sameObject(cached.peaks, pending)
+        || cached.sourceStartNorm != clip.sourceStartNorm
+        || cached.sourceEndNorm != clip.sourceEndNorm
+        || cached.sliceStarts != sliceStarts
+        || cached.width != clipBounds.getWidth()
+        || cached.height != clipBounds.getHeight()
+        || cached.scale != scale)
+    {
+        cached.sample = clip.sample;
+        cached.peaks = pending;
+        cached.sourceStartNorm = clip.sourceStartNorm;
+        cached.sourceEndNorm = clip.sourceEndNorm;
+        cached.sliceStarts = sliceStarts;
+        cached.width = clipBounds.getWidth();
+        cached.height = clipBounds.getHeight();
+        cached.scale = scale;
+        cached.image = juce::Image(juce::Image::ARGB,
+                                   juce::jmax(1, juce::roundToInt((float)cached.width * scale)),
+                                   juce::jmax(1, juce::roundToInt((float)cached.height * scale)),
+                                   true);
+
+        // Drawn in view coordinates, so the image matches what painting directly would give.
+        juce::Graphics ig(cached.image);
+        ig.addTransform(juce::AffineTransform::translation((float)-clipBounds.getX(), (float)-clipBounds.getY()).scaled(scale));
+        const juce::Rectangle<float> clipRect = clipBounds.toFloat();
+
+        juce::ColourGradient clipGrad(juce::Colour(93, 170, 132), clipRect.getX(), clipRect.getY(),
+                                      juce::Colour(56, 118, 89), clipRect.getX(), clipRect.getBottom(), false);
+        ig.setGradientFill(clipGrad);
+        ig.fillRoundedRectangle(clipRect, 5.0f);
+        ig.setColour(juce::Colour(255, 255, 255).withAlpha(0.20f));
+        ig.drawRoundedRectangle(clipRect, 5.0f, 1.0f);
+
+        // Draw waveform preview inside clip; clips still loading use cached peaks if any.
+        const SamplePeaks* cachedPeaks = pending.get();
+        const int64 sourceLength = clip.sample != nullptr ? clip.sample->getNumSamples()
+                                                          : (cachedPeaks != nullptr ? cachedPeaks->getNumSamples() : 0);
+        if (sourceLength > 0 && clipRect.getWidth() > 12.0f && clipRect.getHeight() > 16.0f)
+        {
+            const auto waveRect = clipRect.reduced(3.0f, 3.0f);
+            const int waveW = juce::jmax(1, (int)waveRect.getWidth());
+            const float midY = waveRect.getCentreY();
+            const float maxHalf = waveRect.getHeight() * 0.49f;
+            const int sampleChannels = juce::jmax(1, clip.sample != nullptr ? clip.sample->getNumChannels() : cachedPeaks->getNumChannels());
+            auto getPeak = [&](int ch, double start, double end)
+            {
+                if (clip.sample != nullptr)
+                    return clip.sample->getPeak(ch, start, end);
+                return cachedPeaks->getPeak(ch, (int64)start, (int64)std::ceil(end));
+            };
+
+            juce::Graphics::ScopedSaveState ss(ig);
+            ig.reduceClipRegion(waveRect.toNearestInt());
+            ig.setColour(juce::Colours::white.withAlpha(0.14f));
+            ig.drawLine(waveRect.getX(), midY, waveRect.getRight(), midY, 1.0f);
+
+            const double srcStart = juce::jlimit(0.0, 1.0, (double)clip.sourceStartNorm);
+            const double srcEnd = juce::jlimit(srcStart, 1.0, (double)clip.sourceEndNorm);
+            const double lastSample = (double)(sourceLength - 1);
+            const double firstSourceSample = srcStart * lastSample;
+            const double samplesPerPixel = (srcEnd - srcStart) * lastSample / (double)waveW;
+            float analysisPeak = 0.001f;
+            for (int ch = 0; ch < sampleChannels; ++ch)
+                analysisPeak = juce::jmax(analysisPeak, getPeak(ch, firstSourceSample, srcEnd * lastSample + 1.0).getMagnitude());
+            const float previewGain = juce::jlimit(1.0f, 8.0f, 0.95f / analysisPeak);
+
+            ig.setColour(juce::Colours::white.withAlpha(clip.sample != nullptr ? 0.48f : 0.26f));
+            for (int px = 0; px < waveW; ++px)
+            {
+                const double pixelStart = firstSourceSample + (double)px * samplesPerPixel;
+                float s = 0.0f;
+                for (int ch = 0; ch < sampleChannels; ++ch)
+                    s = juce::jmax(s, getPeak(ch, pixelStart, pixelStart + samplesPerPixel).getMagnitude());
+                const float amp = juce::jlimit(0.0f, maxHalf, s * previewGain * maxHalf);
+                const float drawX = waveRect.getX() + (float)px;
+                ig.drawLine(drawX, midY - amp, drawX, midY + amp);
+            }
+
+            // Draw beat-slice boundaries if present.
+            if (!clip.slicing.slices.isEmpty())
+            {
+                ig.setColour(juce::Colour(255, 220, 130).withAlpha(0.85f));
+                const double srcRange = juce::jmax(0.000001, srcEnd - srcStart);
+                for (int s = 1; s < clip.slicing.slices.size(); ++s)
+                {
+                    const auto& slice = clip.slicing.slices.getReference(s);
+                    const double clipNorm = juce::jlimit(0.0, 1.0, slice.startNorm);
+                    const double viewNorm = juce::jlimit(0.0, 1.0, (clipNorm - srcStart) / srcRange);
+                    const float sx = waveRect.getX() + (float)viewNorm * waveRect.getWidth();
+                    ig.drawLine(sx, waveRect.getY(), sx, waveRect.getBottom(), 1.6f);
+                }
+            }
+        }
+    }
+
+    g.setOpacity(1.0f);
+    g.drawImage(cached.image, clipBounds.toFloat());
+}
+
+void ArrangementView::drawLaneGrid(juce::Graphics& g, int trackIndex, bool focusedTrack)
+{
+    const auto& track = tracks->getReference(trackIndex);
+    const int64 beatSamples = track.getBeatLengthSamples(sampleRate);
+    const int64 barSamples = track.getBarLengthSamples(sampleRate);
+    const int y = getTrackTop(trackIndex);
+    const int h = getTrackHeight(trackIndex);
+    // One pixel to the left of the timeline, for the antialiased edge of a line on its start.
+    const auto bounds = juce::Rectangle<int>(getTimelineStartX() - 1, y, getWidth() - getTimelineStartX() + 1, h);
+    if (beatSamples <= 0 || barSamples <= 0 || bounds.isEmpty())
+        return;
+
+    const float scale = juce::jmax(1.0f, g.getInternalContext().getPhysicalPixelScaleFactor());
+    const double pixelsPerSample = track.getZoomX() / (secondsPerPixel * sampleRate);
+    if ((int)laneImages.size() <= trackIndex)
+        laneImages.resize((size_t)trackIndex + 1);
+
+    auto& cached = laneImages[(size_t)trackIndex];
+    if (!cached.image.isValid()
+        || cached.width != bounds.getWidth()
+        || cached.height != bounds.getHeight()
+        || cached.pixelsPerSample != pixelsPerSample
+        || cached.beatSamples != beatSamples
+        || cached.barSamples != barSamples
+        || cached.focused != focusedTrack
+        || cached.scale != scale)
+    {
+        cached.width = bounds.getWidth();
+        cached.height = bounds.getHeight();
+        cached.pixelsPerSample = pixelsPerSample;
+        cached.beatSamples = beatSamples;
+        cached.barSamples = barSamples;
+        cached.focused = focusedTrack;
+        cached.scale = scale;
+        cached.image = juce::Image(juce::Image::ARGB,
+                                   juce::jmax(1, juce::roundToInt((float)cached.width * scale)),
+                                   juce::jmax(1, juce::roundToInt((float)cached.height * scale)),
+                                   true);
+
+        juce::Graphics ig(cached.image);
+        ig.addTransform(juce::AffineTransform::translation((float)-bounds.getX(), (float)-y).scaled(scale));
+        const int64 maxVisibleSamples = xToSampleForTrack(trackIndex, (float)getWidth());
+        const int64 subStep = chooseSubdivisionStep(trackIndex, beatSamples);
+        for (int64 gridSample = 0; gridSample <= maxVisibleSamples; gridSample += subStep)
+        {
+            const int x = sampleToXForTrack(trackIndex, gridSample);
+            const bool isBarLine = (gridSample % barSamples) == 0;
+            const bool isBeatLine = (gridSample % beatSamples) == 0;
+            if (isBarLine)
+            {
+                ig.setColour(juce::Colours::white.withAlpha(0.32f));
+                ig.drawLine((float)x, (float)(y + 1), (float)x, (float)(y + h - 2), 1.3f);
+            }
+            else if (isBeatLine)
+            {
+                ig.setColour(juce::Colours::white.withAlpha(focusedTrack ? 0.18f : 0.12f));
+                ig.drawLine((float)x, (float)(y + 1), (float)x, (float)(y + h - 2), 1.0f);
+            }
+            else if (focusedTrack)
+            {
+                ig.setColour(juce::Colours::white.withAlpha(0.08f));
+                ig.drawLine((float)x, (float)(y + 1), (float)x, (float)(y + h - 2), 1.0f);
+            }
+        }
+    }
+
+    g.setOpacity(1.0f);
+    g.drawImage(cached.image, bounds.toFloat());
+}
+
+void ArrangementView::removeStaleImages()
+{
+    for (auto it = clipImages.begin(); it != clipImages.end();)
+    {
+        const int trackIndex = it->first.first;
+        const int clipIndex = it->first.second;
+        if (trackIndex < tracks->size() && clipIndex < tracks->getReference(trackIndex).getClips().size())
+            ++it;
+        else
+            it = clipImages.erase(it);
+    }
+
+    if ((int)laneImages.size() > tracks->size())
+        laneImages.resize((size_t)tracks->size());
+}
+
+void ArrangementView::paintPlayheads(juce::Graphics& g)
+{
+    if (tracks == nullptr)
+        return;
+
+    g.setColour(juce::Colour(250, 252, 255).withAlpha(0.92f));
+    for (int i = 0; i < tracks->size(); ++i)
+    {
+        const auto strip = getPlayheadStripBounds(i);
+        if (strip.isEmpty() || !g.clipRegionIntersects(strip))
+            continue;
+        const float playX = (float)strip.getCentreX();
+        g.drawLine(playX, (float)(strip.getY() + 2), playX, (float)(strip.getBottom() - 3), 2.0f);
+    }
+}
+
 void ArrangementView::resized()
 {
     const int totalWidth = juce::jmax(1, getWidth());
@@ -1270,6 +1491,7 @@ void ArrangementView::resized()
     const int maxHeader = juce::jmax(minTrackHeaderWidth, totalWidth - trackControlsWidth - minTimelineWidth);
     trackHeaderWidth = juce::jlimit(minTrackHeaderWidth, maxHeader, trackHeaderWidth);
 
+    playheadOverlay.setBounds(getLocalBounds());
     layoutZoomSliders();
 
     if (!inlineEditor.isVisible())
@@ -1316,11 +1538,7 @@ void ArrangementView::mouseDown(const juce::MouseEvent& e)
 
         for (int i = 0; i < tracks->size(); ++i)
         {
-            const auto& t = tracks->getReference(i);
-            const double tempoFactor = (t.getTempoBpm() / 120.0) * (4.0 / (double)t.getTimeSigDenominator());
-            const int64 trackPlayheadRaw = juce::jmax<int64>(0, (int64)std::llround((double)playheadSample * tempoFactor));
-            const int64 trackPlayheadSample = t.mapTransportSampleToTrackSample(trackPlayheadRaw);
-            const int playX = sampleToXForTrack(i, trackPlayheadSample);
+            const int playX = sampleToXForTrack(i, getTrackPlayheadSample(i));
             const int y = getTrackTop(i);
             const int h = getTrackHeight(i);
             if ((int)e.position.y >= y && (int)e.position.y < y + h && std::abs((int)e.position.x - playX) <= 6)
@@ -2008,6 +2226,13 @@ bool ArrangementView::keyPressed(const juce::KeyPress& key)
 {
     const auto mods = key.getModifiers();
     const int kc = key.getKeyCode();
+    if (mods.isCommandDown() && ((mods.isShiftDown() && (kc == 'z' || kc == 'Z')) || kc == 'y' || kc == 'Y'))
+    {
+        if (redoRequested)
+            redoRequested();
+        return true;
+    }
+
     if (mods.isCommandDown() && (kc == 'z' || kc == 'Z'))
     {
         if (undoRequested)
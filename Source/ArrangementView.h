@@ -1,6 +1,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <map>
+#include <vector>
 #include "Track.h"
 
 class ArrangementView : public juce::Component
@@ -47,6 +49,7 @@ public:
     using TrackLoopMarkerEdited = std::function<void(int trackIndex, int markerIndex, int64 samplePosition, bool enabled)>;
     using TrackDeleteRequested = std::function<void(int trackIndex)>;
     using UndoRequested = std::function<void()>;
+    using RedoRequested = std::function<void()>;
     using CopyRequested = std::function<void()>;
     using PasteRequested = std::function<void()>;
     using PlayheadDragged = std::function<void(int64 samplePosition)>;
@@ -76,6 +79,7 @@ public:
     void onTrackLoopMarkerEdited(TrackLoopMarkerEdited cb) { trackLoopMarkerEdited = std::move(cb); }
     void onTrackDeleteRequested(TrackDeleteRequested cb) { trackDeleteRequested = std::move(cb); }
     void onUndoRequested(UndoRequested cb) { undoRequested = std::move(cb); }
+    void onRedoRequested(RedoRequested cb) { redoRequested = std::move(cb); }
     void onCopyRequested(CopyRequested cb) { copyRequested = std::move(cb); }
     void onPasteRequested(PasteRequested cb) { pasteRequested = std::move(cb); }
     void onPlayheadDragged(PlayheadDragged cb) { playheadDragged = std::move(cb); }
@@ -92,6 +96,10 @@ public:
     EditTool getEditTool() const { return editTool; }
     void setSelectedClip(int trackIndexIn, int clipIndexIn);
     void setPlayheadSample(int64 playheadIn);
+    // Clips without a sample are labelled as loading while this is set, as missing otherwise.
+    void setSamplesLoading(bool isLoading);
+    // Cached waveform drawn for clips of this file until their sample arrives.
+    void setPendingPeaks(const juce::String& sourceFilePath, std::shared_ptr<const SamplePeaks> peaks);
     void refreshTrackControls();
     int getRequiredContentHeight() const;
     SelectionType getSelectionType() const { return selectionType; }
@@ -117,6 +125,46 @@ private:
         timeSigDen
     };
 
+    // Draws the playheads above the rest of the view, so moving them only repaints the
+    // strips they leave and enter.
+    class PlayheadOverlay : public juce::Component
+    {
+    public:
+        explicit PlayheadOverlay(ArrangementView& ownerIn) : owner(ownerIn) { setInterceptsMouseClicks(false, false); }
+        void paint(juce::Graphics& g) override { owner.paintPlayheads(g); }
+
+    private:
+        ArrangementView& owner;
+    };
+
+    // A clip body (fill, outline, waveform, slice lines) rendered once and redrawn from the
+    // image until anything it was drawn from changes.
+    struct ClipImage
+    {
+        juce::Image image;
+        std::weak_ptr<const Sample> sample;
+        std::weak_ptr<const SamplePeaks> peaks;
+        float sourceStartNorm = 0.0f;
+        float sourceEndNorm = 1.0f;
+        juce::Array<double> sliceStarts;
+        int width = 0;
+        int height = 0;
+        float scale = 1.0f;
+    };
+
+    // The beat grid of one track's timeline lane.
+    struct LaneImage
+    {
+        juce::Image image;
+        int width = 0;
+        int height = 0;
+        double pixelsPerSample = 0.0;
+        int64 beatSamples = 0;
+        int64 barSamples = 0;
+        bool focused = false;
+        float scale = 1.0f;
+    };
+
     int yToTrackIndex(float y) const;
     int getTrackTop(int trackIndex) const;
     int getTrackHeight(int trackIndex) const;
@@ -132,6 +180,14 @@ private:
     juce::Rectangle<int> getClipLaneBounds(int trackIndex) const;
     juce::Rectangle<int> getAutomationLaneBounds(int trackIndex, bool volumeLane) const;
     int64 getClipPlaybackLengthSamples(const Track& track, const TrackClip& clip) const;
+    int64 chooseSubdivisionStep(int trackIndex, int64 beatSamples) const;
+    int64 getTrackPlayheadSample(int trackIndex) const;
+    juce::Rectangle<int> getPlayheadStripBounds(int trackIndex) const;
+    juce::Rectangle<int> getPlayheadReadoutBounds(int trackIndex) const;
+    void paintPlayheads(juce::Graphics& g);
+    void drawClipBody(juce::Graphics& g, int trackIndex, int clipIndex, const juce::Rectangle<int>& clipBounds);
+    void drawLaneGrid(juce::Graphics& g, int trackIndex, bool focusedTrack);
+    void removeStaleImages();
     juce::Rectangle<int> getClipRect(int trackIndex, int clipIndex) const;
     juce::Rectangle<int> getClipGainHandleBounds(const juce::Rectangle<int>& clipRect) const;
     juce::Rectangle<int> getClipFadeInHandleBounds(const juce::Rectangle<int>& clipRect) const;
@@ -161,6 +217,7 @@ private:
     void toggleClipSelection(int trackIndex, int clipIndex);
     void toggleMarkerSelection(int trackIndex, int markerIndex);
     bool isTrackSelected(int trackIndex) const;
+    bool isTrackFocused(int trackIndex) const;
     bool isClipSelected(int trackIndex, int clipIndex) const;
     bool isMarkerSelected(int trackIndex, int markerIndex) const;
     int findClipSelectionIndex(int trackIndex, int clipIndex) const;
@@ -205,6 +262,7 @@ private:
     TrackLoopMarkerEdited trackLoopMarkerEdited;
     TrackDeleteRequested trackDeleteRequested;
     UndoRequested undoRequested;
+    RedoRequested redoRequested;
     CopyRequested copyRequested;
     PasteRequested pasteRequested;
     PlayheadDragged playheadDragged;
@@ -263,4 +321,9 @@ private:
     int editingTrack = -1;
     bool suppressInlineCommit = false;
     bool suppressZoomSliderCallbacks = false;
+    bool samplesLoading = false;
+    std::map<juce::String, std::shared_ptr<const SamplePeaks>> pendingPeaks;
+    std::map<std::pair<int, int>, ClipImage> clipImages; // keyed by track and clip index
+    std::vector<LaneImage> laneImages;
+    PlayheadOverlay playheadOverlay { *this };
 };
@@ -1,10 +1,52 @@
 #include "AudioEngine.h"
-#include <vector>
 
-void AudioEngine::prepare(double sampleRateIn, int)
+namespace
+{
+constexpr int snapshotChannels = 2;
+}
+
+struct AudioEngine::TrackRenderJob : public RenderWorkerPool::Job
+{
+    TrackRenderJob(TrackSnapshot& snapshotIn, int64 bufferStartIn, int numChannelsIn, int numSamplesIn, double sampleRateIn)
+        : snapshot(snapshotIn), bufferStart(bufferStartIn), numChannels(numChannelsIn), numSamples(numSamplesIn), sampleRate(sampleRateIn)
+    {
+    }
+
+    void runJob(int index) override
+    {
+        auto& trackBuffer = *snapshot.trackBuffers.getUnchecked(index);
+        juce::AudioBuffer<float> view(trackBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+        view.clear();
+        snapshot.tracks.getReference(index).render(view, bufferStart, sampleRate);
+    }
+
+    TrackSnapshot& snapshot;
+    int64 bufferStart = 0;
+    int numChannels = 0;
+    int numSamples = 0;
+    double sampleRate = 44100.0;
+};
+
+AudioEngine::AudioEngine()
+{
+    publishSnapshot();
+    startTimer(1000);
+}
+
+AudioEngine::~AudioEngine()
+{
+    stopTimer();
+    cancelPendingUpdate();
+}
+
+void AudioEngine::prepare(double sampleRateIn, int samplesPerBlockExpected)
 {
     sampleRate = sampleRateIn;
     playheadSample.store(0);
+
+    // Republish so the per-track buffers fit the new block size.
+    if (expectedBlockSize.exchange(juce::jmax(1, samplesPerBlockExpected)) != samplesPerBlockExpected)
+        triggerAsyncUpdate();
 }
 
 void AudioEngine::release()
@@ -18,26 +60,71 @@ void AudioEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& info)
     if (info.buffer == nullptr || info.numSamples <= 0)
         return;
 
+    // Adopt the latest published snapshot. The message thread only holds this lock for a
+    // pointer swap, and if it happens to be held we simply render the previous snapshot.
+    {
+        const juce::SpinLock::ScopedTryLockType tryLock(snapshotLock);
+        if (tryLock.isLocked() && pendingSnapshot != nullptr)
+        {
+            // Sliced clips keep playing the order they rolled in the previous snapshot.
+            if (activeSnapshot != nullptr && pendingSnapshot->previousSerial == activeSnapshot->serial)
+            {
+                auto& previousTracks = activeSnapshot->tracks;
+                auto& newTracks = pendingSnapshot->tracks;
+                const auto& sources = pendingSnapshot->playbackStateSources;
+                const int numTracks = juce::jmin(previousTracks.size(), newTracks.size(), sources.size());
+                for (int t = 0; t < numTracks; ++t)
+                    newTracks.getReference(t).takePlaybackStateFrom(previousTracks.getReference(t), sources.getReference(t));
+            }
+
+            activeSnapshot = pendingSnapshot;
+            pendingSnapshot = nullptr;
+        }
+    }
+
     if (!playing.load())
         return;
 
     const int numChannels = info.buffer->getNumChannels();
-    if (numChannels <= 0)
+    if (numChannels <= 0 || activeSnapshot == nullptr)
         return;
 
-    std::vector<float*> channelPointers;
-    channelPointers.resize((size_t)numChannels);
-    for (int ch = 0; ch < numChannels; ++ch)
-        channelPointers[(size_t)ch] = info.buffer->getWritePointer(ch, info.startSample);
-
-    juce::AudioBuffer<float> activeBuffer(channelPointers.data(), numChannels, info.numSamples);
+    juce::AudioBuffer<float> activeBuffer(info.buffer->getArrayOfWritePointers(),
+                                          numChannels,
+                                          info.startSample,
+                                          info.numSamples);
 
-    juce::ScopedLock lock(trackLock);
     int64 ph = playheadSample.load();
 
     const int64 bufferStart = ph;
-    for (auto& track : tracks)
-        track.render(activeBuffer, bufferStart, sampleRate);
+    auto& snapshot = *activeSnapshot;
+    const int numTracks = snapshot.tracks.size();
+    // Until a snapshot for a new block size arrives, larger blocks render serially; the
+    // tracks grow their own scratch buffers but the parallel buffers cannot be resized here.
+    const bool buffersFit = numTracks == snapshot.trackBuffers.size()
+                            && numChannels <= snapshotChannels
+                            && info.numSamples <= snapshot.bufferBlockSize;
+
+    if (renderPool.getNumThreads() > 0 && numTracks > 1 && buffersFit)
+    {
+        TrackRenderJob job(snapshot, bufferStart, numChannels, info.numSamples, sampleRate);
+        renderPool.run(job, numTracks);
+
+        // Sum in track order so the mix does not depend on which worker finished first.
+        for (int t = 0; t < numTracks; ++t)
+        {
+            if (snapshot.tracks.getReference(t).muted)
+                continue;
+            const auto& trackBuffer = *snapshot.trackBuffers.getUnchecked(t);
+            for (int ch = 0; ch < numChannels; ++ch)
+                activeBuffer.addFrom(ch, 0, trackBuffer, ch, 0, info.numSamples);
+        }
+    }
+    else
+    {
+        for (auto& track : snapshot.tracks)
+            track.render(activeBuffer, bufferStart, sampleRate);
+    }
 
     ph += info.numSamples;
     playheadSample.store(ph);
@@ -48,14 +135,97 @@ void AudioEngine::setPlaying(bool shouldPlay)
     playing.store(shouldPlay);
 }
 
+void AudioEngine::setInterpolation(Sample::Interpolation newInterpolation)
+{
+    if (interpolation == newInterpolation)
+        return;
+
+    interpolation = newInterpolation;
+    publishSnapshot();
+}
+
 void AudioEngine::addTrack(const juce::String& name)
 {
-    juce::ScopedLock lock(trackLock);
+    ScopedTrackEdit edit(*this);
     tracks.add(Track(name));
 }
 
 void AudioEngine::clearTracks()
 {
-    juce::ScopedLock lock(trackLock);
+    ScopedTrackEdit edit(*this);
     tracks.clear();
 }
+
+void AudioEngine::publishSnapshot()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    const int blockSize = expectedBlockSize.load();
+    TrackSnapshot::Ptr snapshot = new TrackSnapshot();
+    snapshot->tracks = tracks;
+    snapshot->bufferBlockSize = blockSize;
+    for (auto& track : snapshot->tracks)
+    {
+        track.setInterpolation(interpolation);
+        track.prepareToRender(snapshotChannels, blockSize);
+        snapshot->trackBuffers.add(new juce::AudioBuffer<float>(snapshotChannels, blockSize));
+    }
+
+    // Match clips against the last published snapshot here, so the audio thread only swaps
+    // states by index. If that snapshot is still pending, take it back and follow the one
+    // before it instead, which is what the audio thread is playing.
+    snapshot->serial = nextSerial++;
+    if (lastPublished != nullptr)
+    {
+        bool lastStillPending = false;
+        {
+            const juce::SpinLock::ScopedLockType lock(snapshotLock);
+            if (pendingSnapshot == lastPublished)
+            {
+                pendingSnapshot = nullptr;
+                lastStillPending = true;
+            }
+        }
+
+        const auto& previousTracks = lastPublished->tracks;
+        for (int t = 0; t < snapshot->tracks.size(); ++t)
+        {
+            juce::Array<int> sources;
+            if (t < previousTracks.size())
+                sources = snapshot->tracks.getReference(t).findPlaybackStateSources(previousTracks.getReference(t));
+
+            if (lastStillPending)
+            {
+                const auto* earlier = t < lastPublished->playbackStateSources.size()
+                                          ? &lastPublished->playbackStateSources.getReference(t)
+                                          : nullptr;
+                for (auto& source : sources)
+                    source = (earlier != nullptr && source >= 0 && source < earlier->size()) ? earlier->getUnchecked(source) : -1;
+            }
+            snapshot->playbackStateSources.add(std::move(sources));
+        }
+        snapshot->previousSerial = lastStillPending ? lastPublished->previousSerial : lastPublished->serial;
+    }
+    lastPublished = snapshot;
+
+    // Keep a reference here so the audio thread never drops the last one.
+    releasePool.add(snapshot);
+
+    const juce::SpinLock::ScopedLockType lock(snapshotLock);
+    pendingSnapshot = snapshot;
+}
+
+void AudioEngine::handleAsyncUpdate()
+{
+    publishSnapshot();
+}
+
+void AudioEngine::timerCallback()
+{
+    // A snapshot referenced only by the pool is no longer pending or being rendered.
+    for (int i = releasePool.size(); --i >= 0;)
+    {
+        if (releasePool.getObjectPointerUnchecked(i)->getReferenceCount() == 1)
+            releasePool.remove(i);
+    }
+}
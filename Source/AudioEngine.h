@@ -3,10 +3,15 @@
 #include <JuceHeader.h>
 #include <atomic>
 #include "Track.h"
+#include "RenderWorkerPool.h"
 
-class AudioEngine
+class AudioEngine : private juce::Timer,
+                    private juce::AsyncUpdater
 {
 public:
+    AudioEngine();
+    ~AudioEngine() override;
+
     void prepare(double sampleRateIn, int samplesPerBlockExpected);
     void release();
 
@@ -18,18 +23,77 @@ public:
     void setPlayheadSample(int64 newPos) { playheadSample.store(newPos); }
     int64 getPlayheadSample() const { return playheadSample.load(); }
 
+    // Tracks are rendered in parallel on this many worker threads (0 renders them all on
+    // the audio thread).
+    void setRenderThreadCount(int numThreads) { renderPool.setNumThreads(numThreads); }
+    int getRenderThreadCount() const { return renderPool.getNumThreads(); }
+    void setRenderWaitPolicy(RenderWorkerPool::WaitPolicy policy) { renderPool.setWaitPolicy(policy); }
+    RenderWorkerPool::WaitPolicy getRenderWaitPolicy() const { return renderPool.getWaitPolicy(); }
+
+    // Resampling quality for playback; changing it republishes the tracks.
+    void setInterpolation(Sample::Interpolation newInterpolation);
+    Sample::Interpolation getInterpolation() const { return interpolation; }
+
     void addTrack(const juce::String& name);
     void clearTracks();
 
+    // The track list is owned by the message thread. Changes made to it only reach the
+    // audio thread once a ScopedTrackEdit that wraps them goes out of scope.
     juce::Array<Track>& getTracks() { return tracks; }
     const juce::Array<Track>& getTracks() const { return tracks; }
-    juce::CriticalSection& getTrackLock() { return trackLock; }
+
+    class ScopedTrackEdit
+    {
+    public:
+        explicit ScopedTrackEdit(AudioEngine& engineIn) : engine(engineIn) { ++engine.editDepth; }
+        ~ScopedTrackEdit()
+        {
+            if (--engine.editDepth == 0)
+                engine.publishSnapshot();
+        }
+
+    private:
+        AudioEngine& engine;
+        JUCE_DECLARE_NON_COPYABLE(ScopedTrackEdit)
+    };
 
 private:
+    // Immutable copy of the track list rendered by the audio thread. Only the per-track
+    // playback/scratch state inside it is touched while rendering.
+    struct TrackSnapshot : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<TrackSnapshot>;
+        juce::Array<Track> tracks;
+        juce::OwnedArray<juce::AudioBuffer<float>> trackBuffers; // one per track, for parallel rendering
+        int bufferBlockSize = 0; // frames each track buffer holds
+        uint64 serial = 0;
+        // The snapshot this one follows, and for each track the clips of that snapshot whose
+        // playback state each clip takes over (see Track::findPlaybackStateSources()).
+        uint64 previousSerial = 0;
+        juce::Array<juce::Array<int>> playbackStateSources;
+    };
+
+    struct TrackRenderJob;
+
+    void publishSnapshot();
+    void timerCallback() override;
+    void handleAsyncUpdate() override;
+
     double sampleRate = 44100.0;
+    std::atomic<int> expectedBlockSize {512};
     std::atomic<int64> playheadSample {0};
     std::atomic<bool> playing {false};
 
-    juce::CriticalSection trackLock;
     juce::Array<Track> tracks;
+    int editDepth = 0;
+    Sample::Interpolation interpolation = Sample::Interpolation::cubic;
+
+    juce::SpinLock snapshotLock;
+    TrackSnapshot::Ptr pendingSnapshot;
+    TrackSnapshot::Ptr activeSnapshot;
+    TrackSnapshot::Ptr lastPublished;  // message thread only
+    uint64 nextSerial = 1;
+    juce::ReferenceCountedArray<TrackSnapshot> releasePool;
+
+    RenderWorkerPool renderPool;
 };
@@ -2,7 +2,7 @@
 #include <algorithm>
 #include <cmath>
 
-void BeatSlicerComponent::SliceWaveformView::setSample(const std::shared_ptr<Sample>& sampleIn)
+void BeatSlicerComponent::SliceWaveformView::setSample(const std::shared_ptr<const Sample>& sampleIn)
 {
     sample = sampleIn;
     repaint();
@@ -14,6 +14,12 @@ void BeatSlicerComponent::SliceWaveformView::setSlices(const juce::Array<BeatSli
     repaint();
 }
 
+void BeatSlicerComponent::SliceWaveformView::setOnsets(const std::shared_ptr<const OnsetAnalysis>& onsetsIn)
+{
+    onsets = onsetsIn;
+    repaint();
+}
+
 double BeatSlicerComponent::SliceWaveformView::xToNorm(float x) const
 {
     const auto bounds = getLocalBounds().toFloat().reduced(8.0f);
@@ -42,28 +48,14 @@ void BeatSlicerComponent::SliceWaveformView::paint(juce::Graphics& g)
         const int width = juce::jmax(1, (int)area.getWidth());
         const float midY = area.getCentreY();
         const float radius = area.getHeight() * 0.45f;
-        const int totalSamples = sample->getNumSamples();
+        const double samplesPerPixel = (double)sample->getNumSamples() / (double)width;
 
         g.setColour(juce::Colours::white.withAlpha(0.65f));
         for (int x = 0; x < width; ++x)
         {
-            const int startSample = (int)(((double)x / (double)width) * (double)totalSamples);
-            const int endSample = juce::jmin(totalSamples - 1, (int)(((double)(x + 1) / (double)width) * (double)totalSamples));
-
-            float minV = 1.0f;
-            float maxV = -1.0f;
-            for (int sIdx = startSample; sIdx <= endSample; ++sIdx)
-            {
-                const float v = sample->getSampleAt(0, (double)sIdx);
-                minV = std::min(minV, v);
-                maxV = std::max(maxV, v);
-            }
-
-            if (minV > maxV)
-                continue;
-
+            const auto peak = sample->getPeak(0, (double)x * samplesPerPixel, (double)(x + 1) * samplesPerPixel);
             const float drawX = area.getX() + (float)x;
-            g.drawLine(drawX, midY - maxV * radius, drawX, midY - minV * radius);
+            g.drawLine(drawX, midY - peak.max * radius, drawX, midY - peak.min * radius);
         }
     }
     else
@@ -72,6 +64,30 @@ void BeatSlicerComponent::SliceWaveformView::paint(juce::Graphics& g)
         g.drawText("No waveform available for this clip", area.toNearestInt(), juce::Justification::centred, false);
     }
 
+    if (onsets != nullptr && onsets->getNumFrames() > 0)
+    {
+        // Onset strength along the bottom, strongest frame per pixel.
+        const auto& strength = onsets->getStrength();
+        const int width = juce::jmax(1, (int)area.getWidth());
+        const float height = area.getHeight() * 0.25f;
+        const double framesPerPixel = (double)strength.size() / (double)width;
+        juce::Path curve;
+        curve.startNewSubPath(area.getX(), area.getBottom());
+        for (int x = 0; x < width; ++x)
+        {
+            const int first = (int)((double)x * framesPerPixel);
+            const int last = juce::jmax(first + 1, juce::jmin((int)strength.size(), (int)((double)(x + 1) * framesPerPixel)));
+            float value = 0.0f;
+            for (int f = first; f < last; ++f)
+                value = juce::jmax(value, strength[(size_t)f]);
+            curve.lineTo(area.getX() + (float)x, area.getBottom() - value * height);
+        }
+        curve.lineTo(area.getX() + (float)width, area.getBottom());
+        curve.closeSubPath();
+        g.setColour(juce::Colour(110, 190, 242).withAlpha(0.35f));
+        g.fillPath(curve);
+    }
+
     g.setColour(juce::Colour(242, 205, 110).withAlpha(0.85f));
     for (int i = 1; i < slices.size(); ++i)
     {
@@ -121,6 +137,8 @@ BeatSlicerComponent::BeatSlicerComponent()
     addAndMakeVisible(playProbabilityLabel);
     addAndMakeVisible(repeatCountLabel);
     addAndMakeVisible(repeatProbabilityLabel);
+    addAndMakeVisible(sensitivitySlider);
+    addAndMakeVisible(sensitivityLabel);
     addAndMakeVisible(helpLabel);
     addAndMakeVisible(autoDetectButton);
     addAndMakeVisible(addSliceButton);
@@ -154,15 +172,22 @@ BeatSlicerComponent::BeatSlicerComponent()
     repeatProbabilitySlider.setTooltip("Probability that each extra ratchet repeat will fire.");
     autoDetectButton.setTooltip("Analyze waveform transients and create slice boundaries automatically.");
 
+    sensitivitySlider.setRange(0.0, 1.0, 0.01);
+    sensitivitySlider.setValue(0.5, juce::dontSendNotification);
+    sensitivitySlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 56, 20);
+    sensitivitySlider.setNumDecimalPlacesToDisplay(2);
+    sensitivitySlider.setTooltip("How weak a transient Auto Detect Beats still slices at. Changing it re-slices detected beats straight away.");
+
     modeLabel.setText("Playback Mode", juce::dontSendNotification);
     sliceLabel.setText("Editing Slice", juce::dontSendNotification);
     playProbabilityLabel.setText("Slice Play Probability", juce::dontSendNotification);
     repeatCountLabel.setText("Ratcheting Repeats", juce::dontSendNotification);
     repeatProbabilityLabel.setText("Repeat Probability", juce::dontSendNotification);
+    sensitivityLabel.setText("Detect Sensitivity", juce::dontSendNotification);
     helpLabel.setText("Drag vertical lines in the waveform to move slice boundaries. Press Close to return to timeline.", juce::dontSendNotification);
     helpLabel.setJustificationType(juce::Justification::centredLeft);
 
-    for (auto* lbl : {&modeLabel, &sliceLabel, &playProbabilityLabel, &repeatCountLabel, &repeatProbabilityLabel, &helpLabel})
+    for (auto* lbl : {&modeLabel, &sliceLabel, &playProbabilityLabel, &repeatCountLabel, &repeatProbabilityLabel, &sensitivityLabel, &helpLabel})
     {
         lbl->setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.82f));
     }
@@ -172,6 +197,7 @@ BeatSlicerComponent::BeatSlicerComponent()
     playProbabilityLabel.setJustificationType(juce::Justification::centredLeft);
     repeatCountLabel.setJustificationType(juce::Justification::centredLeft);
     repeatProbabilityLabel.setJustificationType(juce::Justification::centredLeft);
+    sensitivityLabel.setJustificationType(juce::Justification::centredRight);
 
     waveformView.onBoundaryMoved([this](int boundaryIndex, double newNorm)
     {
@@ -224,6 +250,13 @@ BeatSlicerComponent::BeatSlicerComponent()
         }
     };
 
+    sensitivitySlider.onValueChange = [this]()
+    {
+        if (suppressCallbacks || onsetAnalysis == nullptr)
+            return;
+        sliceAtDetectedOnsets();
+    };
+
     repeatProbabilitySlider.onValueChange = [this]()
     {
         if (suppressCallbacks)
@@ -238,7 +271,18 @@ BeatSlicerComponent::BeatSlicerComponent()
 
 void BeatSlicerComponent::setClip(const TrackClip& clip)
 {
+    const bool sampleChanged = clip.sample != sample;
     sample = clip.sample;
+    sourceStartNorm = juce::jlimit(0.0, 1.0, (double)clip.sourceStartNorm);
+    sourceEndNorm = juce::jlimit(sourceStartNorm, 1.0, (double)clip.sourceEndNorm);
+    if (sampleChanged)
+    {
+        sliceWhenAnalysed = false;
+        autoDetectButton.setEnabled(true);
+        // Samples analysed for the tempo fit already carry their onsets.
+        setOnsetAnalysis(sample != nullptr ? sample->getOnsetAnalysis() : nullptr);
+    }
+
     state = clip.slicing;
     ensureSlicesInitialized();
     selectedSlice = juce::jlimit(0, juce::jmax(0, state.slices.size() - 1), selectedSlice);
@@ -354,7 +398,8 @@ void BeatSlicerComponent::handleBoundaryMove(int boundaryIndex, double newNorm)
 
     const double minNorm = state.slices.getReference(boundaryIndex - 1).startNorm + 0.01;
     const double maxNorm = state.slices.getReference(boundaryIndex).endNorm - 0.01;
-    const double t = juce::jlimit(minNorm, maxNorm, newNorm);
+    // The boundary is a cut in the audio, so it lands on a zero crossing when one is near.
+    const double t = juce::jlimit(minNorm, maxNorm, snapToZeroCrossing(juce::jlimit(minNorm, maxNorm, newNorm)));
 
     state.slices.getReference(boundaryIndex - 1).endNorm = t;
     state.slices.getReference(boundaryIndex).startNorm = t;
@@ -363,6 +408,25 @@ void BeatSlicerComponent::handleBoundaryMove(int boundaryIndex, double newNorm)
     emitChanged();
 }
 
+double BeatSlicerComponent::snapToZeroCrossing(double sliceNorm) const
+{
+    if (sample == nullptr || sample->getNumSamples() <= 0)
+        return sliceNorm;
+
+    // Slices are relative to the part of the sample the clip plays.
+    const double total = (double)sample->getNumSamples();
+    const double range = sourceEndNorm - sourceStartNorm;
+    if (range <= 0.0)
+        return sliceNorm;
+
+    const int64 position = (int64)std::round((sourceStartNorm + range * sliceNorm) * total);
+    const int64 maxDistance = (int64)std::round(ZeroCrossingIndex::snapSeconds * sample->getSampleRate());
+    const int64 snapped = sample->snapToZeroCrossing(position, maxDistance);
+    if (snapped == position)
+        return sliceNorm;
+    return ((double)snapped / total - sourceStartNorm) / range;
+}
+
 void BeatSlicerComponent::buttonClicked(juce::Button* button)
 {
     if (button == &autoDetectButton)
@@ -383,77 +447,65 @@ void BeatSlicerComponent::autoDetectBeats()
     if (sample == nullptr || sample->getNumSamples() <= 0)
         return;
 
-    const int totalSamples = sample->getNumSamples();
-    const double sr = juce::jmax(1.0, sample->getSampleRate());
-
-    // 10 ms analysis hop gives enough temporal precision for slicing.
-    const int hop = juce::jmax(32, (int)std::round(sr * 0.010));
-    const int frame = juce::jmax(hop * 2, (int)std::round(sr * 0.020));
-    const int frameCount = juce::jmax(1, totalSamples / hop);
-
-    std::vector<double> env((size_t)frameCount, 0.0);
-    std::vector<double> flux((size_t)frameCount, 0.0);
-
-    for (int i = 0; i < frameCount; ++i)
+    if (onsetAnalysis != nullptr)
     {
-        const int center = i * hop;
-        const int start = juce::jmax(0, center - frame / 2);
-        const int end = juce::jmin(totalSamples - 1, start + frame);
-        double sumSq = 0.0;
-        int n = 0;
-        for (int sIdx = start; sIdx < end; ++sIdx)
-        {
-            const double v = (double)sample->getSampleAt(0, (double)sIdx);
-            sumSq += v * v;
-            ++n;
-        }
-        env[(size_t)i] = n > 0 ? std::sqrt(sumSq / (double)n) : 0.0;
+        sliceAtDetectedOnsets();
+        return;
     }
+    if (analyser == nullptr || sliceWhenAnalysed)
+        return;
 
-    for (int i = 1; i < frameCount; ++i)
-        flux[(size_t)i] = juce::jmax(0.0, env[(size_t)i] - env[(size_t)(i - 1)]);
+    // The analysis runs in the background; the slices follow when it arrives, unless
+    // another clip has been opened by then.
+    sliceWhenAnalysed = true;
+    autoDetectButton.setEnabled(false);
+    juce::Component::SafePointer<BeatSlicerComponent> safeThis(this);
+    const auto requestedSample = sample;
+    analyser->requestOnsets(sample, SampleAnalyser::Priority::interactive,
+                            [safeThis, requestedSample](std::shared_ptr<const OnsetAnalysis> onsets)
+    {
+        if (safeThis == nullptr || safeThis->sample != requestedSample || !safeThis->sliceWhenAnalysed)
+            return;
 
-    const int threshWin = 12;
-    const int minGapFrames = juce::jmax(2, (int)std::round(0.080 * sr / (double)hop));
-    const int maxSlices = 32;
-    std::vector<int> onsets;
-    onsets.push_back(0);
+        safeThis->sliceWhenAnalysed = false;
+        safeThis->autoDetectButton.setEnabled(true);
+        safeThis->setOnsetAnalysis(std::move(onsets));
+        if (safeThis->onsetAnalysis != nullptr)
+            safeThis->sliceAtDetectedOnsets();
+    });
+}
 
-    int lastAccepted = -minGapFrames;
-    for (int i = 2; i < frameCount - 2; ++i)
-    {
-        int a = juce::jmax(0, i - threshWin);
-        int b = juce::jmin(frameCount - 1, i + threshWin);
-        double mean = 0.0;
-        for (int k = a; k <= b; ++k)
-            mean += flux[(size_t)k];
-        mean /= (double)juce::jmax(1, b - a + 1);
-
-        // Adaptive threshold + local peak check.
-        const double threshold = mean * 1.8;
-        const bool localPeak = flux[(size_t)i] > flux[(size_t)(i - 1)] && flux[(size_t)i] >= flux[(size_t)(i + 1)];
-        if (localPeak && flux[(size_t)i] > threshold && (i - lastAccepted) >= minGapFrames)
-        {
-            onsets.push_back(i * hop);
-            lastAccepted = i;
-            if ((int)onsets.size() >= maxSlices)
-                break;
-        }
-    }
-    onsets.push_back(totalSamples);
+void BeatSlicerComponent::setOnsetAnalysis(std::shared_ptr<const OnsetAnalysis> onsets)
+{
+    onsetAnalysis = std::move(onsets);
+    waveformView.setOnsets(onsetAnalysis);
+}
+
+void BeatSlicerComponent::sliceAtDetectedOnsets()
+{
+    const int64 totalSamples = onsetAnalysis->getNumSamples();
+    const double sr = onsetAnalysis->getSampleRate();
+    const int maxSlices = 32;
+    const auto onsets = onsetAnalysis->findOnsets(sensitivitySlider.getValue(), 0.080, maxSlices - 1);
 
     // De-duplicate and enforce minimum slice length.
-    const int minSliceSamples = juce::jmax(1, (int)std::round(sr * 0.040));
-    std::vector<int> boundaries;
+    const int64 minSliceSamples = juce::jmax((int64)1, (int64)std::round(sr * 0.040));
+    const int64 snapDistance = (int64)std::round(ZeroCrossingIndex::snapSeconds * sr);
+    std::vector<int64> boundaries;
     boundaries.push_back(0);
-    for (int pos : onsets)
+    for (auto pos : onsets)
     {
-        pos = juce::jlimit(0, totalSamples, pos);
+        // Onsets are only known to a hop, so moving them to a nearby zero crossing costs
+        // no accuracy and keeps the cut from clicking.
+        if (sample != nullptr)
+            pos = sample->snapToZeroCrossing(pos, snapDistance);
+        pos = juce::jlimit((int64)0, totalSamples, pos);
         if (pos - boundaries.back() >= minSliceSamples)
             boundaries.push_back(pos);
     }
-    if (boundaries.back() != totalSamples)
-        boundaries.push_back(totalSamples);
+    if (totalSamples - boundaries.back() < minSliceSamples && boundaries.size() > 1)
+        boundaries.pop_back();
+    boundaries.push_back(totalSamples);
 
     if ((int)boundaries.size() < 3)
     {
@@ -461,7 +513,7 @@ void BeatSlicerComponent::autoDetectBeats()
         boundaries.clear();
         boundaries.push_back(0);
         for (int i = 1; i < 8; ++i)
-            boundaries.push_back((int)std::round((double)i / 8.0 * (double)totalSamples));
+            boundaries.push_back((int64)std::round((double)i / 8.0 * (double)totalSamples));
         boundaries.push_back(totalSamples);
     }
 
@@ -515,7 +567,10 @@ void BeatSlicerComponent::resized()
     waveformView.setBounds(area.removeFromTop(waveformH));
 
     area.removeFromTop(8);
-    helpLabel.setBounds(area.removeFromTop(22));
+    auto helpRow = area.removeFromTop(22);
+    sensitivitySlider.setBounds(helpRow.removeFromRight(220));
+    sensitivityLabel.setBounds(helpRow.removeFromRight(130));
+    helpLabel.setBounds(helpRow);
     area.removeFromTop(8);
 
     const int colGap = 10;
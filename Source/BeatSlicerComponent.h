@@ -1,6 +1,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "OnsetAnalysis.h"
+#include "SampleAnalyser.h"
 #include "Track.h"
 #include <vector>
 
@@ -12,6 +14,8 @@ public:
 
     BeatSlicerComponent();
 
+    // Onsets are requested from the analyser, which must outlive this component.
+    void setAnalyser(SampleAnalyser* analyserIn) { analyser = analyserIn; }
     void setClip(const TrackClip& clip);
     void onSlicingChanged(SlicingChanged cb) { slicingChanged = std::move(cb); }
     void onClose(std::function<void()> cb) { closeRequested = std::move(cb); }
@@ -27,8 +31,9 @@ private:
     public:
         using BoundaryMoved = std::function<void(int boundaryIndex, double newNorm)>;
 
-        void setSample(const std::shared_ptr<Sample>& sampleIn);
+        void setSample(const std::shared_ptr<const Sample>& sampleIn);
         void setSlices(const juce::Array<BeatSlice>& slicesIn);
+        void setOnsets(const std::shared_ptr<const OnsetAnalysis>& onsetsIn);
         void onBoundaryMoved(BoundaryMoved cb) { boundaryMoved = std::move(cb); }
 
         void paint(juce::Graphics& g) override;
@@ -40,8 +45,9 @@ private:
         double xToNorm(float x) const;
         float normToX(double norm) const;
 
-        std::shared_ptr<Sample> sample;
+        std::shared_ptr<const Sample> sample;
         juce::Array<BeatSlice> slices;
+        std::shared_ptr<const OnsetAnalysis> onsets;
         BoundaryMoved boundaryMoved;
         int draggingBoundary = -1;
     };
@@ -53,9 +59,17 @@ private:
     void addSlice();
     void removeSlice();
     void handleBoundaryMove(int boundaryIndex, double newNorm);
+    double snapToZeroCrossing(double sliceNorm) const;
     void autoDetectBeats();
-
-    std::shared_ptr<Sample> sample;
+    void setOnsetAnalysis(std::shared_ptr<const OnsetAnalysis> onsets);
+    void sliceAtDetectedOnsets();
+
+    SampleAnalyser* analyser = nullptr;
+    std::shared_ptr<const Sample> sample;
+    // Onset strength of the sample, kept so a new sensitivity only re-picks the slices.
+    std::shared_ptr<const OnsetAnalysis> onsetAnalysis;
+    double sourceStartNorm = 0.0;
+    double sourceEndNorm = 1.0;
     BeatSlicingSettings state;
     int selectedSlice = 0;
 
@@ -65,11 +79,13 @@ private:
     juce::Slider probabilitySlider;
     juce::Slider repeatCountSlider;
     juce::Slider repeatProbabilitySlider;
+    juce::Slider sensitivitySlider;
     juce::Label modeLabel;
     juce::Label sliceLabel;
     juce::Label playProbabilityLabel;
     juce::Label repeatCountLabel;
     juce::Label repeatProbabilityLabel;
+    juce::Label sensitivityLabel;
     juce::Label helpLabel;
     juce::TextButton autoDetectButton {"Auto Detect Beats"};
     juce::TextButton addSliceButton {"+ Slice"};
@@ -81,4 +97,5 @@ private:
     SlicingChanged slicingChanged;
     std::function<void()> closeRequested;
     bool suppressCallbacks = false;
+    bool sliceWhenAnalysed = false;
 };
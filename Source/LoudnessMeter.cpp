@@ -0,0 +1,226 @@
+#include "LoudnessMeter.h"
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// K-weighting filter parameters from BS.1770, in a form that works at any sample rate.
+constexpr double shelfHz = 1681.974450955533;
+constexpr double shelfGainDb = 3.999843853973347;
+constexpr double shelfQ = 0.7071752369554196;
+constexpr double highPassHz = 38.13547087602444;
+constexpr double highPassQ = 0.5003270373238773;
+
+constexpr double loudnessOffset = -0.691;
+constexpr double absoluteGateLufs = -70.0;
+constexpr double relativeGateLu = -10.0;
+
+double energyToLoudness(double energy)
+{
+    return loudnessOffset + 10.0 * std::log10(energy);
+}
+
+double loudnessToEnergy(double lufs)
+{
+    return std::pow(10.0, (lufs - loudnessOffset) / 10.0);
+}
+}
+
+LoudnessMeter::LoudnessMeter(double sampleRate, int numChannelsIn)
+    : numChannels(juce::jmax(1, numChannelsIn))
+{
+    sampleRate = juce::jmax(8000.0, sampleRate);
+    subBlockLength = juce::jmax(1, (int)std::round(sampleRate * 0.1));
+    oversampling = sampleRate < 96000.0 ? 4 : (sampleRate < 192000.0 ? 2 : 1);
+
+    channels.resize((size_t)numChannels);
+    {
+        const double k = std::tan(juce::MathConstants<double>::pi * shelfHz / sampleRate);
+        const double vh = std::pow(10.0, shelfGainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / shelfQ + k * k;
+        for (auto& channel : channels)
+        {
+            auto& f = channel.shelf;
+            f.b0 = (vh + vb * k / shelfQ + k * k) / a0;
+            f.b1 = 2.0 * (k * k - vh) / a0;
+            f.b2 = (vh - vb * k / shelfQ + k * k) / a0;
+            f.a1 = 2.0 * (k * k - 1.0) / a0;
+            f.a2 = (1.0 - k / shelfQ + k * k) / a0;
+        }
+    }
+    {
+        const double k = std::tan(juce::MathConstants<double>::pi * highPassHz / sampleRate);
+        const double a0 = 1.0 + k / highPassQ + k * k;
+        for (auto& channel : channels)
+        {
+            auto& f = channel.highPass;
+            f.b0 = 1.0;
+            f.b1 = -2.0;
+            f.b2 = 1.0;
+            f.a1 = 2.0 * (k * k - 1.0) / a0;
+            f.a2 = (1.0 - k / highPassQ + k * k) / a0;
+        }
+    }
+
+    // Kaiser-windowed sinc low-pass at the original Nyquist, split into one set of taps per
+    // output phase. Each phase sums to about 1, so a DC input reads as its own level.
+    if (oversampling > 1)
+    {
+        const int numTaps = tapsPerPhase * oversampling;
+        const double centre = (double)(numTaps - 1) / 2.0;
+        const double beta = 5.0;
+        const auto besselI0 = [](double x)
+        {
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 25; ++k)
+            {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        };
+
+        phaseCoefficients.assign((size_t)oversampling, std::vector<float>((size_t)tapsPerPhase, 0.0f));
+        for (int n = 0; n < numTaps; ++n)
+        {
+            const double t = ((double)n - centre) / (double)oversampling;
+            const double sinc = t == 0.0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * t) / (juce::MathConstants<double>::pi * t);
+            const double r = ((double)n - centre) / centre;
+            const double window = besselI0(beta * std::sqrt(juce::jmax(0.0, 1.0 - r * r))) / besselI0(beta);
+            phaseCoefficients[(size_t)(n % oversampling)][(size_t)(n / oversampling)] = (float)(sinc * window);
+        }
+    }
+
+    reset();
+}
+
+void LoudnessMeter::reset()
+{
+    for (auto& channel : channels)
+    {
+        channel.shelf.z1 = channel.shelf.z2 = 0.0;
+        channel.highPass.z1 = channel.highPass.z2 = 0.0;
+        channel.history.assign((size_t)juce::jmax(0, tapsPerPhase - 1), 0.0f);
+    }
+
+    subBlockFilled = 0;
+    subBlockEnergy = 0.0;
+    recentSubBlocks.fill(0.0);
+    numSubBlocks = 0;
+    blockEnergies.clear();
+    truePeak = 0.0f;
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int channelsToRead = juce::jmin(numChannels, buffer.getNumChannels());
+    for (int ch = 0; ch < channelsToRead; ++ch)
+        measureTruePeak(ch, buffer.getReadPointer(ch), numSamples);
+
+    // The filters run sample by sample, but only up to the end of the current 100 ms step,
+    // so every step's energy is complete when it is closed.
+    for (int pos = 0; pos < numSamples;)
+    {
+        const int len = juce::jmin(numSamples - pos, subBlockLength - subBlockFilled);
+        for (int ch = 0; ch < channelsToRead; ++ch)
+        {
+            auto& channel = channels[(size_t)ch];
+            const float* input = buffer.getReadPointer(ch, pos);
+            double sum = 0.0;
+            for (int i = 0; i < len; ++i)
+            {
+                const double y = channel.highPass.process(channel.shelf.process((double)input[i]));
+                sum += y * y;
+            }
+            subBlockEnergy += sum;
+        }
+
+        pos += len;
+        subBlockFilled += len;
+        if (subBlockFilled == subBlockLength)
+            finishSubBlock();
+    }
+}
+
+void LoudnessMeter::measureTruePeak(int channel, const float* input, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    const auto range = juce::FloatVectorOperations::findMinAndMax(input, numSamples);
+    truePeak = juce::jmax(truePeak, std::abs(range.getStart()), std::abs(range.getEnd()));
+    if (oversampling <= 1)
+        return;
+
+    // Each phase is a short FIR over the input, computed as one multiply-add of the whole
+    // block per tap, so the work is in long vector operations rather than per-sample loops.
+    auto& history = channels[(size_t)channel].history;
+    const int historyLength = (int)history.size();
+    oversampleInput.resize((size_t)(historyLength + numSamples));
+    oversampleOutput.resize((size_t)numSamples);
+    std::copy(history.begin(), history.end(), oversampleInput.begin());
+    std::copy(input, input + numSamples, oversampleInput.begin() + historyLength);
+
+    for (const auto& taps : phaseCoefficients)
+    {
+        juce::FloatVectorOperations::clear(oversampleOutput.data(), numSamples);
+        for (int k = 0; k < tapsPerPhase; ++k)
+            juce::FloatVectorOperations::addWithMultiply(oversampleOutput.data(),
+                                                         oversampleInput.data() + historyLength - k,
+                                                         taps[(size_t)k],
+                                                         numSamples);
+
+        const auto phaseRange = juce::FloatVectorOperations::findMinAndMax(oversampleOutput.data(), numSamples);
+        truePeak = juce::jmax(truePeak, std::abs(phaseRange.getStart()), std::abs(phaseRange.getEnd()));
+    }
+
+    std::copy(oversampleInput.end() - historyLength, oversampleInput.end(), history.begin());
+}
+
+void LoudnessMeter::finishSubBlock()
+{
+    recentSubBlocks[(size_t)(numSubBlocks % subBlocksPerBlock)] = subBlockEnergy / (double)subBlockLength;
+    ++numSubBlocks;
+    subBlockEnergy = 0.0;
+    subBlockFilled = 0;
+
+    if (numSubBlocks >= subBlocksPerBlock)
+    {
+        double energy = 0.0;
+        for (auto subBlock : recentSubBlocks)
+            energy += subBlock;
+        blockEnergies.push_back(energy / (double)subBlocksPerBlock);
+    }
+}
+
+double LoudnessMeter::getIntegratedLoudness() const
+{
+    const double absoluteGate = loudnessToEnergy(absoluteGateLufs);
+    double sum = 0.0;
+    int count = 0;
+    for (auto energy : blockEnergies)
+    {
+        if (energy > absoluteGate)
+        {
+            sum += energy;
+            ++count;
+        }
+    }
+    if (count == 0)
+        return -std::numeric_limits<double>::infinity();
+
+    const double relativeGate = loudnessToEnergy(energyToLoudness(sum / (double)count) + relativeGateLu);
+    sum = 0.0;
+    count = 0;
+    for (auto energy : blockEnergies)
+    {
+        if (energy > absoluteGate && energy > relativeGate)
+        {
+            sum += energy;
+            ++count;
+        }
+    }
+    return count > 0 ? energyToLoudness(sum / (double)count) : -std::numeric_limits<double>::infinity();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Integrated loudness and true peak of audio fed in a block at a time, so a whole export
+// can be measured without holding it in memory.
+//
+// Loudness follows ITU-R BS.1770-4: each channel is K-weighted (a high shelf for the head
+// and a high-pass), mean squares are taken over 400 ms blocks overlapping by 75%, and
+// blocks are gated at -70 LUFS and then at 10 LU below the loudness of what is left. All
+// channels are weighted 1, which is right for mono and stereo.
+//
+// True peak is the largest magnitude after 4x oversampling (2x from 96 kHz, none from
+// 192 kHz) with a 48-tap interpolation filter, as in Annex 2 of the recommendation.
+class LoudnessMeter
+{
+public:
+    LoudnessMeter(double sampleRate, int numChannels);
+
+    void reset();
+    void process(const juce::AudioBuffer<float>& buffer);
+
+    // LUFS, or minus infinity when nothing was above the gate (silence, or less than 400 ms).
+    double getIntegratedLoudness() const;
+    // Linear magnitude; 1 is full scale.
+    float getTruePeak() const { return truePeak; }
+
+    static double truePeakToDecibels(float peak) { return peak > 0.0f ? 20.0 * std::log10((double)peak) : -std::numeric_limits<double>::infinity(); }
+
+private:
+    // Transposed direct form II, in double so the 38 Hz high-pass stays accurate.
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+        double z1 = 0.0, z2 = 0.0;
+
+        double process(double x)
+        {
+            const double y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    struct ChannelState
+    {
+        Biquad shelf;
+        Biquad highPass;
+        std::vector<float> history;  // last input samples, for the oversampling filter
+    };
+
+    void measureTruePeak(int channel, const float* input, int numSamples);
+    void finishSubBlock();
+
+    static constexpr int subBlocksPerBlock = 4;  // 100 ms steps of a 400 ms block
+
+    const int numChannels;
+    int oversampling = 4;
+    int tapsPerPhase = 12;
+    std::vector<std::vector<float>> phaseCoefficients;  // [phase][tap], tap 0 on the newest sample
+    std::vector<ChannelState> channels;
+    std::vector<float> oversampleInput;
+    std::vector<float> oversampleOutput;
+
+    int subBlockLength = 4410;
+    int subBlockFilled = 0;
+    double subBlockEnergy = 0.0;
+    std::array<double, subBlocksPerBlock> recentSubBlocks {};
+    int64 numSubBlocks = 0;
+    std::vector<double> blockEnergies;  // mean square of every 400 ms block
+    float truePeak = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeter)
+};
@@ -1,6 +1,8 @@
 #include "MainComponent.h"
 #include <cmath>
 #include <limits>
+#include <map>
+#include <set>
 #include <vector>
 
 namespace
@@ -124,14 +126,36 @@ void styleSectionLabel(juce::Label& label, const juce::String& text)
 class AudioSettingsPane : public juce::Component
 {
 public:
-    AudioSettingsPane(juce::AudioDeviceManager& deviceManagerIn, int bitDepthIn, std::function<void(int)> onBitDepthChangedIn)
+    AudioSettingsPane(juce::AudioDeviceManager& deviceManagerIn,
+                      int bitDepthIn,
+                      std::function<void(int)> onBitDepthChangedIn,
+                      int renderThreadsIn,
+                      int renderWaitPolicyIn,
+                      std::function<void(int, int)> onRenderSettingsChangedIn,
+                      int playbackInterpolationIn,
+                      int exportInterpolationIn,
+                      std::function<void(int, int)> onInterpolationChangedIn,
+                      int sampleEncodingIn,
+                      std::function<void(int)> onSampleEncodingChangedIn)
         : deviceSelector(deviceManagerIn, 0, 2, 0, 2, false, false, true, false),
-          onBitDepthChanged(std::move(onBitDepthChangedIn))
+          onBitDepthChanged(std::move(onBitDepthChangedIn)),
+          onRenderSettingsChanged(std::move(onRenderSettingsChangedIn)),
+          onInterpolationChanged(std::move(onInterpolationChangedIn)),
+          onSampleEncodingChanged(std::move(onSampleEncodingChangedIn))
     {
         addAndMakeVisible(deviceSelector);
         addAndMakeVisible(bitDepthLabel);
         addAndMakeVisible(bitDepthBox);
+        addAndMakeVisible(renderThreadsLabel);
+        addAndMakeVisible(renderThreadsBox);
+        addAndMakeVisible(renderWaitBox);
+        addAndMakeVisible(interpolationLabel);
+        addAndMakeVisible(playbackInterpolationBox);
+        addAndMakeVisible(exportInterpolationBox);
+        addAndMakeVisible(sampleEncodingLabel);
+        addAndMakeVisible(sampleEncodingBox);
         addAndMakeVisible(systemDefaultHint);
+        addAndMakeVisible(sampleMemoryLabel);
 
         bitDepthLabel.setText("Export Bit Depth", juce::dontSendNotification);
         bitDepthLabel.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.86f));
@@ -147,9 +171,66 @@ public:
                 onBitDepthChanged(bitDepthBox.getSelectedId());
         };
 
+        renderThreadsLabel.setText("Render Threads", juce::dontSendNotification);
+        renderThreadsLabel.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.86f));
+        renderThreadsLabel.setJustificationType(juce::Justification::centredLeft);
+
+        // Combo ids are offset by one because 0 means "nothing selected".
+        renderThreadsBox.addItem("Off", 1);
+        for (int threads = 1; threads <= juce::jmax(1, juce::SystemStats::getNumCpus() - 1); ++threads)
+            renderThreadsBox.addItem(juce::String(threads), threads + 1);
+        renderThreadsBox.setSelectedId(renderThreadsIn + 1, juce::dontSendNotification);
+        renderWaitBox.addItem("Spin", (int)RenderWorkerPool::WaitPolicy::spin);
+        renderWaitBox.addItem("Spin, then sleep", (int)RenderWorkerPool::WaitPolicy::spinThenSleep);
+        renderWaitBox.addItem("Sleep", (int)RenderWorkerPool::WaitPolicy::sleep);
+        renderWaitBox.setSelectedId(renderWaitPolicyIn, juce::dontSendNotification);
+        renderThreadsBox.onChange = [this]() { notifyRenderSettingsChanged(); };
+        renderWaitBox.onChange = [this]() { notifyRenderSettingsChanged(); };
+
+        interpolationLabel.setText("Interpolation", juce::dontSendNotification);
+        interpolationLabel.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.86f));
+        interpolationLabel.setJustificationType(juce::Justification::centredLeft);
+
+        for (auto* box : { &playbackInterpolationBox, &exportInterpolationBox })
+        {
+            const juce::String prefix = box == &playbackInterpolationBox ? "Playback: " : "Export: ";
+            box->addItem(prefix + "Linear", (int)Sample::Interpolation::linear);
+            box->addItem(prefix + "Cubic", (int)Sample::Interpolation::cubic);
+            box->addItem(prefix + "Sinc", (int)Sample::Interpolation::sinc);
+            box->onChange = [this]() { notifyInterpolationChanged(); };
+        }
+        playbackInterpolationBox.setSelectedId(playbackInterpolationIn, juce::dontSendNotification);
+        exportInterpolationBox.setSelectedId(exportInterpolationIn, juce::dontSendNotification);
+
+        sampleEncodingLabel.setText("Sample Memory", juce::dontSendNotification);
+        sampleEncodingLabel.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.86f));
+        sampleEncodingLabel.setJustificationType(juce::Justification::centredLeft);
+
+        // Combo ids are offset by one because 0 means "nothing selected".
+        sampleEncodingBox.addItem("Match source bit depth", (int)Sample::Encoding::automatic + 1);
+        sampleEncodingBox.addItem("32-bit float", (int)Sample::Encoding::float32 + 1);
+        sampleEncodingBox.addItem("16-bit", (int)Sample::Encoding::int16 + 1);
+        sampleEncodingBox.addItem("24-bit", (int)Sample::Encoding::int24 + 1);
+        sampleEncodingBox.setSelectedId(sampleEncodingIn + 1, juce::dontSendNotification);
+        sampleEncodingBox.setTooltip("How this project keeps decoded samples in memory");
+        sampleEncodingBox.onChange = [this]()
+        {
+            if (onSampleEncodingChanged && sampleEncodingBox.getSelectedId() > 0)
+                onSampleEncodingChanged(sampleEncodingBox.getSelectedId() - 1);
+        };
+
         systemDefaultHint.setText("Audio device defaults to system output unless changed here.", juce::dontSendNotification);
         systemDefaultHint.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.62f));
         systemDefaultHint.setJustificationType(juce::Justification::centredLeft);
+        sampleMemoryLabel.setColour(juce::Label::textColourId, juce::Colours::white.withAlpha(0.62f));
+        sampleMemoryLabel.setJustificationType(juce::Justification::centredLeft);
+    }
+
+    void setSampleMemoryUsage(int numSamples, int64 bytes)
+    {
+        sampleMemoryLabel.setText("Sample pool: " + juce::String(numSamples) + (numSamples == 1 ? " file, " : " files, ")
+                                      + juce::File::descriptionOfSizeInBytes(bytes) + " decoded audio.",
+                                  juce::dontSendNotification);
     }
 
     void resized() override
@@ -158,17 +239,58 @@ public:
         auto topRow = area.removeFromTop(28);
         bitDepthLabel.setBounds(topRow.removeFromLeft(140));
         bitDepthBox.setBounds(topRow.removeFromLeft(100));
+        area.removeFromTop(6);
+        auto renderRow = area.removeFromTop(28);
+        renderThreadsLabel.setBounds(renderRow.removeFromLeft(140));
+        renderThreadsBox.setBounds(renderRow.removeFromLeft(100));
+        renderRow.removeFromLeft(8);
+        renderWaitBox.setBounds(renderRow.removeFromLeft(150));
+        area.removeFromTop(6);
+        auto interpolationRow = area.removeFromTop(28);
+        interpolationLabel.setBounds(interpolationRow.removeFromLeft(140));
+        playbackInterpolationBox.setBounds(interpolationRow.removeFromLeft(150));
+        interpolationRow.removeFromLeft(8);
+        exportInterpolationBox.setBounds(interpolationRow.removeFromLeft(150));
+        area.removeFromTop(6);
+        auto encodingRow = area.removeFromTop(28);
+        sampleEncodingLabel.setBounds(encodingRow.removeFromLeft(140));
+        sampleEncodingBox.setBounds(encodingRow.removeFromLeft(200));
         systemDefaultHint.setBounds(area.removeFromTop(22));
+        sampleMemoryLabel.setBounds(area.removeFromTop(22));
         area.removeFromTop(6);
         deviceSelector.setBounds(area);
     }
 
 private:
+    void notifyRenderSettingsChanged()
+    {
+        if (onRenderSettingsChanged && renderThreadsBox.getSelectedId() > 0 && renderWaitBox.getSelectedId() > 0)
+            onRenderSettingsChanged(renderThreadsBox.getSelectedId() - 1, renderWaitBox.getSelectedId());
+    }
+
+    void notifyInterpolationChanged()
+    {
+        if (onInterpolationChanged && playbackInterpolationBox.getSelectedId() > 0 && exportInterpolationBox.getSelectedId() > 0)
+            onInterpolationChanged(playbackInterpolationBox.getSelectedId(), exportInterpolationBox.getSelectedId());
+    }
+
     juce::AudioDeviceSelectorComponent deviceSelector;
     juce::Label bitDepthLabel;
     juce::ComboBox bitDepthBox;
+    juce::Label renderThreadsLabel;
+    juce::ComboBox renderThreadsBox;
+    juce::ComboBox renderWaitBox;
+    juce::Label interpolationLabel;
+    juce::ComboBox playbackInterpolationBox;
+    juce::ComboBox exportInterpolationBox;
+    juce::Label sampleEncodingLabel;
+    juce::ComboBox sampleEncodingBox;
     juce::Label systemDefaultHint;
+    juce::Label sampleMemoryLabel;
     std::function<void(int)> onBitDepthChanged;
+    std::function<void(int, int)> onRenderSettingsChanged;
+    std::function<void(int, int)> onInterpolationChanged;
+    std::function<void(int)> onSampleEncodingChanged;
 };
 }
 
@@ -186,6 +308,8 @@ MainComponent::MainComponent()
     addAndMakeVisible(projectButton);
     addAndMakeVisible(addTrackButton);
     addAndMakeVisible(settingsButton);
+    addChildComponent(sampleLoadProgressBar);
+    addChildComponent(cancelSampleLoadButton);
     addAndMakeVisible(snapToggle);
     addAndMakeVisible(snapDivisionBox);
     addAndMakeVisible(transportSectionLabel);
@@ -210,6 +334,7 @@ MainComponent::MainComponent()
     projectButton.addListener(this);
     addTrackButton.addListener(this);
     settingsButton.addListener(this);
+    cancelSampleLoadButton.addListener(this);
 
     styleSectionLabel(transportSectionLabel, "Transport");
     styleSectionLabel(mediaSectionLabel, "Media");
@@ -226,6 +351,9 @@ MainComponent::MainComponent()
     styleToolbarButton(projectButton, juce::Colour(62, 68, 84), false);
     styleToolbarButton(addTrackButton, juce::Colour(62, 68, 84), false);
     styleToolbarButton(settingsButton, juce::Colour(62, 68, 84), false);
+    styleToolbarButton(cancelSampleLoadButton, juce::Colour(62, 68, 84), false);
+    sampleLoadProgressBar.setTextToDisplay("Loading samples");
+    cancelSampleLoadButton.setTooltip("Stop loading samples; clips not loaded yet stay silent");
     playButton.setTooltip("Play from start");
     stopButton.setTooltip("Stop and return playhead to start");
     scissorsButton.setTooltip("Scissors tool (X): split and trim clips");
@@ -312,6 +440,7 @@ MainComponent::MainComponent()
     {
         applyFitSettingsToSelectedClip(fitLengthUnits, fitToSnapDivision);
     });
+    beatSlicer.setAnalyser(&sampleAnalyser);
     beatSlicer.onSlicingChanged([this](const BeatSlicingSettings& slicing)
     {
         applySlicingToSelectedClip(slicing);
@@ -405,6 +534,10 @@ MainComponent::MainComponent()
     {
         performUndo();
     });
+    arrangementView.onRedoRequested([this]()
+    {
+        performRedo();
+    });
     arrangementView.onCopyRequested([this]()
     {
         performCopy();
@@ -435,6 +568,8 @@ MainComponent::MainComponent()
     updateTrackControlsFromSelection();
 
     loadAppSettings();
+    applyRenderSettings();
+    samplePool.setPeakCacheDirectory(getAppSettingsFile().getSiblingFile("PeakCache"));
     setAudioChannels(0, 2);
     if (pendingAudioDeviceState != nullptr)
     {
@@ -449,6 +584,7 @@ MainComponent::MainComponent()
 MainComponent::~MainComponent()
 {
     stopTimer();
+    sampleLoader.reset();
     saveAppSettings();
     shutdownAudio();
 }
@@ -457,6 +593,19 @@ void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate
 {
     sampleRate = sampleRateIn;
     engine.prepare(sampleRate, samplesPerBlockExpected);
+
+    // Samples at another rate are converted to the device rate in the background.
+    if (samplePool.getPlaybackSampleRate() != sampleRate)
+    {
+        samplePool.setPlaybackSampleRate(sampleRate);
+        juce::Component::SafePointer<MainComponent> safeThis(this);
+        juce::MessageManager::callAsync([safeThis]()
+        {
+            if (safeThis != nullptr)
+                safeThis->convertSamplesToPlaybackRate();
+        });
+    }
+
     arrangementView.setTracks(&engine.getTracks(), sampleRate);
     updateArrangementViewportBounds();
 }
@@ -553,6 +702,12 @@ void MainComponent::resized()
     projectControls.removeFromLeft(buttonGap);
     settingsButton.setBounds(projectControls.removeFromLeft(98));
 
+    controlsRow.removeFromLeft(sectionGap);
+    auto loadingControls = controlsRow.removeFromLeft(juce::jmin(260, controlsRow.getWidth()));
+    cancelSampleLoadButton.setBounds(loadingControls.removeFromRight(70));
+    loadingControls.removeFromRight(buttonGap);
+    sampleLoadProgressBar.setBounds(loadingControls);
+
     area.removeFromTop(6);
     auto bottom = area.removeFromBottom(220).reduced(padding);
     auto panelArea = bottom.removeFromRight(300);
@@ -680,12 +835,16 @@ void MainComponent::buttonClicked(juce::Button* button)
     {
         showAudioSettingsDialog();
     }
+    else if (button == &cancelSampleLoadButton)
+    {
+        cancelSampleLoading();
+    }
     else if (button == &addTrackButton)
     {
         pushUndoState();
         int newTrackIndex = -1;
         {
-            juce::ScopedLock lock(engine.getTrackLock());
+            AudioEngine::ScopedTrackEdit edit(engine);
             const int nextIndex = engine.getTracks().size() + 1;
             engine.addTrack("Track " + juce::String(nextIndex));
             selectedTrackIndex = engine.getTracks().size() - 1;
@@ -716,6 +875,12 @@ bool MainComponent::keyPressed(const juce::KeyPress& key)
         return true;
     }
 
+    if (mods.isCommandDown() && ((mods.isShiftDown() && (kc == 'z' || kc == 'Z')) || kc == 'y' || kc == 'Y'))
+    {
+        performRedo();
+        return true;
+    }
+
     if (mods.isCommandDown() && (kc == 'z' || kc == 'Z'))
     {
         performUndo();
@@ -779,16 +944,16 @@ void MainComponent::showLoadDialog()
         juce::File{},
         "*.wav");
 
-    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    auto flags = juce::FileBrowserComponent::openMode
+               | juce::FileBrowserComponent::canSelectFiles
+               | juce::FileBrowserComponent::canSelectMultipleItems;
     juce::Component::SafePointer<MainComponent> safeThis(this);
     fileChooser->launchAsync(flags, [safeThis](const juce::FileChooser& chooser)
     {
         if (safeThis == nullptr)
             return;
 
-        const auto file = chooser.getResult();
-        if (file.existsAsFile())
-            safeThis->addSampleToTrack(file);
+        safeThis->addSampleFiles(chooser.getResults());
     });
 }
 
@@ -797,7 +962,7 @@ void MainComponent::showSaveProjectDialog()
     projectFileChooser = std::make_unique<juce::FileChooser>(
         "Save Project",
         juce::File{},
-        "*.drdproj");
+        "*.drdproj;*.json");
 
     auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles;
     juce::Component::SafePointer<MainComponent> safeThis(this);
@@ -809,7 +974,7 @@ void MainComponent::showSaveProjectDialog()
         auto file = chooser.getResult();
         if (file == juce::File{})
             return;
-        if (!file.hasFileExtension(".drdproj"))
+        if (!file.hasFileExtension(".drdproj") && !file.hasFileExtension(".json"))
             file = file.withFileExtension(".drdproj");
 
         safeThis->saveProjectToFile(file);
@@ -821,7 +986,7 @@ void MainComponent::showLoadProjectDialog()
     projectFileChooser = std::make_unique<juce::FileChooser>(
         "Load Project",
         juce::File{},
-        "*.drdproj");
+        "*.drdproj;*.json");
 
     auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
     juce::Component::SafePointer<MainComponent> safeThis(this);
@@ -847,7 +1012,31 @@ void MainComponent::showAudioSettingsDialog()
                                                        {
                                                            exportBitDepth = juce::jlimit(16, 32, bitDepth);
                                                            saveAppSettings();
+                                                       },
+                                                       renderThreadCount,
+                                                       renderWaitPolicyId,
+                                                       [this](int threads, int waitPolicyId)
+                                                       {
+                                                           renderThreadCount = threads;
+                                                           renderWaitPolicyId = waitPolicyId;
+                                                           applyRenderSettings();
+                                                           saveAppSettings();
+                                                       },
+                                                       playbackInterpolationId,
+                                                       exportInterpolationId,
+                                                       [this](int playbackId, int exportId)
+                                                       {
+                                                           playbackInterpolationId = playbackId;
+                                                           exportInterpolationId = exportId;
+                                                           applyRenderSettings();
+                                                           saveAppSettings();
+                                                       },
+                                                       (int)samplePool.getEncoding(),
+                                                       [this](int encodingId)
+                                                       {
+                                                           setSampleEncoding((Sample::Encoding)encodingId);
                                                        });
+    content->setSampleMemoryUsage(samplePool.getNumSamples(), samplePool.getMemoryUsageBytes());
 
     juce::DialogWindow::LaunchOptions options;
     options.dialogTitle = "Audio Settings";
@@ -857,10 +1046,39 @@ void MainComponent::showAudioSettingsDialog()
     options.resizable = true;
     options.componentToCentreAround = this;
     options.content.setOwned(content.release());
-    options.content->setSize(600, 460);
+    options.content->setSize(600, 590);
     options.launchAsync();
 }
 
+void MainComponent::setSampleEncoding(Sample::Encoding newEncoding)
+{
+    if (samplePool.getEncoding() == newEncoding)
+        return;
+
+    // Clips keep playing the audio they have until the pool hands out the same file under
+    // the new encoding: straight away when it still holds a copy, otherwise once the
+    // background loader has decoded it again. Nothing is removed from the arrangement.
+    samplePool.setEncoding(newEncoding);
+
+    std::map<juce::String, std::shared_ptr<const Sample>> decodedSamples;
+    for (const auto& track : engine.getTracks())
+        for (const auto& clip : track.getClips())
+            if (clip.sample != nullptr && decodedSamples.count(clip.sourceFilePath) == 0)
+                decodedSamples.emplace(clip.sourceFilePath, samplePool.findSample(juce::File(clip.sourceFilePath)));
+    replaceClipSamples(decodedSamples);
+
+    const auto paths = getClipSamplesToLoad(isLoadingSamples());
+    if (!paths.isEmpty())
+        startSampleLoading(paths);
+}
+
+void MainComponent::applyRenderSettings()
+{
+    engine.setRenderWaitPolicy((RenderWorkerPool::WaitPolicy)renderWaitPolicyId);
+    engine.setRenderThreadCount(renderThreadCount);
+    engine.setInterpolation((Sample::Interpolation)playbackInterpolationId);
+}
+
 juce::File MainComponent::getAppSettingsFile() const
 {
     auto dir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
@@ -882,6 +1100,10 @@ void MainComponent::loadAppSettings()
 
     if (root->hasAttribute("exportBitDepth"))
         exportBitDepth = juce::jlimit(16, 32, root->getIntAttribute("exportBitDepth", exportBitDepth));
+    renderThreadCount = juce::jlimit(0, 32, root->getIntAttribute("renderThreads", renderThreadCount));
+    renderWaitPolicyId = juce::jlimit(1, 3, root->getIntAttribute("renderWaitPolicy", renderWaitPolicyId));
+    playbackInterpolationId = juce::jlimit(1, 3, root->getIntAttribute("playbackInterpolation", playbackInterpolationId));
+    exportInterpolationId = juce::jlimit(1, 3, root->getIntAttribute("exportInterpolation", exportInterpolationId));
 
     if (auto* audioState = root->getChildByName("audioDeviceState"))
         pendingAudioDeviceState = std::make_unique<juce::XmlElement>(*audioState);
@@ -892,6 +1114,10 @@ void MainComponent::saveAppSettings() const
     juce::XmlElement root("MMMSampleSettings");
     root.setAttribute("version", 1);
     root.setAttribute("exportBitDepth", exportBitDepth);
+    root.setAttribute("renderThreads", renderThreadCount);
+    root.setAttribute("renderWaitPolicy", renderWaitPolicyId);
+    root.setAttribute("playbackInterpolation", playbackInterpolationId);
+    root.setAttribute("exportInterpolation", exportInterpolationId);
 
     if (auto state = deviceManager.createStateXml())
     {
@@ -904,25 +1130,55 @@ void MainComponent::saveAppSettings() const
     file.replaceWithText(root.toString(), false, false, "\n");
 }
 
-void MainComponent::addSampleToTrack(const juce::File& file)
+void MainComponent::addSampleFiles(const juce::Array<juce::File>& files)
 {
-    auto sample = std::make_shared<Sample>();
-    if (!sample->loadFromFile(file))
+    juce::Array<juce::File> sampleFiles;
+    for (const auto& file : files)
+        if (file.existsAsFile())
+            sampleFiles.add(file);
+
+    if (sampleFiles.size() == 1)
+    {
+        addSampleToTrack(sampleFiles.getFirst());
         return;
+    }
+    if (sampleFiles.isEmpty())
+        return;
+
+    // Several files go on consecutive tracks from the selected one, as a single undo step.
     pushUndoState();
+    const juce::ScopedValueSetter<bool> undoGuard(isApplyingUndo, true);
+    const int firstTrackIndex = juce::jmax(0, selectedTrackIndex);
+    for (int i = 0; i < sampleFiles.size(); ++i)
+        addSampleToTrack(sampleFiles.getReference(i), firstTrackIndex + i);
+}
+
+void MainComponent::addSampleToTrack(const juce::File& file, int trackIndex)
+{
+    // The clip starts on the file's own rate; a converted copy replaces it in the background.
+    auto sample = samplePool.findSample(file);
+    if (sample == nullptr)
+        sample = samplePool.getSourceSample(file);
+    if (sample == nullptr)
+        return;
+    pushUndoState();
+    importUndoSerial = undoSerial;
 
     int newTrackIndex = 0;
     int newClipIndex = -1;
     WarpCurve clipCurve = WarpCurve::linear();
     int64 clipStartSample = 0;
     int64 clipLengthSamples = (int64)(sampleRate * 2.0);
+    int beatsPerBar = 4;
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         if (engine.getTracks().isEmpty())
             engine.addTrack("Track 1");
+        while (trackIndex >= engine.getTracks().size())
+            engine.addTrack("Track " + juce::String(engine.getTracks().size() + 1));
 
-        newTrackIndex = selectedTrackIndex;
+        newTrackIndex = trackIndex >= 0 ? trackIndex : selectedTrackIndex;
         if (newTrackIndex < 0 || newTrackIndex >= engine.getTracks().size())
             newTrackIndex = 0;
 
@@ -931,6 +1187,7 @@ void MainComponent::addSampleToTrack(const juce::File& file)
         clipLengthSamples = track.getBarLengthSamples(sampleRate);
         if (clipLengthSamples <= 0)
             clipLengthSamples = (int64)(sampleRate * 2.0);
+        beatsPerBar = track.getTimeSigNumerator();
 
         TrackClip clip;
         clip.name = file.getFileNameWithoutExtension();
@@ -958,6 +1215,130 @@ void MainComponent::addSampleToTrack(const juce::File& file)
     curveEditor.setCurve(clipCurve);
     warpPanel.setCurve(clipCurve);
     warpPanel.setFitSettings(1, false);
+    convertSamplesToPlaybackRate();
+    estimateClipTempo(sample, file.getFullPathName(), newTrackIndex, clipStartSample, beatsPerBar);
+}
+
+void MainComponent::estimateClipTempo(const std::shared_ptr<const Sample>& sample, const juce::String& filePath,
+                                      int trackIndex, int64 clipStartSample, int beatsPerBar)
+{
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    sampleAnalyser.requestOnsets(sample, SampleAnalyser::Priority::background,
+                                 [safeThis, filePath, trackIndex, clipStartSample, beatsPerBar](std::shared_ptr<const OnsetAnalysis> onsets)
+    {
+        if (safeThis == nullptr || onsets == nullptr)
+            return;
+
+        const auto estimate = TempoEstimate::fromOnsets(*onsets, beatsPerBar);
+        if (estimate.valid)
+            safeThis->applyTempoEstimate(filePath, trackIndex, clipStartSample, estimate);
+    });
+}
+
+void MainComponent::applyTempoEstimate(const juce::String& filePath, int trackIndex, int64 clipStartSample, const TempoEstimate& estimate)
+{
+    auto& tracks = engine.getTracks();
+    if (trackIndex < 0 || trackIndex >= tracks.size())
+        return;
+
+    // Only the clip addSampleToTrack() created is fitted, and only while it is still as it
+    // was left there; once the user has moved, trimmed, fitted or sliced it, it is kept.
+    const auto& track = tracks.getReference(trackIndex);
+    const int64 barSamples = track.getBarLengthSamples(sampleRate);
+    const auto& clips = track.getClips();
+    int clipIndex = -1;
+    for (int c = 0; c < clips.size() && clipIndex < 0; ++c)
+    {
+        const auto& clip = clips.getReference(c);
+        if (clip.sourceFilePath == filePath && clip.startSample == clipStartSample
+            && clip.fitLengthUnits == 1 && !clip.fitToSnapDivision && clip.slicing.slices.isEmpty()
+            && clip.lengthSamples == barSamples && clip.sourceStartNorm == 0.0f && clip.sourceEndNorm == 1.0f)
+            clipIndex = c;
+    }
+    if (clipIndex < 0)
+        return;
+
+    const int64 snapSamples = track.getSnapLengthSamples(sampleRate);
+    const int beatsPerBar = juce::jmax(1, track.getTimeSigNumerator());
+
+    // Snap units per beat, as a fraction; a bar is not a whole number of them.
+    int snapsPerBeat = 1, beatsPerSnap = 1;
+    switch (track.getSnapDivision())
+    {
+        case Track::SnapDivision::bar:
+            beatsPerSnap = beatsPerBar;
+            break;
+        case Track::SnapDivision::beat:
+            break;
+        case Track::SnapDivision::eighth:
+            snapsPerBeat = 2;
+            break;
+        case Track::SnapDivision::thirtySecond:
+            snapsPerBeat = 8;
+            break;
+        case Track::SnapDivision::eighthTriplet:
+            snapsPerBeat = 3;
+            beatsPerSnap = 2;
+            break;
+        case Track::SnapDivision::sixteenthTriplet:
+            snapsPerBeat = 3;
+            break;
+        default:
+            snapsPerBeat = 4;
+            break;
+    }
+
+    // The length is a whole number of beats, so it is fitted in bars when it fills them and
+    // otherwise in snap units only when the beats are a whole number of those. When neither
+    // holds (an odd beat count with bar snap, say) the clip is left as it is, rather than
+    // fitted to a rounded, wrong length.
+    TrackClip fitted = clips.getReference(clipIndex);
+    if (estimate.numBeats % beatsPerBar == 0)
+    {
+        fitted.fitLengthUnits = estimate.numBeats / beatsPerBar;
+        fitted.fitToSnapDivision = false;
+    }
+    else if ((estimate.numBeats * snapsPerBeat) % beatsPerSnap == 0)
+    {
+        fitted.fitLengthUnits = juce::jmax(1, estimate.numBeats * snapsPerBeat / beatsPerSnap);
+        fitted.fitToSnapDivision = true;
+    }
+    else
+    {
+        return;
+    }
+    const int64 unitSamples = fitted.fitToSnapDivision ? snapSamples : barSamples;
+    fitted.lengthSamples = juce::jmax<int64>(1, unitSamples * (int64)fitted.fitLengthUnits);
+
+    // One slice per beat, or per bar for long files, ready for the beat slicer.
+    const int sliceBeats = estimate.numBeats <= 32 ? 1 : beatsPerBar;
+    const int numSlices = estimate.numBeats / sliceBeats;
+    if (numSlices >= 2 && numSlices <= 32)
+    {
+        for (int i = 0; i < numSlices; ++i)
+        {
+            BeatSlice slice;
+            slice.startNorm = (double)i / (double)numSlices;
+            slice.endNorm = (double)(i + 1) / (double)numSlices;
+            fitted.slicing.slices.add(slice);
+        }
+    }
+
+    // Nothing but imports has been recorded since this clip was added, so the fit belongs to
+    // the latest import's undo step. After any other edit it is a step of its own, so undoing
+    // that edit cannot also take back the fit.
+    if (undoSerial != importUndoSerial)
+        pushUndoState();
+    {
+        AudioEngine::ScopedTrackEdit edit(engine);
+        tracks.getReference(trackIndex).updateClip(clipIndex, fitted);
+    }
+
+    if (trackIndex == selectedTrackIndex && clipIndex == selectedClipIndex)
+        warpPanel.setFitSettings(fitted.fitLengthUnits, fitted.fitToSnapDivision);
+    arrangementView.refreshTrackControls();
+    updateArrangementViewportBounds();
+    arrangementView.repaint();
 }
 
 juce::var MainComponent::createProjectStateVar()
@@ -970,13 +1351,13 @@ juce::var MainComponent::createProjectStateVar()
     rootObj->setProperty("version", 1);
     rootObj->setProperty("sampleRate", sampleRate);
     rootObj->setProperty("exportBitDepth", exportBitDepth);
+    rootObj->setProperty("sampleEncoding", (int)samplePool.getEncoding());
     rootObj->setProperty("selectedTrackIndex", selectedTrackIndex);
     rootObj->setProperty("selectedClipIndex", selectedClipIndex);
     rootObj->setProperty("playheadSample", engine.getPlayheadSample());
 
     juce::Array<juce::var> tracksArray;
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         const auto& tracks = engine.getTracks();
         for (const auto& track : tracks)
         {
@@ -1057,8 +1438,24 @@ juce::var MainComponent::createProjectStateVar()
     return rootObjVar;
 }
 
+ProjectSettings MainComponent::getProjectSettings() const
+{
+    ProjectSettings settings;
+    settings.sampleRate = sampleRate;
+    settings.exportBitDepth = exportBitDepth;
+    settings.sampleEncoding = samplePool.getEncoding();
+    settings.selectedTrackIndex = selectedTrackIndex;
+    settings.selectedClipIndex = selectedClipIndex;
+    settings.playheadSample = engine.getPlayheadSample();
+    return settings;
+}
+
 bool MainComponent::saveProjectToFile(const juce::File& file)
 {
+    // JSON is kept as an interchange format; everything else is saved in the binary format.
+    if (!file.hasFileExtension(".json"))
+        return ProjectFile::save(file, getProjectSettings(), engine.getTracks());
+
     const auto rootObjVar = createProjectStateVar();
     if (rootObjVar.isVoid())
         return false;
@@ -1076,8 +1473,13 @@ bool MainComponent::loadProjectFromVar(const juce::var& parsed, bool preserveScr
     if (!tracksVar.isArray())
         return false;
 
+    ProjectSettings settings = getProjectSettings();
     if (rootObj->hasProperty("exportBitDepth"))
-        exportBitDepth = juce::jlimit(16, 32, (int)rootObj->getProperty("exportBitDepth"));
+        settings.exportBitDepth = juce::jlimit(16, 32, (int)rootObj->getProperty("exportBitDepth"));
+    settings.sampleEncoding = (Sample::Encoding)juce::jlimit(0, 3, (int)rootObj->getProperty("sampleEncoding"));
+    settings.selectedTrackIndex = (int)rootObj->getProperty("selectedTrackIndex");
+    settings.selectedClipIndex = (int)rootObj->getProperty("selectedClipIndex");
+    settings.playheadSample = (int64)(double)rootObj->getProperty("playheadSample");
 
     juce::Array<Track> loadedTracks;
     auto* tracksArray = tracksVar.getArray();
@@ -1141,6 +1543,7 @@ bool MainComponent::loadProjectFromVar(const juce::var& parsed, bool preserveScr
         const auto clipsVar = trackObj->getProperty("clips");
         if (clipsVar.isArray())
         {
+            juce::Array<TrackClip> clips;
             auto* clipsArray = clipsVar.getArray();
             for (const auto& clipVar : *clipsArray)
             {
@@ -1148,19 +1551,9 @@ bool MainComponent::loadProjectFromVar(const juce::var& parsed, bool preserveScr
                 if (clipObj == nullptr)
                     continue;
 
-                const juce::String sourcePath = clipObj->getProperty("sourceFilePath").toString();
-                const juce::File sampleFile(sourcePath);
-                if (!sampleFile.existsAsFile())
-                    continue;
-
-                auto sample = std::make_shared<Sample>();
-                if (!sample->loadFromFile(sampleFile))
-                    continue;
-
                 TrackClip clip;
                 clip.name = clipObj->getProperty("name").toString();
-                clip.sourceFilePath = sourcePath;
-                clip.sample = sample;
+                clip.sourceFilePath = clipObj->getProperty("sourceFilePath").toString();
                 clip.startSample = (int64)(double)clipObj->getProperty("startSample");
                 clip.lengthSamples = (int64)(double)clipObj->getProperty("lengthSamples");
                 if (clipObj->hasProperty("sourceStartNorm"))
@@ -1200,15 +1593,67 @@ bool MainComponent::loadProjectFromVar(const juce::var& parsed, bool preserveScr
                         clip.slicing.slices.add(s);
                     }
                 }
-                track.addClip(clip);
+                clips.add(clip);
             }
+            track.setClips(clips);
         }
 
         loadedTracks.add(track);
     }
 
+    return applyLoadedProject(settings, loadedTracks, preserveScroll);
+}
+
+bool MainComponent::applyLoadedProject(const ProjectSettings& settings, juce::Array<Track>& loadedTracks, bool preserveScroll)
+{
+    // Samples are looked up under the project's encoding.
+    samplePool.setEncoding(settings.sampleEncoding);
+
+    // Clips whose audio is already decoded get it straight away; the rest are added without
+    // a sample and filled in by the background loader, so the project appears immediately.
+    // Clips whose file is gone are dropped. Each file is looked up once, however many clips use it.
+    std::map<juce::String, std::shared_ptr<const Sample>> foundSamples;
+    juce::StringArray missingFiles;
+    for (auto& track : loadedTracks)
+    {
+        juce::Array<TrackClip> clips;
+        clips.ensureStorageAllocated(track.getClips().size());
+        for (auto clip : track.getClips())
+        {
+            const auto found = foundSamples.find(clip.sourceFilePath);
+            if (found != foundSamples.end())
+            {
+                clip.sample = found->second;
+            }
+            else
+            {
+                if (missingFiles.contains(clip.sourceFilePath))
+                    continue;
+                const juce::File sampleFile(clip.sourceFilePath);
+                if (!sampleFile.existsAsFile())
+                {
+                    missingFiles.add(clip.sourceFilePath);
+                    continue;
+                }
+                clip.sample = samplePool.findSample(sampleFile);
+                foundSamples.emplace(clip.sourceFilePath, clip.sample);
+            }
+            clips.add(std::move(clip));
+        }
+        track.setClips(clips);
+    }
+
+    return applyProjectState(settings, loadedTracks, preserveScroll);
+}
+
+bool MainComponent::applyProjectState(const ProjectSettings& settings, const juce::Array<Track>& loadedTracks, bool preserveScroll)
+{
+    exportBitDepth = juce::jlimit(16, 32, settings.exportBitDepth);
+    samplePool.setEncoding(settings.sampleEncoding);
+
+    cancelSampleLoading();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         engine.getTracks().clear();
         for (const auto& t : loadedTracks)
             engine.getTracks().add(t);
@@ -1216,16 +1661,13 @@ bool MainComponent::loadProjectFromVar(const juce::var& parsed, bool preserveScr
         if (engine.getTracks().isEmpty())
             engine.getTracks().add(Track("Track 1"));
     }
+    cancelUnusedAnalysis();
 
-    int trackCountAfterLoad = 0;
-    {
-        juce::ScopedLock lock(engine.getTrackLock());
-        trackCountAfterLoad = engine.getTracks().size();
-    }
+    const int trackCountAfterLoad = engine.getTracks().size();
 
-    selectedTrackIndex = juce::jlimit(0, juce::jmax(0, trackCountAfterLoad - 1), (int)rootObj->getProperty("selectedTrackIndex"));
-    selectedClipIndex = (int)rootObj->getProperty("selectedClipIndex");
-    engine.setPlayheadSample((int64)(double)rootObj->getProperty("playheadSample"));
+    selectedTrackIndex = juce::jlimit(0, juce::jmax(0, trackCountAfterLoad - 1), settings.selectedTrackIndex);
+    selectedClipIndex = settings.selectedClipIndex;
+    engine.setPlayheadSample(settings.playheadSample);
 
     const int previousScrollY = arrangementViewport.getViewPositionY();
     arrangementView.setTracks(&engine.getTracks(), sampleRate);
@@ -1241,7 +1683,6 @@ bool MainComponent::loadProjectFromVar(const juce::var& parsed, bool preserveScr
 
     WarpCurve selectionCurve = WarpCurve::linear();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         if (selectedTrackIndex >= 0 && selectedTrackIndex < engine.getTracks().size())
         {
             const auto& clips = engine.getTracks().getReference(selectedTrackIndex).getClips();
@@ -1256,21 +1697,169 @@ bool MainComponent::loadProjectFromVar(const juce::var& parsed, bool preserveScr
     warpPanel.setCurve(selectionCurve);
     if (selectedTrackIndex >= 0 && selectedTrackIndex < engine.getTracks().size() && selectedClipIndex >= 0)
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         const auto& clips = engine.getTracks().getReference(selectedTrackIndex).getClips();
         if (selectedClipIndex >= 0 && selectedClipIndex < clips.size())
             warpPanel.setFitSettings(clips.getReference(selectedClipIndex).fitLengthUnits,
                                      clips.getReference(selectedClipIndex).fitToSnapDivision);
     }
     updateTrackControlsFromSelection();
+
+    const auto pendingSamplePaths = getClipSamplesToLoad(true);
+    if (!pendingSamplePaths.isEmpty())
+        startSampleLoading(pendingSamplePaths);
     return true;
 }
 
+juce::StringArray MainComponent::getClipSamplesToLoad(bool includeMissing) const
+{
+    // A clip also needs loading when the pool would now hand out different audio for its
+    // file, e.g. after the sample encoding changed. Files that are gone keep what they have.
+    std::map<juce::String, bool> isCurrent;
+    const auto isCurrentSample = [this, &isCurrent](const TrackClip& clip)
+    {
+        auto found = isCurrent.find(clip.sourceFilePath);
+        if (found == isCurrent.end())
+        {
+            const juce::File file(clip.sourceFilePath);
+            const bool current = !file.existsAsFile() || samplePool.findSample(file) == clip.sample;
+            found = isCurrent.emplace(clip.sourceFilePath, current).first;
+        }
+        return found->second;
+    };
+
+    juce::StringArray paths;
+    for (const auto& track : engine.getTracks())
+        for (const auto& clip : track.getClips())
+            if (clip.sample == nullptr ? includeMissing : (samplePool.needsConversion(*clip.sample) || !isCurrentSample(clip)))
+                paths.addIfNotAlreadyThere(clip.sourceFilePath);
+    return paths;
+}
+
+void MainComponent::convertSamplesToPlaybackRate()
+{
+    // Restarting the loader drops its queue, so files still waiting to load go back in too.
+    const auto paths = getClipSamplesToLoad(isLoadingSamples());
+    if (!paths.isEmpty())
+        startSampleLoading(paths);
+}
+
+void MainComponent::startSampleLoading(const juce::StringArray& filePaths)
+{
+    cancelSampleLoading();
+    sampleLoader.reset();
+
+    sampleLoadProgress = 0.0;
+    sampleLoadFailures = 0;
+    sampleLoader = std::make_unique<SampleLoader>(samplePool, filePaths, juce::SystemStats::getNumCpus());
+
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    sampleLoader->onPeaksLoaded = [safeThis](const juce::String& filePath, std::shared_ptr<const SamplePeaks> peaks)
+    {
+        if (safeThis != nullptr)
+            safeThis->arrangementView.setPendingPeaks(filePath, std::move(peaks));
+    };
+    sampleLoader->onSampleLoaded = [safeThis](const juce::String& filePath, std::shared_ptr<const Sample> sample)
+    {
+        if (safeThis != nullptr)
+            safeThis->applyLoadedSample(filePath, sample);
+    };
+    sampleLoader->onFinished = [safeThis](bool wasCancelled)
+    {
+        if (safeThis != nullptr)
+            safeThis->sampleLoadingFinished(wasCancelled);
+    };
+
+    arrangementView.setSamplesLoading(true);
+    sampleLoadProgressBar.setVisible(true);
+    cancelSampleLoadButton.setVisible(true);
+}
+
+void MainComponent::cancelSampleLoading()
+{
+    if (isLoadingSamples())
+        sampleLoader->cancel();
+}
+
+void MainComponent::applyLoadedSample(const juce::String& filePath, const std::shared_ptr<const Sample>& sample)
+{
+    sampleLoadProgress = sampleLoader != nullptr ? sampleLoader->getProgress() : 1.0;
+
+    // A file that fails to decode leaves its clips in place without audio, so saving the
+    // project does not lose them. Clips already playing the original keep it.
+    if (sample == nullptr)
+    {
+        ++sampleLoadFailures;
+        return;
+    }
+
+    replaceClipSamples({ { filePath, sample } });
+    arrangementView.repaint();
+}
+
+void MainComponent::replaceClipSamples(const std::map<juce::String, std::shared_ptr<const Sample>>& samplesByPath)
+{
+    std::map<const Sample*, std::shared_ptr<const Sample>> replaced;
+    {
+        AudioEngine::ScopedTrackEdit edit(engine);
+        for (auto& track : engine.getTracks())
+        {
+            const auto& clips = track.getClips();
+            for (int c = 0; c < clips.size(); ++c)
+            {
+                const auto& clip = clips.getReference(c);
+                const auto found = samplesByPath.find(clip.sourceFilePath);
+                if (found == samplesByPath.end() || found->second == nullptr || clip.sample == found->second)
+                    continue;
+
+                if (clip.sample != nullptr)
+                    replaced.emplace(clip.sample.get(), found->second);
+                TrackClip loaded = clip;
+                loaded.sample = found->second;
+                track.updateClip(c, loaded);
+            }
+        }
+    }
+
+    // Undo steps would otherwise keep the replaced audio alive next to its replacement.
+    undoHistory.replaceSamples(replaced);
+}
+
+void MainComponent::sampleLoadingFinished(bool wasCancelled)
+{
+    sampleLoadProgress = 1.0;
+    arrangementView.setSamplesLoading(false);
+    sampleLoadProgressBar.setVisible(false);
+    cancelSampleLoadButton.setVisible(false);
+
+    if (!wasCancelled && sampleLoadFailures > 0)
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                                               "Load Project",
+                                               juce::String(sampleLoadFailures) + (sampleLoadFailures == 1 ? " sample file" : " sample files")
+                                                   + " could not be read. Their clips will stay silent.");
+
+    // The loader is still on the call stack here, so let it unwind first.
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    juce::MessageManager::callAsync([safeThis]()
+    {
+        if (safeThis != nullptr && safeThis->sampleLoader != nullptr && safeThis->sampleLoader->isFinished())
+            safeThis->sampleLoader.reset();
+    });
+}
+
 bool MainComponent::loadProjectFromFile(const juce::File& file)
 {
     if (!file.existsAsFile())
         return false;
 
+    if (ProjectFile::isBinaryProject(file))
+    {
+        ProjectSettings settings;
+        juce::Array<Track> loadedTracks;
+        if (!ProjectFile::load(file, settings, loadedTracks))
+            return false;
+        return applyLoadedProject(settings, loadedTracks, true);
+    }
+
     const juce::String text = file.loadFileAsString();
     const juce::var parsed = juce::JSON::parse(text);
     return loadProjectFromVar(parsed, true);
@@ -1281,30 +1870,62 @@ void MainComponent::pushUndoState()
     if (isApplyingUndo)
         return;
 
-    const auto stateVar = createProjectStateVar();
-    if (stateVar.isVoid())
-        return;
+    undoHistory.push(getProjectSettings(), engine.getTracks());
+    ++undoSerial;
+}
 
-    const juce::String state = juce::JSON::toString(stateVar, false);
-    if (!undoStack.isEmpty() && undoStack.getLast() == state)
-        return;
+void MainComponent::performUndo()
+{
+    UndoHistory::State state;
+    if (undoHistory.undo(getProjectSettings(), engine.getTracks(), state))
+    {
+        ++undoSerial;
+        applyUndoState(state);
+    }
+}
 
-    undoStack.add(state);
-    while (undoStack.size() > 20)
-        undoStack.remove(0);
+void MainComponent::performRedo()
+{
+    UndoHistory::State state;
+    if (undoHistory.redo(getProjectSettings(), engine.getTracks(), state))
+    {
+        ++undoSerial;
+        applyUndoState(state);
+    }
 }
 
-void MainComponent::performUndo()
+void MainComponent::applyUndoState(const UndoHistory::State& state)
 {
-    if (undoStack.isEmpty())
-        return;
+    // Clips recorded while their audio was still loading pick up whatever the pool holds now;
+    // anything else left without audio is queued for the loader again.
+    std::map<juce::String, std::shared_ptr<const Sample>> foundSamples;
+    juce::Array<Track> restoredTracks;
+    restoredTracks.ensureStorageAllocated((int)state.tracks.size());
+    for (const auto& sharedTrack : state.tracks)
+    {
+        restoredTracks.add(*sharedTrack);
+        auto& track = restoredTracks.getReference(restoredTracks.size() - 1);
+        const auto& clips = track.getClips();
+        for (int c = 0; c < clips.size(); ++c)
+        {
+            if (clips.getReference(c).sample != nullptr)
+                continue;
 
-    const juce::String state = undoStack.getLast();
-    undoStack.removeLast();
-    const juce::var parsed = juce::JSON::parse(state);
+            const auto& path = clips.getReference(c).sourceFilePath;
+            auto found = foundSamples.find(path);
+            if (found == foundSamples.end())
+                found = foundSamples.emplace(path, samplePool.findSample(juce::File(path))).first;
+            if (found->second == nullptr)
+                continue;
+
+            TrackClip loaded = clips.getReference(c);
+            loaded.sample = found->second;
+            track.updateClip(c, loaded);
+        }
+    }
 
     const juce::ScopedValueSetter<bool> undoGuard(isApplyingUndo, true);
-    loadProjectFromVar(parsed, true);
+    applyProjectState(state.settings, restoredTracks, true);
 }
 
 void MainComponent::performCopy()
@@ -1315,7 +1936,6 @@ void MainComponent::performCopy()
     clipboardType = ClipboardType::none;
 
     const auto selectionType = arrangementView.getSelectionType();
-    juce::ScopedLock lock(engine.getTrackLock());
     const auto& tracks = engine.getTracks();
 
     if (selectionType == ArrangementView::SelectionType::track)
@@ -1398,7 +2018,7 @@ void MainComponent::performPaste()
     const int64 playhead = engine.getPlayheadSample();
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
 
         if (clipboardType == ClipboardType::track)
@@ -1423,6 +2043,8 @@ void MainComponent::performPaste()
             if (minStart == std::numeric_limits<int64>::max())
                 minStart = 0;
 
+            // Each track's clips are set once, rather than rebuilding its index per pasted clip.
+            std::map<int, juce::Array<TrackClip>> pastedClips;
             for (int i = 0; i < copiedClips.size(); ++i)
             {
                 auto cc = copiedClips.getReference(i);
@@ -1436,11 +2058,18 @@ void MainComponent::performPaste()
                 const int64 offset = cc.startSample - minStart;
                 const int64 unsnapped = juce::jmax<int64>(0, playhead + offset);
                 clip.startSample = tracks.getReference(targetTrack).snapSampleToGrid(unsnapped, sampleRate);
-                tracks.getReference(targetTrack).addClip(clip);
+
+                auto found = pastedClips.find(targetTrack);
+                if (found == pastedClips.end())
+                    found = pastedClips.emplace(targetTrack, tracks.getReference(targetTrack).getClips()).first;
+                found->second.add(clip);
 
                 newSelectedTrack = targetTrack;
-                newSelectedClip = tracks.getReference(targetTrack).getClips().size() - 1;
+                newSelectedClip = found->second.size() - 1;
             }
+
+            for (const auto& pasted : pastedClips)
+                tracks.getReference(pasted.first).setClips(pasted.second);
         }
         else if (clipboardType == ClipboardType::marker)
         {
@@ -1489,14 +2118,28 @@ void MainComponent::showExportDialog()
             return;
 
         juce::PopupMenu normMenu;
-        normMenu.addItem(1, "Normalize");
+        normMenu.addItem(1, "Normalize Peak (-0.1 dBTP)");
         normMenu.addItem(2, "No Normalization");
+        normMenu.addSeparator();
+        normMenu.addItem(3, "Normalize to -14 LUFS, -1 dBTP");
+        normMenu.addItem(4, "Normalize to -23 LUFS, -1 dBTP");
         normMenu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(safeThis.getComponent()), [safeThis, modeId](int normId)
         {
             if (safeThis == nullptr || normId == 0)
                 return;
 
-            const bool normalize = (normId == 1);
+            OfflineExporter::Normalize normalize;
+            if (normId == 1)
+            {
+                normalize.type = OfflineExporter::Normalize::Type::peak;
+                normalize.truePeakCeiling = -0.1;
+            }
+            else if (normId == 3 || normId == 4)
+            {
+                normalize.type = OfflineExporter::Normalize::Type::loudness;
+                normalize.targetLoudness = normId == 3 ? -14.0 : -23.0;
+                normalize.truePeakCeiling = -1.0;
+            }
             const int mode = modeId - 1;
 
             if (mode == 1)
@@ -1544,141 +2187,64 @@ void MainComponent::showExportDialog()
     });
 }
 
-bool MainComponent::writeWavFile(const juce::File& file, const juce::AudioBuffer<float>& buffer) const
-{
-    juce::WavAudioFormat wav;
-    std::unique_ptr<juce::OutputStream> stream = file.createOutputStream();
-    if (stream == nullptr)
-        return false;
-
-    auto options = juce::AudioFormatWriterOptions{}
-                       .withSampleRate(sampleRate)
-                       .withNumChannels(buffer.getNumChannels())
-                       .withBitsPerSample(exportBitDepth);
-
-    auto writer = wav.createWriterFor(stream, options);
-    if (writer == nullptr)
-        return false;
-
-    return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
-}
-
-void MainComponent::normalizeBuffer(juce::AudioBuffer<float>& buffer) const
+void MainComponent::launchExport(const juce::Array<Track>& tracksToExport, OfflineExporter::Mode mode, const juce::File& destination, const OfflineExporter::Normalize& normalize)
 {
-    float peak = 0.0f;
-    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-        peak = juce::jmax(peak, buffer.getMagnitude(ch, 0, buffer.getNumSamples()));
-
-    if (peak <= 0.0f)
-        return;
-
-    const float target = 0.99f;
-    const float gain = target / peak;
-    buffer.applyGain(gain);
-}
-
-int64 MainComponent::getTrackEndSamples(const Track& track) const
-{
-    int64 endSample = 0;
-    for (const auto& clip : track.getClips())
-        endSample = juce::jmax(endSample, clip.startSample + track.getClipPlaybackLengthSamples(clip, sampleRate));
-    return endSample;
-}
-
-void MainComponent::renderTrackToBuffer(Track& track, juce::AudioBuffer<float>& buffer) const
-{
-    const int blockSize = 1024;
-    const int channels = buffer.getNumChannels();
-    std::vector<float*> ptrs((size_t)channels, nullptr);
-
-    for (int64 pos = 0; pos < buffer.getNumSamples(); pos += blockSize)
+    if (activeExport != nullptr && activeExport->isThreadRunning())
     {
-        const int len = (int)juce::jmin<int64>(blockSize, buffer.getNumSamples() - pos);
-        for (int ch = 0; ch < channels; ++ch)
-            ptrs[(size_t)ch] = buffer.getWritePointer(ch, (int)pos);
-
-        juce::AudioBuffer<float> view(ptrs.data(), channels, len);
-        track.render(view, pos, sampleRate);
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon,
+                                               "Export",
+                                               "An export is already running. Wait for it to finish or cancel it first.");
+        return;
     }
-}
 
-void MainComponent::exportOneTrack(const juce::File& outputFile, bool normalize)
-{
-    Track track("Track");
+    if (isLoadingSamples())
     {
-        juce::ScopedLock lock(engine.getTrackLock());
-        if (selectedTrackIndex < 0 || selectedTrackIndex >= engine.getTracks().size())
-            return;
-        track = engine.getTracks().getReference(selectedTrackIndex);
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon,
+                                               "Export",
+                                               "Samples are still loading. Wait for them to finish or cancel loading first.");
+        return;
     }
 
-    const int64 length = juce::jmax<int64>(1, getTrackEndSamples(track));
-    juce::AudioBuffer<float> buffer(2, (int)length);
-    buffer.clear();
-    renderTrackToBuffer(track, buffer);
-    if (normalize)
-        normalizeBuffer(buffer);
+    OfflineExporter::Settings settings;
+    settings.mode = mode;
+    settings.destination = destination;
+    settings.normalize = normalize;
+    settings.sampleRate = sampleRate;
+    settings.bitDepth = exportBitDepth;
+    settings.interpolation = (Sample::Interpolation)exportInterpolationId;
 
-    const bool ok = writeWavFile(outputFile, buffer);
-    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon,
-                                           ok ? "Export Complete" : "Export Failed",
-                                           ok ? ("Wrote " + outputFile.getFileName()) : "Could not write output file.");
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    activeExport = std::make_unique<OfflineExporter>(tracksToExport, settings, this);
+    activeExport->onFinished = [safeThis]()
+    {
+        // The exporter is still on the call stack here, so let it unwind first.
+        juce::MessageManager::callAsync([safeThis]()
+        {
+            if (safeThis != nullptr && safeThis->activeExport != nullptr && !safeThis->activeExport->isThreadRunning())
+                safeThis->activeExport.reset();
+        });
+    };
+    activeExport->launchThread();
 }
 
-void MainComponent::exportStems(const juce::File& outputDirectory, bool normalize)
+void MainComponent::exportOneTrack(const juce::File& outputFile, const OfflineExporter::Normalize& normalize)
 {
-    juce::Array<Track> tracks;
-    {
-        juce::ScopedLock lock(engine.getTrackLock());
-        tracks = engine.getTracks();
-    }
-
-    bool allOk = true;
-    for (int i = 0; i < tracks.size(); ++i)
-    {
-        auto track = tracks.getReference(i);
-        const int64 length = juce::jmax<int64>(1, getTrackEndSamples(track));
-        juce::AudioBuffer<float> buffer(2, (int)length);
-        buffer.clear();
-        renderTrackToBuffer(track, buffer);
-        if (normalize)
-            normalizeBuffer(buffer);
-
-        const juce::String safeName = track.getName().retainCharacters("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_ ");
-        const juce::File outFile = outputDirectory.getChildFile("stem_" + juce::String(i + 1) + "_" + safeName + ".wav");
-        allOk = writeWavFile(outFile, buffer) && allOk;
-    }
+    if (selectedTrackIndex < 0 || selectedTrackIndex >= engine.getTracks().size())
+        return;
 
-    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon,
-                                           allOk ? "Export Complete" : "Export Partial/Failed",
-                                           allOk ? "All stems written." : "One or more stems could not be written.");
+    juce::Array<Track> tracksToExport;
+    tracksToExport.add(engine.getTracks().getReference(selectedTrackIndex));
+    launchExport(tracksToExport, OfflineExporter::Mode::singleTrack, outputFile, normalize);
 }
 
-void MainComponent::exportAllTracksMix(const juce::File& outputFile, bool normalize)
+void MainComponent::exportStems(const juce::File& outputDirectory, const OfflineExporter::Normalize& normalize)
 {
-    juce::Array<Track> tracks;
-    int64 length = 1;
-    {
-        juce::ScopedLock lock(engine.getTrackLock());
-        tracks = engine.getTracks();
-        for (const auto& t : tracks)
-            length = juce::jmax(length, getTrackEndSamples(t));
-    }
-
-    juce::AudioBuffer<float> mix(2, (int)length);
-    mix.clear();
-    for (int i = 0; i < tracks.size(); ++i)
-    {
-        auto t = tracks.getReference(i);
-        renderTrackToBuffer(t, mix);
-    }
-    if (normalize)
-        normalizeBuffer(mix);
+    launchExport(engine.getTracks(), OfflineExporter::Mode::stems, outputDirectory, normalize);
+}
 
-    const bool ok = writeWavFile(outputFile, mix);
-    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon,
-                                           ok ? "Export Complete" : "Export Failed",
-                                           ok ? ("Wrote " + outputFile.getFileName()) : "Could not write output file.");
+void MainComponent::exportAllTracksMix(const juce::File& outputFile, const OfflineExporter::Normalize& normalize)
+{
+    launchExport(engine.getTracks(), OfflineExporter::Mode::mix, outputFile, normalize);
 }
 
 void MainComponent::openBeatSlicerForSelection()
@@ -1686,7 +2252,6 @@ void MainComponent::openBeatSlicerForSelection()
     TrackClip selectedClip;
     bool ok = false;
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         if (selectedTrackIndex >= 0 && selectedTrackIndex < engine.getTracks().size())
         {
             const auto& track = engine.getTracks().getReference(selectedTrackIndex);
@@ -1709,7 +2274,7 @@ void MainComponent::openBeatSlicerForSelection()
 void MainComponent::applySlicingToSelectedClip(const BeatSlicingSettings& slicing)
 {
     pushUndoState();
-    juce::ScopedLock lock(engine.getTrackLock());
+    AudioEngine::ScopedTrackEdit edit(engine);
     if (selectedTrackIndex < 0 || selectedTrackIndex >= engine.getTracks().size())
         return;
 
@@ -1726,7 +2291,7 @@ void MainComponent::applyFitSettingsToSelectedClip(int fitLengthUnits, bool fitT
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         if (selectedTrackIndex < 0 || selectedTrackIndex >= engine.getTracks().size())
             return;
 
@@ -1756,7 +2321,7 @@ void MainComponent::applyWarpToSelectedClip(const WarpCurve& curve, const juce::
     WarpCurve updatedCurve;
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         if (engine.getTracks().isEmpty())
             return;
 
@@ -1788,7 +2353,6 @@ void MainComponent::applyWarpToSelectedClip(const WarpCurve& curve, const juce::
     curveEditor.setCurve(updatedCurve);
     warpPanel.setCurve(updatedCurve);
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         const auto& clip = engine.getTracks().getReference(trackIndex).getClips().getReference(clipIndex);
         warpPanel.setFitSettings(clip.fitLengthUnits, clip.fitToSnapDivision);
     }
@@ -1799,7 +2363,6 @@ void MainComponent::selectClip(int trackIndex, int clipIndex)
     WarpCurve selectedCurve;
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         if (trackIndex < 0 || trackIndex >= engine.getTracks().size())
             return;
 
@@ -1816,7 +2379,6 @@ void MainComponent::selectClip(int trackIndex, int clipIndex)
     curveEditor.setCurve(selectedCurve);
     warpPanel.setCurve(selectedCurve);
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         const auto& clip = engine.getTracks().getReference(trackIndex).getClips().getReference(clipIndex);
         warpPanel.setFitSettings(clip.fitLengthUnits, clip.fitToSnapDivision);
     }
@@ -1827,7 +2389,6 @@ void MainComponent::selectClip(int trackIndex, int clipIndex)
 void MainComponent::selectTrack(int trackIndex)
 {
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         if (trackIndex < 0 || trackIndex >= engine.getTracks().size())
             return;
         selectedTrackIndex = trackIndex;
@@ -1847,7 +2408,7 @@ void MainComponent::moveClip(int sourceTrackIndex, int clipIndex, int targetTrac
     WarpCurve selectedCurve;
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (sourceTrackIndex < 0 || sourceTrackIndex >= tracks.size())
             return;
@@ -1884,9 +2445,7 @@ void MainComponent::moveClip(int sourceTrackIndex, int clipIndex, int targetTrac
                 if (i != clipIndex)
                     rebuilt.add(sourceClips.getReference(i));
             }
-            sourceTrack.clear();
-            for (const auto& c : rebuilt)
-                sourceTrack.addClip(c);
+            sourceTrack.setClips(rebuilt);
 
             auto& targetTrack = tracks.getReference(targetTrackIndex);
             targetTrack.addClip(moved);
@@ -1905,7 +2464,6 @@ void MainComponent::moveClip(int sourceTrackIndex, int clipIndex, int targetTrac
     curveEditor.setCurve(selectedCurve);
     warpPanel.setCurve(selectedCurve);
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         const auto& clip = engine.getTracks().getReference(finalTrack).getClips().getReference(finalClip);
         warpPanel.setFitSettings(clip.fitLengthUnits, clip.fitToSnapDivision);
     }
@@ -1920,7 +2478,7 @@ void MainComponent::splitClip(int trackIndex, int clipIndex, int64 splitSample)
     WarpCurve selectedCurve = WarpCurve::linear();
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -1939,7 +2497,24 @@ void MainComponent::splitClip(int trackIndex, int clipIndex, int64 splitSample)
         const double t = juce::jlimit(0.0, 1.0, (double)(splitSample - clipStart) / (double)juce::jmax<int64>(1, clipLength));
         const float srcStart = juce::jlimit(0.0f, 1.0f, original.sourceStartNorm);
         const float srcEnd = juce::jlimit(srcStart, 1.0f, original.sourceEndNorm);
-        const float srcSplit = juce::jlimit(srcStart, srcEnd, srcStart + (srcEnd - srcStart) * (float)t);
+        float srcSplit = juce::jlimit(srcStart, srcEnd, srcStart + (srcEnd - srcStart) * (float)t);
+
+        // Cut at a zero crossing near the requested point so neither half starts or ends
+        // with a click. Both halves move together, so they still play back seamlessly.
+        if (original.sample != nullptr && original.sample->getNumSamples() > 0 && srcEnd > srcStart)
+        {
+            const auto& sample = *original.sample;
+            const double total = (double)sample.getNumSamples();
+            const int64 position = (int64)std::round((double)srcSplit * total);
+            const int64 snapped = sample.snapToZeroCrossing(position, (int64)std::round(ZeroCrossingIndex::snapSeconds * sample.getSampleRate()));
+            const float snappedSplit = juce::jlimit(srcStart, srcEnd, (float)((double)snapped / total));
+            const int64 snappedSample = clipStart + (int64)std::round((double)(snappedSplit - srcStart) / (double)(srcEnd - srcStart) * (double)clipLength);
+            if (snappedSample > clipStart + minLen && snappedSample < clipEnd - minLen)
+            {
+                srcSplit = snappedSplit;
+                splitSample = snappedSample;
+            }
+        }
 
         TrackClip left = original;
         left.lengthSamples = juce::jmax<int64>(1, splitSample - clipStart);
@@ -1969,7 +2544,6 @@ void MainComponent::splitClip(int trackIndex, int clipIndex, int64 splitSample)
     curveEditor.setCurve(selectedCurve);
     warpPanel.setCurve(selectedCurve);
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         const auto& clip = engine.getTracks().getReference(newSelectedTrack).getClips().getReference(newSelectedClip);
         warpPanel.setFitSettings(clip.fitLengthUnits, clip.fitToSnapDivision);
     }
@@ -1979,7 +2553,7 @@ void MainComponent::splitClip(int trackIndex, int clipIndex, int64 splitSample)
 void MainComponent::trimClip(int trackIndex, int clipIndex, int64 newStartSample, int64 newLengthSamples, float newSourceStartNorm, float newSourceEndNorm)
 {
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2009,7 +2583,7 @@ void MainComponent::deleteClip(int trackIndex, int clipIndex)
     int nextClip = -1;
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2022,14 +2596,14 @@ void MainComponent::deleteClip(int trackIndex, int clipIndex)
         for (int i = 0; i < oldClips.size(); ++i)
             if (i != clipIndex)
                 rebuilt.add(oldClips.getReference(i));
-        track.clear();
-        for (const auto& c : rebuilt)
-            track.addClip(c);
+        track.setClips(rebuilt);
 
         if (!track.getClips().isEmpty())
             nextClip = juce::jlimit(0, track.getClips().size() - 1, clipIndex);
     }
 
+    cancelUnusedAnalysis();
+
     selectedTrackIndex = nextTrack;
     selectedClipIndex = nextClip;
     arrangementView.setSelectedClip(nextTrack, nextClip);
@@ -2038,6 +2612,17 @@ void MainComponent::deleteClip(int trackIndex, int clipIndex)
     updateTrackControlsFromSelection();
 }
 
+// Analysis still queued for audio no clip plays any more is not worth running.
+void MainComponent::cancelUnusedAnalysis()
+{
+    std::set<const Sample*> samplesInUse;
+    for (const auto& track : engine.getTracks())
+        for (const auto& clip : track.getClips())
+            if (clip.sample != nullptr)
+                samplesInUse.insert(clip.sample.get());
+    sampleAnalyser.cancelAllExcept(samplesInUse);
+}
+
 void MainComponent::glueClips(const juce::Array<ArrangementView::ClipRef>& clipRefs)
 {
     if (clipRefs.size() < 2)
@@ -2049,7 +2634,7 @@ void MainComponent::glueClips(const juce::Array<ArrangementView::ClipRef>& clipR
     WarpCurve curve = WarpCurve::linear();
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         for (const auto& r : clipRefs)
         {
@@ -2104,9 +2689,7 @@ void MainComponent::glueClips(const juce::Array<ArrangementView::ClipRef>& clipR
                 rebuilt.add(clips.getReference(i));
 
         rebuilt.add(base);
-        track.clear();
-        for (const auto& c : rebuilt)
-            track.addClip(c);
+        track.setClips(rebuilt);
 
         newClipIndex = track.getClips().size() - 1;
         curve = base.warpCurve;
@@ -2126,7 +2709,7 @@ void MainComponent::editTrackName(int trackIndex, const juce::String& name)
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2139,7 +2722,7 @@ void MainComponent::editTrackTempo(int trackIndex, double tempoBpm)
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2167,7 +2750,7 @@ void MainComponent::editTrackTimeSignature(int trackIndex, int numerator, int de
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2195,7 +2778,7 @@ void MainComponent::editTrackLoopMarker(int trackIndex, int markerIndex, int64 s
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2219,7 +2802,7 @@ void MainComponent::editTrackZoomX(int trackIndex, double zoomValue)
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2234,7 +2817,7 @@ void MainComponent::editTrackZoomY(int trackIndex, double zoomValue)
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2249,7 +2832,7 @@ void MainComponent::editTrackVolume(int trackIndex, double volumeValue)
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2263,7 +2846,7 @@ void MainComponent::editTrackPan(int trackIndex, double panValue)
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2276,7 +2859,7 @@ void MainComponent::editTrackPan(int trackIndex, double panValue)
 void MainComponent::editClipGain(int trackIndex, int clipIndex, float gain)
 {
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2296,7 +2879,7 @@ void MainComponent::editClipGain(int trackIndex, int clipIndex, float gain)
 void MainComponent::editClipFade(int trackIndex, int clipIndex, float fadeInNorm, float fadeOutNorm)
 {
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2318,7 +2901,7 @@ void MainComponent::editClipFit(int trackIndex, int clipIndex, int fitLengthUnit
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2342,7 +2925,6 @@ void MainComponent::editClipFit(int trackIndex, int clipIndex, int fitLengthUnit
     arrangementView.refreshTrackControls();
     updateArrangementViewportBounds();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
         const auto& clip = engine.getTracks().getReference(trackIndex).getClips().getReference(clipIndex);
         warpPanel.setFitSettings(clip.fitLengthUnits, clip.fitToSnapDivision);
     }
@@ -2353,7 +2935,7 @@ void MainComponent::editTrackAutomationPoints(int trackIndex, bool isVolumeLane,
 {
     pushUndoState();
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2374,7 +2956,7 @@ void MainComponent::deleteTrack(int trackIndex)
     int newSelectedTrack = -1;
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -2386,6 +2968,7 @@ void MainComponent::deleteTrack(int trackIndex)
         selectedTrackIndex = newSelectedTrack;
     }
 
+    cancelUnusedAnalysis();
     arrangementView.setSelectedClip(newSelectedTrack, -1);
     arrangementView.refreshTrackControls();
     updateArrangementViewportBounds();
@@ -2397,7 +2980,6 @@ void MainComponent::updateTrackControlsFromSelection()
 {
     juce::ScopedValueSetter<bool> guard(suppressTrackControlCallbacks, true);
 
-    juce::ScopedLock lock(engine.getTrackLock());
     if (selectedTrackIndex < 0 || selectedTrackIndex >= engine.getTracks().size())
         return;
 
@@ -2416,7 +2998,7 @@ void MainComponent::applyTrackTimingFromControls()
     pushUndoState();
 
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         if (selectedTrackIndex < 0 || selectedTrackIndex >= engine.getTracks().size())
             return;
 
@@ -2447,7 +3029,7 @@ void MainComponent::applyTrackTimingFromControls()
 void MainComponent::refreshClipFitLengthsForTrack(int trackIndex)
 {
     {
-        juce::ScopedLock lock(engine.getTrackLock());
+        AudioEngine::ScopedTrackEdit edit(engine);
         auto& tracks = engine.getTracks();
         if (trackIndex < 0 || trackIndex >= tracks.size())
             return;
@@ -1,11 +1,19 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <map>
 #include "AudioEngine.h"
 #include "ArrangementView.h"
 #include "WarpCurveEditor.h"
 #include "WarpPanel.h"
 #include "BeatSlicerComponent.h"
+#include "OfflineExporter.h"
+#include "ProjectFile.h"
+#include "SampleAnalyser.h"
+#include "TempoEstimate.h"
+#include "UndoHistory.h"
+#include "SamplePool.h"
+#include "SampleLoader.h"
 
 class MainComponent : public juce::AudioAppComponent,
                       public juce::Button::Listener,
@@ -29,7 +37,11 @@ public:
 private:
     void styleToolbarButton(juce::TextButton& button, juce::Colour baseColour, bool isPrimary);
     void updateArrangementViewportBounds(bool preserveScroll = true);
-    void addSampleToTrack(const juce::File& file);
+    void addSampleFiles(const juce::Array<juce::File>& files);
+    void addSampleToTrack(const juce::File& file, int trackIndex = -1);
+    void estimateClipTempo(const std::shared_ptr<const Sample>& sample, const juce::String& filePath,
+                           int trackIndex, int64 clipStartSample, int beatsPerBar);
+    void applyTempoEstimate(const juce::String& filePath, int trackIndex, int64 clipStartSample, const TempoEstimate& estimate);
     void applyWarpToSelectedClip(const WarpCurve& curve, const juce::String& label);
     void selectClip(int trackIndex, int clipIndex);
     void selectTrack(int trackIndex);
@@ -37,6 +49,7 @@ private:
     void splitClip(int trackIndex, int clipIndex, int64 splitSample);
     void trimClip(int trackIndex, int clipIndex, int64 newStartSample, int64 newLengthSamples, float newSourceStartNorm, float newSourceEndNorm);
     void deleteClip(int trackIndex, int clipIndex);
+    void cancelUnusedAnalysis();
     void glueClips(const juce::Array<ArrangementView::ClipRef>& clipRefs);
     void setActiveEditTool(ArrangementView::EditTool tool);
     void editTrackName(int trackIndex, const juce::String& name);
@@ -61,28 +74,45 @@ private:
     void showAudioSettingsDialog();
     juce::var createProjectStateVar();
     bool loadProjectFromVar(const juce::var& parsed, bool preserveScroll);
+    bool applyLoadedProject(const ProjectSettings& settings, juce::Array<Track>& loadedTracks, bool preserveScroll);
+    bool applyProjectState(const ProjectSettings& settings, const juce::Array<Track>& loadedTracks, bool preserveScroll);
+    ProjectSettings getProjectSettings() const;
+    juce::StringArray getClipSamplesToLoad(bool includeMissing) const;
+    void startSampleLoading(const juce::StringArray& filePaths);
+    void convertSamplesToPlaybackRate();
+    void cancelSampleLoading();
+    void applyLoadedSample(const juce::String& filePath, const std::shared_ptr<const Sample>& sample);
+    void replaceClipSamples(const std::map<juce::String, std::shared_ptr<const Sample>>& samplesByPath);
+    void sampleLoadingFinished(bool wasCancelled);
+    bool isLoadingSamples() const { return sampleLoader != nullptr && !sampleLoader->isFinished(); }
     void pushUndoState();
     void performUndo();
+    void performRedo();
+    void applyUndoState(const UndoHistory::State& state);
     void performCopy();
     void performPaste();
     juce::File getAppSettingsFile() const;
+    void applyRenderSettings();
+    void setSampleEncoding(Sample::Encoding newEncoding);
     void loadAppSettings();
     void saveAppSettings() const;
     void showExportDialog();
     bool saveProjectToFile(const juce::File& file);
     bool loadProjectFromFile(const juce::File& file);
-    bool writeWavFile(const juce::File& file, const juce::AudioBuffer<float>& buffer) const;
-    void normalizeBuffer(juce::AudioBuffer<float>& buffer) const;
-    int64 getTrackEndSamples(const Track& track) const;
-    void renderTrackToBuffer(Track& track, juce::AudioBuffer<float>& buffer) const;
-    void exportOneTrack(const juce::File& outputFile, bool normalize);
-    void exportStems(const juce::File& outputDirectory, bool normalize);
-    void exportAllTracksMix(const juce::File& outputFile, bool normalize);
+    void launchExport(const juce::Array<Track>& tracksToExport, OfflineExporter::Mode mode, const juce::File& destination, const OfflineExporter::Normalize& normalize);
+    void exportOneTrack(const juce::File& outputFile, const OfflineExporter::Normalize& normalize);
+    void exportStems(const juce::File& outputDirectory, const OfflineExporter::Normalize& normalize);
+    void exportAllTracksMix(const juce::File& outputFile, const OfflineExporter::Normalize& normalize);
     void openBeatSlicerForSelection();
     void applySlicingToSelectedClip(const BeatSlicingSettings& slicing);
     void applyFitSettingsToSelectedClip(int fitLengthUnits, bool fitToSnapDivision);
 
     AudioEngine engine;
+    SamplePool samplePool;
+    std::unique_ptr<SampleLoader> sampleLoader;
+    SampleAnalyser sampleAnalyser {2};
+    double sampleLoadProgress = 0.0;
+    int sampleLoadFailures = 0;
 
     juce::TextButton playButton {"Play"};
     juce::TextButton stopButton {"Stop"};
@@ -94,6 +124,8 @@ private:
     juce::TextButton projectButton {"Project"};
     juce::TextButton addTrackButton {"Add Track"};
     juce::TextButton settingsButton {"Settings"};
+    juce::ProgressBar sampleLoadProgressBar {sampleLoadProgress};
+    juce::TextButton cancelSampleLoadButton {"Cancel"};
     juce::ToggleButton snapToggle {"Snap"};
     juce::ComboBox snapDivisionBox;
     juce::Label transportSectionLabel;
@@ -113,15 +145,22 @@ private:
     std::unique_ptr<juce::FileChooser> fileChooser;
     std::unique_ptr<juce::FileChooser> projectFileChooser;
     std::unique_ptr<juce::FileChooser> exportFileChooser;
+    std::unique_ptr<OfflineExporter> activeExport;
 
     double sampleRate = 44100.0;
     int selectedTrackIndex = -1;
     int selectedClipIndex = -1;
     bool suppressTrackControlCallbacks = false;
     int exportBitDepth = 24;
+    int renderThreadCount = juce::jlimit(0, 8, juce::SystemStats::getNumCpus() - 1);
+    int renderWaitPolicyId = (int)RenderWorkerPool::WaitPolicy::spinThenSleep;
+    int playbackInterpolationId = (int)Sample::Interpolation::cubic;
+    int exportInterpolationId = (int)Sample::Interpolation::sinc;
     std::unique_ptr<juce::XmlElement> pendingAudioDeviceState;
-    juce::Array<juce::String> undoStack;
+    UndoHistory undoHistory;
     bool isApplyingUndo = false;
+    uint64 undoSerial = 0;        // bumped by every push, undo and redo
+    uint64 importUndoSerial = 0;  // undoSerial just after the latest sample import's push
 
     enum class ClipboardType
     {
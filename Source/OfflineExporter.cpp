@@ -0,0 +1,432 @@
+#include "OfflineExporter.h"
+#include <algorithm>
+
+namespace
+{
+constexpr int renderBlockSize = 1024;
+constexpr int chunkSize = 1 << 16;
+constexpr int exportChannels = 2;
+}
+
+class OfflineExporter::StemJob : public juce::ThreadPoolJob
+{
+public:
+    StemJob(OfflineExporter& ownerIn, int trackIndexIn)
+        : juce::ThreadPoolJob("Export stem " + juce::String(trackIndexIn + 1)),
+          owner(ownerIn),
+          trackIndex(trackIndexIn),
+          chunk(exportChannels, chunkSize)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        renderAndWrite();
+        if (--owner.pendingJobs == 0)
+            owner.jobsFinished.signal();
+        return jobHasFinished;
+    }
+
+private:
+    void renderAndWrite()
+    {
+        auto& track = owner.tracks.getReference(trackIndex);
+        const int64 length = juce::jmax<int64>(1, getTrackEndSamples(track, owner.settings.sampleRate));
+        track.prepareToRender(exportChannels, renderBlockSize);
+
+        LoudnessMeter meter(owner.settings.sampleRate, exportChannels);
+        float gain = 1.0f;
+        bool heldByCeiling = false;
+        if (owner.settings.normalize.type != Normalize::Type::none)
+        {
+            // Measure a copy so the real pass starts from the same playback state.
+            Track measured(track);
+            if (!renderPass(measured, length, nullptr, 1.0f, meter))
+                return;
+            gain = owner.getNormalizeGain(meter, heldByCeiling);
+            meter.reset();
+        }
+
+        const auto file = owner.settings.mode == Mode::stems ? owner.getStemFile(trackIndex) : owner.settings.destination;
+        {
+            const juce::ScopedLock lock(owner.writtenFilesLock);
+            owner.writtenFiles.add(file);
+        }
+
+        auto writer = owner.createWavWriter(file);
+        const bool ok = writer != nullptr && renderPass(track, length, writer.get(), gain, meter);
+        if (ok)
+            owner.addMeasurement(file, meter, gain, heldByCeiling);
+        else if (!shouldExit())
+            owner.anyWriteFailed = true;
+    }
+
+    bool renderPass(Track& track, int64 length, juce::AudioFormatWriter* writer, float gain, LoudnessMeter& meter)
+    {
+        for (int64 pos = 0; pos < length; pos += chunkSize)
+        {
+            const int len = (int)juce::jmin<int64>(chunkSize, length - pos);
+            juce::AudioBuffer<float> view(chunk.getArrayOfWritePointers(), exportChannels, len);
+            view.clear();
+
+            const bool rendered = renderTrackToBuffer(track, view, pos, owner.settings.sampleRate, [this](int numSamples)
+            {
+                owner.samplesRendered += numSamples;
+                return !shouldExit();
+            });
+            if (!rendered)
+                return false;
+
+            view.applyGain(gain);
+            meter.process(view);
+            if (writer != nullptr && !writer->writeFromAudioSampleBuffer(view, 0, len))
+                return false;
+        }
+
+        return true;
+    }
+
+    OfflineExporter& owner;
+    const int trackIndex;
+    juce::AudioBuffer<float> chunk;
+};
+
+class OfflineExporter::MixChunkJob : public juce::ThreadPoolJob
+{
+public:
+    MixChunkJob(OfflineExporter& ownerIn, const Track& trackIn, int trackIndex)
+        : juce::ThreadPoolJob("Export mix track " + juce::String(trackIndex + 1)),
+          owner(ownerIn),
+          track(trackIn),
+          buffer(exportChannels, chunkSize)
+    {
+        track.prepareToRender(exportChannels, renderBlockSize);
+    }
+
+    void setRange(int64 startSampleIn, int numSamplesIn)
+    {
+        startSample = startSampleIn;
+        numSamples = numSamplesIn;
+    }
+
+    const juce::AudioBuffer<float>& getBuffer() const { return buffer; }
+
+    JobStatus runJob() override
+    {
+        juce::AudioBuffer<float> view(buffer.getArrayOfWritePointers(), exportChannels, numSamples);
+        view.clear();
+        renderTrackToBuffer(track, view, startSample, owner.settings.sampleRate, [this](int rendered)
+        {
+            owner.samplesRendered += rendered;
+            return !shouldExit();
+        });
+
+        if (--owner.pendingJobs == 0)
+            owner.jobsFinished.signal();
+        return jobHasFinished;
+    }
+
+private:
+    OfflineExporter& owner;
+    Track track;
+    juce::AudioBuffer<float> buffer;
+    int64 startSample = 0;
+    int numSamples = 0;
+};
+
+OfflineExporter::OfflineExporter(const juce::Array<Track>& tracksIn, const Settings& settingsIn, juce::Component* componentToCentreAround)
+    : juce::ThreadWithProgressWindow("Exporting Audio", true, true, 10000, {}, componentToCentreAround),
+      tracks(tracksIn),
+      settings(settingsIn)
+{
+    for (auto& track : tracks)
+    {
+        track.setInterpolation(settings.interpolation);
+        track.setBlockingSampleReads(true);
+    }
+}
+
+OfflineExporter::~OfflineExporter()
+{
+    // run() uses our members, so it has to be stopped before they are destroyed.
+    stopThread(10000);
+}
+
+int64 OfflineExporter::getTrackEndSamples(const Track& track, double sampleRate)
+{
+    int64 endSample = 0;
+    for (const auto& clip : track.getClips())
+        endSample = juce::jmax(endSample, clip.startSample + track.getClipPlaybackLengthSamples(clip, sampleRate));
+    return endSample;
+}
+
+void OfflineExporter::run()
+{
+    juce::ThreadPool pool(juce::ThreadPoolOptions{}
+                              .withThreadName("Export worker")
+                              .withNumberOfThreads(juce::jmax(1, settings.numThreads)));
+
+    succeeded = settings.mode == Mode::mix ? exportMix(pool) : exportStems(pool);
+    succeeded = succeeded && !anyWriteFailed.load();
+    setProgress(1.0);
+}
+
+bool OfflineExporter::exportStems(juce::ThreadPool& pool)
+{
+    totalSamples = 0;
+    for (const auto& track : tracks)
+        totalSamples += juce::jmax<int64>(1, getTrackEndSamples(track, settings.sampleRate));
+    if (settings.normalize.type != Normalize::Type::none)
+        totalSamples *= 2;
+
+    setStatusMessage(settings.mode == Mode::stems ? "Rendering " + juce::String(tracks.size()) + " stems..."
+                                                  : "Rendering " + settings.destination.getFileName() + "...");
+
+    juce::OwnedArray<StemJob> jobs;
+    for (int i = 0; i < tracks.size(); ++i)
+        jobs.add(new StemJob(*this, i));
+
+    jobsFinished.reset();
+    pendingJobs.store(jobs.size());
+    for (auto* job : jobs)
+        pool.addJob(job, false);
+
+    return waitForJobs(pool);
+}
+
+bool OfflineExporter::exportMix(juce::ThreadPool& pool)
+{
+    int64 length = 1;
+    for (const auto& track : tracks)
+        length = juce::jmax(length, getTrackEndSamples(track, settings.sampleRate));
+    const bool normalize = settings.normalize.type != Normalize::Type::none;
+    totalSamples = juce::jmax<int64>(1, length * tracks.size() * (normalize ? 2 : 1));
+
+    LoudnessMeter meter(settings.sampleRate, exportChannels);
+    float gain = 1.0f;
+    bool heldByCeiling = false;
+    if (normalize)
+    {
+        setStatusMessage(settings.normalize.type == Normalize::Type::loudness ? "Measuring loudness..." : "Measuring peak level...");
+        if (!renderMixPass(pool, length, nullptr, 1.0f, meter))
+            return false;
+        gain = getNormalizeGain(meter, heldByCeiling);
+        meter.reset();
+    }
+
+    setStatusMessage("Rendering " + settings.destination.getFileName() + "...");
+    {
+        const juce::ScopedLock lock(writtenFilesLock);
+        writtenFiles.add(settings.destination);
+    }
+
+    auto writer = createWavWriter(settings.destination);
+    if (writer == nullptr || !renderMixPass(pool, length, writer.get(), gain, meter))
+        return false;
+
+    addMeasurement(settings.destination, meter, gain, heldByCeiling);
+    return true;
+}
+
+bool OfflineExporter::renderMixPass(juce::ThreadPool& pool, int64 length, juce::AudioFormatWriter* writer, float gain, LoudnessMeter& meter)
+{
+    // Every pass renders fresh copies of the tracks, so all passes hear the same audio.
+    juce::OwnedArray<MixChunkJob> jobs;
+    for (int i = 0; i < tracks.size(); ++i)
+        jobs.add(new MixChunkJob(*this, tracks.getReference(i), i));
+
+    juce::AudioBuffer<float> mix(exportChannels, chunkSize);
+    for (int64 pos = 0; pos < length; pos += chunkSize)
+    {
+        const int len = (int)juce::jmin<int64>(chunkSize, length - pos);
+
+        jobsFinished.reset();
+        pendingJobs.store(jobs.size());
+        for (auto* job : jobs)
+        {
+            job->setRange(pos, len);
+            pool.addJob(job, false);
+        }
+
+        if (!waitForJobs(pool))
+            return false;
+
+        // Sum in track order so the mix does not depend on which job finished first.
+        juce::AudioBuffer<float> view(mix.getArrayOfWritePointers(), exportChannels, len);
+        view.clear();
+        for (auto* job : jobs)
+            for (int ch = 0; ch < exportChannels; ++ch)
+                view.addFrom(ch, 0, job->getBuffer(), ch, 0, len);
+
+        view.applyGain(gain);
+        meter.process(view);
+        if (writer != nullptr && !writer->writeFromAudioSampleBuffer(view, 0, len))
+            return false;
+    }
+
+    return true;
+}
+
+bool OfflineExporter::waitForJobs(juce::ThreadPool& pool)
+{
+    while (pendingJobs.load() > 0 && !threadShouldExit())
+    {
+        jobsFinished.wait(50);
+        updateProgress();
+    }
+
+    // Interrupted jobs stop at their next block and finished ones may still be returning
+    // from runJob(); either way they have to leave the pool before we reuse or delete them.
+    const bool cancelled = threadShouldExit();
+    pool.removeAllJobs(cancelled, -1);
+    return !cancelled;
+}
+
+void OfflineExporter::updateProgress()
+{
+    setProgress(juce::jlimit(0.0, 1.0, (double)samplesRendered.load() / (double)totalSamples));
+}
+
+void OfflineExporter::threadComplete(bool userPressedCancel)
+{
+    if (userPressedCancel)
+    {
+        // Anything written so far is incomplete.
+        for (const auto& file : writtenFiles)
+            file.deleteFile();
+
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon, "Export Cancelled", "No files were written.");
+    }
+    else if (settings.mode == Mode::stems)
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon,
+                                               succeeded ? "Export Complete" : "Export Partial/Failed",
+                                               (succeeded ? "All stems written." : "One or more stems could not be written.")
+                                                   + getMeasurementReport());
+    }
+    else
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::NoIcon,
+                                               succeeded ? "Export Complete" : "Export Failed",
+                                               succeeded ? ("Wrote " + settings.destination.getFileName() + getMeasurementReport())
+                                                         : "Could not write output file.");
+    }
+
+    if (onFinished)
+        onFinished();
+}
+
+juce::File OfflineExporter::getStemFile(int trackIndex) const
+{
+    const auto& track = tracks.getReference(trackIndex);
+    const juce::String safeName = track.getName().retainCharacters("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_ ");
+    return settings.destination.getChildFile("stem_" + juce::String(trackIndex + 1) + "_" + safeName + ".wav");
+}
+
+std::unique_ptr<juce::AudioFormatWriter> OfflineExporter::createWavWriter(const juce::File& file) const
+{
+    juce::WavAudioFormat wav;
+    auto fileStream = std::make_unique<juce::FileOutputStream>(file);
+    if (!fileStream->openedOk())
+        return nullptr;
+
+    // FileOutputStream appends to an existing file.
+    fileStream->setPosition(0);
+    fileStream->truncate();
+    std::unique_ptr<juce::OutputStream> stream = std::move(fileStream);
+
+    auto options = juce::AudioFormatWriterOptions{}
+                       .withSampleRate(settings.sampleRate)
+                       .withNumChannels(exportChannels)
+                       .withBitsPerSample(settings.bitDepth);
+
+    return wav.createWriterFor(stream, options);
+}
+
+float OfflineExporter::getNormalizeGain(const LoudnessMeter& measured, bool& heldByCeiling) const
+{
+    heldByCeiling = false;
+    const float peak = measured.getTruePeak();
+    if (peak <= 0.0f)
+        return 1.0f;
+
+    const double peakGain = juce::Decibels::decibelsToGain(settings.normalize.truePeakCeiling, -200.0) / (double)peak;
+    if (settings.normalize.type != Normalize::Type::loudness)
+        return (float)peakGain;
+
+    // Silence and very short files have no gated loudness; leave them as they are.
+    const double loudness = measured.getIntegratedLoudness();
+    if (!std::isfinite(loudness))
+        return 1.0f;
+
+    // No limiter: a quieter result is preferred to clipping the true peak.
+    const double loudnessGain = juce::Decibels::decibelsToGain(settings.normalize.targetLoudness - loudness, -200.0);
+    heldByCeiling = peakGain < loudnessGain;
+    return (float)juce::jmin(loudnessGain, peakGain);
+}
+
+void OfflineExporter::addMeasurement(const juce::File& file, const LoudnessMeter& meter, float gain, bool heldByCeiling)
+{
+    Measurement measurement;
+    measurement.file = file;
+    measurement.loudness = meter.getIntegratedLoudness();
+    measurement.truePeak = meter.getTruePeak();
+    measurement.gain = gain;
+    measurement.heldByCeiling = heldByCeiling;
+
+    const juce::ScopedLock lock(writtenFilesLock);
+    measurements.push_back(measurement);
+}
+
+juce::String OfflineExporter::getMeasurementReport() const
+{
+    // Stems finish in any order; their names start with the track number.
+    auto sorted = measurements;
+    std::sort(sorted.begin(), sorted.end(), [](const Measurement& a, const Measurement& b)
+    {
+        return a.file.getFileName().compareNatural(b.file.getFileName()) < 0;
+    });
+
+    const auto formatDb = [](double db, const char* unit)
+    {
+        return std::isfinite(db) ? juce::String(db, 1) + " " + unit : juce::String("silent");
+    };
+
+    juce::String report;
+    for (const auto& m : sorted)
+    {
+        report << "\n" << m.file.getFileName() << ": "
+               << formatDb(m.loudness, "LUFS") << ", "
+               << formatDb(LoudnessMeter::truePeakToDecibels(m.truePeak), "dBTP");
+        if (settings.normalize.type != Normalize::Type::none)
+            report << ", gain " << juce::String(juce::Decibels::gainToDecibels(m.gain, -200.0f), 1) << " dB";
+        if (m.heldByCeiling)
+            report << " (held by the true-peak ceiling)";
+    }
+
+    return report.isEmpty() ? report : "\n" + report;
+}
+
+bool OfflineExporter::renderTrackToBuffer(Track& track,
+                                          juce::AudioBuffer<float>& buffer,
+                                          int64 startSample,
+                                          double sampleRate,
+                                          const std::function<bool(int)>& onBlockRendered)
+{
+    const int channels = buffer.getNumChannels();
+    std::vector<float*> ptrs((size_t)channels, nullptr);
+
+    for (int pos = 0; pos < buffer.getNumSamples(); pos += renderBlockSize)
+    {
+        const int len = juce::jmin(renderBlockSize, buffer.getNumSamples() - pos);
+        for (int ch = 0; ch < channels; ++ch)
+            ptrs[(size_t)ch] = buffer.getWritePointer(ch, pos);
+
+        juce::AudioBuffer<float> view(ptrs.data(), channels, len);
+        track.render(view, startSample + pos, sampleRate);
+        if (!onBlockRendered(len))
+            return false;
+    }
+
+    return true;
+}
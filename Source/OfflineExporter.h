@@ -0,0 +1,104 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "LoudnessMeter.h"
+#include "Track.h"
+
+// Renders an export in the background behind a progress window that can be cancelled.
+// The tracks are copied up front and rendered concurrently on a thread pool: each stem is
+// rendered and written by its own job, and a mix is rendered in chunks whose per-track
+// buffers are summed in track order. Audio is streamed to the writer a chunk at a time,
+// so memory use does not grow with the project length; normalizing adds a measuring pass.
+// Every file written is measured for loudness and true peak, and the results are reported
+// when the export finishes.
+class OfflineExporter : public juce::ThreadWithProgressWindow
+{
+public:
+    enum class Mode
+    {
+        singleTrack, // the only track to destination
+        stems,       // one file per track inside the destination folder
+        mix          // every track summed to destination
+    };
+
+    struct Normalize
+    {
+        enum class Type
+        {
+            none,
+            peak,     // true peak to the ceiling
+            loudness  // integrated loudness to the target, lowered if the true peak would pass the ceiling
+        };
+
+        Type type = Type::none;
+        double targetLoudness = -14.0;  // LUFS
+        double truePeakCeiling = -1.0;  // dBTP
+    };
+
+    struct Settings
+    {
+        Mode mode = Mode::mix;
+        juce::File destination;
+        Normalize normalize;
+        double sampleRate = 44100.0;
+        int bitDepth = 24;
+        Sample::Interpolation interpolation = Sample::Interpolation::sinc;
+        int numThreads = juce::SystemStats::getNumCpus();
+    };
+
+    OfflineExporter(const juce::Array<Track>& tracksIn, const Settings& settingsIn, juce::Component* componentToCentreAround);
+    ~OfflineExporter() override;
+
+    // Called on the message thread once the result has been reported.
+    std::function<void()> onFinished;
+
+    static int64 getTrackEndSamples(const Track& track, double sampleRate);
+
+    void run() override;
+    void threadComplete(bool userPressedCancel) override;
+
+private:
+    class StemJob;
+    class MixChunkJob;
+
+    // What was written to one file, after normalizing.
+    struct Measurement
+    {
+        juce::File file;
+        double loudness = 0.0;  // LUFS
+        float truePeak = 0.0f;
+        float gain = 1.0f;
+        bool heldByCeiling = false;  // the loudness target was given up to keep the true peak down
+    };
+
+    bool exportStems(juce::ThreadPool& pool);
+    bool exportMix(juce::ThreadPool& pool);
+    bool renderMixPass(juce::ThreadPool& pool, int64 length, juce::AudioFormatWriter* writer, float gain, LoudnessMeter& meter);
+    bool waitForJobs(juce::ThreadPool& pool);
+    void updateProgress();
+
+    juce::File getStemFile(int trackIndex) const;
+    std::unique_ptr<juce::AudioFormatWriter> createWavWriter(const juce::File& file) const;
+    float getNormalizeGain(const LoudnessMeter& measured, bool& heldByCeiling) const;
+    void addMeasurement(const juce::File& file, const LoudnessMeter& meter, float gain, bool heldByCeiling);
+    juce::String getMeasurementReport() const;
+    static bool renderTrackToBuffer(Track& track, juce::AudioBuffer<float>& buffer, int64 startSample, double sampleRate, const std::function<bool(int)>& onBlockRendered);
+
+    juce::Array<Track> tracks;
+    Settings settings;
+    juce::CriticalSection writtenFilesLock;
+    juce::Array<juce::File> writtenFiles;
+    std::vector<Measurement> measurements;
+
+    std::atomic<int64> samplesRendered {0};
+    int64 totalSamples = 1;
+    std::atomic<int> pendingJobs {0};
+    juce::WaitableEvent jobsFinished;
+    std::atomic<bool> anyWriteFailed {false};
+    bool succeeded = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineExporter)
+};
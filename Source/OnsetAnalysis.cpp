@@ -0,0 +1,241 @@
+#include "OnsetAnalysis.h"
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// Upper edges of the bands in Hz; the last band runs to Nyquist.
+constexpr double bandUpperHz[OnsetAnalysis::numBands - 1] = { 200.0, 1000.0, 5000.0 };
+constexpr double lowestHz = 30.0;
+// Frames handed to one job; shorter files are analysed on the calling thread.
+constexpr int chunkFrames = 2048;
+// Weight of magnitude inside the log, so quiet partials still register.
+constexpr float logCompression = 100.0f;
+}
+
+class OnsetAnalysis::ChunkJob : public juce::ThreadPoolJob
+{
+public:
+    ChunkJob(OnsetAnalysis& ownerIn, const Sample& sampleIn, int firstFrameIn, int numFramesIn)
+        : juce::ThreadPoolJob("Onset analysis"),
+          owner(ownerIn),
+          sample(sampleIn),
+          firstFrame(firstFrameIn),
+          numFrames(numFramesIn)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        owner.analyseFrames(sample, firstFrame, numFrames);
+        return jobHasFinished;
+    }
+
+private:
+    OnsetAnalysis& owner;
+    const Sample& sample;
+    const int firstFrame;
+    const int numFrames;
+};
+
+OnsetAnalysis::OnsetAnalysis(int64 numSamplesIn, double sampleRateIn, int numFrames)
+    : numSamples(numSamplesIn),
+      sampleRate(sampleRateIn)
+{
+    const int numBins = fftSize / 2 + 1;
+    const auto hzToBin = [this, numBins](double hz)
+    {
+        return juce::jlimit(1, numBins, (int)std::round(hz * (double)fftSize / sampleRate));
+    };
+
+    bandEdges[0] = hzToBin(lowestHz);
+    for (int b = 0; b < numBands - 1; ++b)
+        bandEdges[b + 1] = juce::jmax(bandEdges[b] + 1, hzToBin(bandUpperHz[b]));
+    bandEdges[numBands] = juce::jmax(bandEdges[numBands - 1] + 1, numBins);
+
+    for (auto& band : bandStrength)
+        band.assign((size_t)numFrames, 0.0f);
+    strength.assign((size_t)numFrames, 0.0f);
+}
+
+std::unique_ptr<OnsetAnalysis> OnsetAnalysis::analyse(const Sample& sample, int numThreads)
+{
+    if (sample.getNumSamples() <= 0 || sample.getNumChannels() <= 0)
+        return nullptr;
+
+    // Frame indices are ints; longer files are analysed up to that limit.
+    const int64 maxFrames = std::numeric_limits<int>::max() - 1;
+    const int numFrames = (int)juce::jmin(maxFrames, sample.getNumSamples() / hopSize + 1);
+    std::unique_ptr<OnsetAnalysis> analysis(new OnsetAnalysis(sample.getNumSamples(),
+                                                              juce::jmax(1.0, sample.getSampleRate()),
+                                                              numFrames));
+
+    const int numChunks = (numFrames + chunkFrames - 1) / chunkFrames;
+    const int threadsToUse = juce::jmin(numThreads, numChunks);
+    if (threadsToUse <= 1)
+    {
+        analysis->analyseFrames(sample, 0, numFrames);
+    }
+    else
+    {
+        juce::ThreadPool pool(juce::ThreadPoolOptions{}
+                                  .withThreadName("Onset analysis")
+                                  .withNumberOfThreads(threadsToUse));
+
+        juce::OwnedArray<ChunkJob> jobs;
+        for (int first = 0; first < numFrames; first += chunkFrames)
+            jobs.add(new ChunkJob(*analysis, sample, first, juce::jmin(chunkFrames, numFrames - first)));
+        for (auto* job : jobs)
+            pool.addJob(job, false);
+        for (auto* job : jobs)
+            pool.waitForJobToFinish(job, -1);
+    }
+
+    analysis->combineBands();
+    return analysis;
+}
+
+void OnsetAnalysis::analyseFrames(const Sample& sample, int firstFrame, int numFramesToAnalyse)
+{
+    constexpr int numBins = fftSize / 2 + 1;
+    const int numChannels = sample.getNumChannels();
+    const float channelGain = 1.0f / (float)numChannels;
+
+    juce::dsp::FFT fft(fftOrder);
+    juce::dsp::WindowingFunction<float> window((size_t)fftSize, juce::dsp::WindowingFunction<float>::hann, false);
+    std::vector<float> mono((size_t)fftSize);
+    std::vector<float> channelFrames((size_t)fftSize);
+    std::vector<float> fftData((size_t)fftSize * 2);
+    std::vector<float> real((size_t)numBins);
+    std::vector<float> imag((size_t)numBins);
+    std::vector<float> power((size_t)numBins);
+    std::vector<float> previous((size_t)numBins, 0.0f);
+    std::vector<float> current((size_t)numBins, 0.0f);
+
+    // Each chunk starts one frame early so its first flux has a previous spectrum to
+    // compare with, exactly as if the whole file were analysed in one go.
+    for (int frame = firstFrame - 1; frame < firstFrame + numFramesToAnalyse; ++frame)
+    {
+        if (frame < 0)
+            continue;
+
+        // The frame is centred on its hop position; audio before the start and after the
+        // end of the sample counts as silence.
+        const int64 frameStart = (int64)frame * hopSize - fftSize / 2;
+        const int64 validStart = juce::jmax((int64)0, frameStart);
+        const int64 validEnd = juce::jmin(numSamples, frameStart + fftSize);
+        const int offset = (int)(validStart - frameStart);
+        const int numValid = (int)juce::jmax((int64)0, validEnd - validStart);
+
+        std::fill(mono.begin(), mono.end(), 0.0f);
+        for (int ch = 0; ch < numChannels && numValid > 0; ++ch)
+        {
+            sample.readFrames(ch, validStart, numValid, channelFrames.data());
+            juce::FloatVectorOperations::addWithMultiply(mono.data() + offset, channelFrames.data(), channelGain, numValid);
+        }
+
+        window.multiplyWithWindowingTable(mono.data(), (size_t)fftSize);
+        std::copy(mono.begin(), mono.end(), fftData.begin());
+        fft.performRealOnlyForwardTransform(fftData.data(), true);
+
+        // Split the interleaved bins so the power sum runs on whole vectors.
+        for (int k = 0; k < numBins; ++k)
+        {
+            real[(size_t)k] = fftData[(size_t)(2 * k)];
+            imag[(size_t)k] = fftData[(size_t)(2 * k + 1)];
+        }
+        juce::FloatVectorOperations::multiply(power.data(), real.data(), real.data(), numBins);
+        juce::FloatVectorOperations::addWithMultiply(power.data(), imag.data(), imag.data(), numBins);
+
+        for (int k = 0; k < numBins; ++k)
+            current[(size_t)k] = std::log1p(logCompression * std::sqrt(power[(size_t)k]));
+
+        if (frame >= firstFrame && frame > 0)
+        {
+            for (int b = 0; b < numBands; ++b)
+            {
+                // Only rising partials count: a note ending is not an onset.
+                float flux = 0.0f;
+                for (int k = bandEdges[b]; k < bandEdges[b + 1]; ++k)
+                    flux += juce::jmax(0.0f, current[(size_t)k] - previous[(size_t)k]);
+                bandStrength[b][(size_t)frame] = flux / (float)(bandEdges[b + 1] - bandEdges[b]);
+            }
+        }
+
+        std::swap(previous, current);
+    }
+}
+
+void OnsetAnalysis::combineBands()
+{
+    // The first frames reach back before the start of the sample, so audio that starts
+    // loud looks like a huge onset there; they are left out when finding each band's peak.
+    const int firstFullFrame = juce::jmin((int)strength.size() - 1, fftSize / (2 * hopSize));
+
+    std::fill(strength.begin(), strength.end(), 0.0f);
+    for (auto& band : bandStrength)
+    {
+        const auto peak = juce::FloatVectorOperations::findMaximum(band.data() + firstFullFrame, (int)band.size() - firstFullFrame);
+        if (peak > 0.0f)
+        {
+            juce::FloatVectorOperations::multiply(band.data(), 1.0f / peak, (int)band.size());
+            juce::FloatVectorOperations::clip(band.data(), band.data(), 0.0f, 1.0f, (int)band.size());
+        }
+        juce::FloatVectorOperations::addWithMultiply(strength.data(), band.data(), 1.0f / (float)numBands, (int)strength.size());
+    }
+
+    const auto peak = juce::FloatVectorOperations::findMaximum(strength.data(), (int)strength.size());
+    if (peak > 0.0f)
+        juce::FloatVectorOperations::multiply(strength.data(), 1.0f / peak, (int)strength.size());
+}
+
+std::vector<int64> OnsetAnalysis::findOnsets(double sensitivity, double minGapSeconds, int maxOnsets) const
+{
+    std::vector<int64> onsets;
+    const int numFrames = getNumFrames();
+    if (numFrames < 3 || maxOnsets <= 0)
+        return onsets;
+
+    // A frame must beat the mean of the surrounding 100 ms by a margin that shrinks as
+    // sensitivity rises.
+    const double looseness = 1.0 - juce::jlimit(0.0, 1.0, sensitivity);
+    const double scale = 1.0 + 1.5 * looseness;
+    const double floor = 0.01 + 0.25 * looseness;
+    const int halfWindow = juce::jmax(2, (int)std::round(0.1 * sampleRate / (double)hopSize));
+    const int minGapFrames = juce::jmax(1, (int)std::round(minGapSeconds * sampleRate / (double)hopSize));
+
+    // Running sum over [i - halfWindow, i + halfWindow].
+    double windowSum = 0.0;
+    for (int k = 0; k <= juce::jmin(halfWindow, numFrames - 1); ++k)
+        windowSum += strength[(size_t)k];
+
+    int lastAccepted = -minGapFrames;
+    for (int i = 0; i < numFrames; ++i)
+    {
+        if (i > 0)
+        {
+            if (i + halfWindow < numFrames)
+                windowSum += strength[(size_t)(i + halfWindow)];
+            if (i - halfWindow - 1 >= 0)
+                windowSum -= strength[(size_t)(i - halfWindow - 1)];
+        }
+
+        if (i == 0 || i == numFrames - 1)
+            continue;
+
+        const float value = strength[(size_t)i];
+        if (value <= strength[(size_t)(i - 1)] || value < strength[(size_t)(i + 1)])
+            continue;
+
+        const int windowSize = juce::jmin(numFrames - 1, i + halfWindow) - juce::jmax(0, i - halfWindow) + 1;
+        const double threshold = windowSum / (double)windowSize * scale + floor;
+        if ((double)value > threshold && i - lastAccepted >= minGapFrames)
+        {
+            onsets.push_back(getFrameSample(i));
+            lastAccepted = i;
+            if ((int)onsets.size() >= maxOnsets)
+                break;
+        }
+    }
+    return onsets;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "Sample.h"
+
+// Onset strength of a sample, measured once so slice points can be picked again at any
+// sensitivity without touching the audio. All channels are mixed to mono and cut into
+// overlapping windowed frames; the strength of a frame is the rise in log magnitude
+// spectrum since the previous frame (spectral flux), summed separately in a few frequency
+// bands. Each band is scaled to its own loudest onset before the bands are averaged, so
+// hi-hats count as much as kicks.
+class OnsetAnalysis
+{
+public:
+    static constexpr int fftOrder = 10;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 4;
+    static constexpr int numBands = 4;
+
+    // Long files are split into chunks of frames analysed on up to numThreads threads.
+    static std::unique_ptr<OnsetAnalysis> analyse(const Sample& sample, int numThreads);
+
+    int64 getNumSamples() const { return numSamples; }
+    double getSampleRate() const { return sampleRate; }
+    int getNumFrames() const { return (int)strength.size(); }
+    // Sample at the centre of a frame.
+    int64 getFrameSample(int frame) const { return (int64)frame * hopSize; }
+
+    // Combined onset strength per frame, 0 to 1.
+    const std::vector<float>& getStrength() const { return strength; }
+    // Onset strength of one band per frame, 0 to 1; band 0 is the lowest.
+    const std::vector<float>& getBandStrength(int band) const { return bandStrength[(size_t)juce::jlimit(0, numBands - 1, band)]; }
+
+    // Frames that stand out from their neighbourhood, as sample positions in ascending
+    // order. Higher sensitivity (0 to 1) accepts weaker onsets. Onsets closer than
+    // minGapSeconds to the previous one are skipped, and at most maxOnsets are returned.
+    std::vector<int64> findOnsets(double sensitivity, double minGapSeconds, int maxOnsets) const;
+
+private:
+    class ChunkJob;
+
+    OnsetAnalysis(int64 numSamplesIn, double sampleRateIn, int numFrames);
+
+    void analyseFrames(const Sample& sample, int firstFrame, int numFramesToAnalyse);
+    void combineBands();
+
+    int64 numSamples = 0;
+    double sampleRate = 44100.0;
+    int bandEdges[numBands + 1] {};  // FFT bins
+    std::vector<float> bandStrength[numBands];
+    std::vector<float> strength;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OnsetAnalysis)
+};
@@ -0,0 +1,105 @@
+#include "PeakCache.h"
+
+namespace
+{
+constexpr int cacheMagic = 0x4d425650; // "MBVP"
+constexpr int cacheVersion = 1;
+constexpr int hashChunkBytes = 1 << 16;
+}
+
+void PeakCache::setDirectory(const juce::File& newDirectory)
+{
+    const juce::ScopedLock sl(lock);
+    directory = newDirectory;
+}
+
+juce::File PeakCache::getCacheFile(const juce::String& sourcePath) const
+{
+    const juce::ScopedLock sl(lock);
+    if (directory == juce::File())
+        return {};
+    return directory.getChildFile(juce::String::toHexString(sourcePath.hashCode64()) + ".peaks");
+}
+
+int64 PeakCache::hashContents(const juce::File& sourceFile, int64 size)
+{
+    // FNV-1a over the first, middle and last chunk: enough to notice a file replaced by
+    // another of the same size and date without reading all of it.
+    juce::FileInputStream in(sourceFile);
+    if (!in.openedOk())
+        return 0;
+
+    uint64 hash = 14695981039346656037ull;
+    juce::HeapBlock<uint8> chunk((size_t)hashChunkBytes);
+    for (const int64 position : { (int64)0, size / 2, size - hashChunkBytes })
+    {
+        if (!in.setPosition(juce::jmax<int64>(0, position)))
+            return 0;
+        const int bytesRead = in.read(chunk.get(), hashChunkBytes);
+        for (int i = 0; i < bytesRead; ++i)
+        {
+            hash ^= chunk[i];
+            hash *= 1099511628211ull;
+        }
+    }
+    return (int64)hash;
+}
+
+PeakCache::SourceInfo PeakCache::getSourceInfo(const juce::File& sourceFile)
+{
+    const auto target = sourceFile.getLinkedTarget();
+    SourceInfo info;
+    info.path = target.getFullPathName();
+    info.size = target.getSize();
+    info.modificationTime = target.getLastModificationTime().toMilliseconds();
+    info.contentHash = hashContents(target, info.size);
+    return info;
+}
+
+std::shared_ptr<const SamplePeaks> PeakCache::load(const juce::File& sourceFile) const
+{
+    const auto info = getSourceInfo(sourceFile);
+    const auto cacheFile = getCacheFile(info.path);
+    if (!cacheFile.existsAsFile())
+        return nullptr;
+
+    juce::FileInputStream in(cacheFile);
+    if (!in.openedOk() || in.readInt() != cacheMagic || in.readInt() != cacheVersion)
+        return nullptr;
+
+    if (in.readString() != info.path
+        || in.readInt64() != info.size
+        || in.readInt64() != info.modificationTime
+        || in.readInt64() != info.contentHash)
+        return nullptr;
+
+    return SamplePeaks::readFrom(in);
+}
+
+void PeakCache::store(const juce::File& sourceFile, const SamplePeaks& peaks) const
+{
+    const auto info = getSourceInfo(sourceFile);
+    const auto cacheFile = getCacheFile(info.path);
+    if (cacheFile == juce::File() || !cacheFile.getParentDirectory().createDirectory())
+        return;
+
+    // Written to a temporary file first so a reader never sees half an entry.
+    juce::TemporaryFile temp(cacheFile);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+            return;
+
+        out.writeInt(cacheMagic);
+        out.writeInt(cacheVersion);
+        out.writeString(info.path);
+        out.writeInt64(info.size);
+        out.writeInt64(info.modificationTime);
+        out.writeInt64(info.contentHash);
+        peaks.writeTo(out);
+        out.flush();
+        if (out.getStatus().failed())
+            return;
+    }
+    temp.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include "SamplePeaks.h"
+
+// Keeps the peak summary of every source file in a sidecar file, so reopening a project
+// does not have to scan all of its audio again. Entries are checked against the source's
+// path, size, modification time and a hash of parts of its contents, and are rebuilt when
+// any of them change. Safe to use from several threads.
+class PeakCache
+{
+public:
+    PeakCache() = default;
+
+    // Where the sidecar files live; caching is off until this is set.
+    void setDirectory(const juce::File& newDirectory);
+
+    std::shared_ptr<const SamplePeaks> load(const juce::File& sourceFile) const;
+    void store(const juce::File& sourceFile, const SamplePeaks& peaks) const;
+
+private:
+    struct SourceInfo
+    {
+        juce::String path;
+        int64 size = 0;
+        int64 modificationTime = 0;
+        int64 contentHash = 0;
+    };
+
+    static SourceInfo getSourceInfo(const juce::File& sourceFile);
+    static int64 hashContents(const juce::File& sourceFile, int64 size);
+    juce::File getCacheFile(const juce::String& sourcePath) const;
+
+    juce::CriticalSection lock;
+    juce::File directory;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PeakCache)
+};
@@ -0,0 +1,415 @@
+#include "ProjectFile.h"
+#include <limits>
+#include <map>
+
+namespace
+{
+constexpr int projectMagic = 0x4d425646; // "MBVF"
+constexpr int projectVersion = 1;
+
+constexpr int makeChunkId(const char (&id)[5])
+{
+    return (int)id[0] | ((int)id[1] << 8) | ((int)id[2] << 16) | ((int)id[3] << 24);
+}
+
+constexpr int settingsChunkId = makeChunkId("HEAD");
+constexpr int stringsChunkId = makeChunkId("STRS");
+constexpr int tracksChunkId = makeChunkId("TRKS");
+
+// Smallest possible size of each record, used to reject counts a damaged file cannot hold.
+constexpr int minTrackBytes = 64;
+constexpr int minClipBytes = 40;
+constexpr int pointBytes = 16;
+constexpr int sliceBytes = 36;
+
+// More than any editor produces; a larger count means a damaged file.
+constexpr int maxWarpPoints = 1024;
+constexpr int maxSlices = 4096;
+
+enum TrackFlags
+{
+    trackSnapEnabled = 1 << 0,
+    trackLoopMarker1 = 1 << 1,
+    trackLoopMarker2 = 1 << 2
+};
+
+enum ClipFlags
+{
+    clipFitToSnapDivision = 1 << 0,
+    clipMuted = 1 << 1,
+    clipSlicingEnabled = 1 << 2,
+    clipWarpRelative = 1 << 3,
+    clipWarpSmooth = 1 << 4
+};
+
+class StringTable
+{
+public:
+    int add(const juce::String& text)
+    {
+        const auto found = indices.find(text);
+        if (found != indices.end())
+            return found->second;
+
+        const int index = strings.size();
+        indices.emplace(text, index);
+        strings.add(text);
+        return index;
+    }
+
+    const juce::StringArray& getStrings() const { return strings; }
+
+private:
+    std::map<juce::String, int> indices;
+    juce::StringArray strings;
+};
+
+void writeChunk(juce::OutputStream& out, int id, const juce::MemoryOutputStream& data)
+{
+    out.writeInt(id);
+    out.writeInt64((int64)data.getDataSize());
+    out.write(data.getData(), data.getDataSize());
+}
+
+int readCount(juce::InputStream& in, int minBytesEach)
+{
+    const int count = in.readCompressedInt();
+    if (count < 0 || (int64)count * minBytesEach > in.getNumBytesRemaining())
+        return -1;
+    return count;
+}
+
+bool readString(juce::InputStream& in, const juce::StringArray& strings, juce::String& result)
+{
+    const int index = in.readCompressedInt();
+    if (index < 0 || index >= strings.size())
+        return false;
+    result = strings[index];
+    return true;
+}
+
+void writeAutomation(juce::OutputStream& out, const juce::Array<TrackAutomationPoint>& points)
+{
+    out.writeCompressedInt(points.size());
+    for (const auto& p : points)
+    {
+        out.writeInt64(p.samplePosition);
+        out.writeDouble(p.value);
+    }
+}
+
+bool readAutomation(juce::InputStream& in, juce::Array<TrackAutomationPoint>& points)
+{
+    const int count = readCount(in, pointBytes);
+    if (count < 0)
+        return false;
+
+    points.ensureStorageAllocated(count);
+    for (int i = 0; i < count; ++i)
+    {
+        TrackAutomationPoint p;
+        p.samplePosition = in.readInt64();
+        p.value = in.readDouble();
+        points.add(p);
+    }
+    return true;
+}
+
+void writeClip(juce::OutputStream& out, StringTable& strings, const TrackClip& clip)
+{
+    int flags = 0;
+    if (clip.fitToSnapDivision) flags |= clipFitToSnapDivision;
+    if (clip.muted) flags |= clipMuted;
+    if (clip.slicing.enabled) flags |= clipSlicingEnabled;
+    if (clip.warpCurve.isRelativeMode()) flags |= clipWarpRelative;
+    if (clip.warpCurve.getSmoothRateChanges()) flags |= clipWarpSmooth;
+
+    out.writeCompressedInt(strings.add(clip.name));
+    out.writeCompressedInt(strings.add(clip.sourceFilePath));
+    out.writeInt64(clip.startSample);
+    out.writeInt64(clip.lengthSamples);
+    out.writeFloat(clip.sourceStartNorm);
+    out.writeFloat(clip.sourceEndNorm);
+    out.writeInt(clip.fitLengthUnits);
+    out.writeFloat(clip.gain);
+    out.writeFloat(clip.fadeInNorm);
+    out.writeFloat(clip.fadeOutNorm);
+    out.writeByte((char)flags);
+    out.writeByte((char)clip.slicing.mode);
+
+    const auto& warpPoints = clip.warpCurve.getPoints();
+    out.writeCompressedInt(warpPoints.size());
+    for (const auto& p : warpPoints)
+    {
+        out.writeDouble(p.t);
+        out.writeDouble(p.v);
+    }
+
+    out.writeCompressedInt(clip.slicing.slices.size());
+    for (const auto& s : clip.slicing.slices)
+    {
+        out.writeDouble(s.startNorm);
+        out.writeDouble(s.endNorm);
+        out.writeDouble(s.playProbability);
+        out.writeInt(s.ratchetRepeats);
+        out.writeDouble(s.repeatProbability);
+    }
+}
+
+bool readClip(juce::InputStream& in, const juce::StringArray& strings, TrackClip& clip)
+{
+    if (!readString(in, strings, clip.name) || !readString(in, strings, clip.sourceFilePath))
+        return false;
+
+    clip.startSample = in.readInt64();
+    clip.lengthSamples = in.readInt64();
+    clip.sourceStartNorm = juce::jlimit(0.0f, 1.0f, in.readFloat());
+    clip.sourceEndNorm = juce::jlimit(clip.sourceStartNorm, 1.0f, in.readFloat());
+    clip.fitLengthUnits = juce::jmax(1, in.readInt());
+    clip.gain = in.readFloat();
+    clip.fadeInNorm = in.readFloat();
+    clip.fadeOutNorm = in.readFloat();
+    const int flags = (uint8)in.readByte();
+    clip.fitToSnapDivision = (flags & clipFitToSnapDivision) != 0;
+    clip.muted = (flags & clipMuted) != 0;
+    clip.slicing.enabled = (flags & clipSlicingEnabled) != 0;
+    clip.slicing.mode = (SlicePlaybackMode)juce::jlimit(0, 2, (int)(uint8)in.readByte());
+
+    const int numWarpPoints = readCount(in, pointBytes);
+    if (numWarpPoints < 0 || numWarpPoints > maxWarpPoints)
+        return false;
+    juce::Array<WarpCurve::Point> warpPoints;
+    warpPoints.ensureStorageAllocated(numWarpPoints);
+    for (int i = 0; i < numWarpPoints; ++i)
+    {
+        WarpCurve::Point p;
+        p.t = in.readDouble();
+        p.v = in.readDouble();
+        warpPoints.add(p);
+    }
+    clip.warpCurve = WarpCurve::linear();
+    if (!warpPoints.isEmpty())
+        clip.warpCurve.setPoints(warpPoints);
+    clip.warpCurve.setRelativeMode((flags & clipWarpRelative) != 0);
+    clip.warpCurve.setSmoothRateChanges((flags & clipWarpSmooth) != 0);
+
+    const int numSlices = readCount(in, sliceBytes);
+    if (numSlices < 0 || numSlices > maxSlices)
+        return false;
+    clip.slicing.slices.ensureStorageAllocated(numSlices);
+    for (int i = 0; i < numSlices; ++i)
+    {
+        BeatSlice s;
+        s.startNorm = in.readDouble();
+        s.endNorm = in.readDouble();
+        s.playProbability = in.readDouble();
+        s.ratchetRepeats = in.readInt();
+        s.repeatProbability = in.readDouble();
+        clip.slicing.slices.add(s);
+    }
+    return true;
+}
+
+void writeTrack(juce::OutputStream& out, StringTable& strings, const Track& track)
+{
+    int flags = 0;
+    if (track.isSnapEnabled()) flags |= trackSnapEnabled;
+    if (track.hasLoopMarker(0)) flags |= trackLoopMarker1;
+    if (track.hasLoopMarker(1)) flags |= trackLoopMarker2;
+
+    out.writeCompressedInt(strings.add(track.getName()));
+    out.writeDouble(track.getTempoBpm());
+    out.writeInt(track.getTimeSigNumerator());
+    out.writeInt(track.getTimeSigDenominator());
+    out.writeByte((char)flags);
+    out.writeByte((char)track.getSnapDivision());
+    out.writeDouble(track.getZoomX());
+    out.writeDouble(track.getZoomY());
+    out.writeDouble(track.getVolume());
+    out.writeDouble(track.getPan());
+    out.writeInt64(track.getLoopMarker(0));
+    out.writeInt64(track.getLoopMarker(1));
+    writeAutomation(out, track.getVolumeAutomation());
+    writeAutomation(out, track.getPanAutomation());
+
+    out.writeCompressedInt(track.getClips().size());
+    for (const auto& clip : track.getClips())
+        writeClip(out, strings, clip);
+}
+
+bool readTrack(juce::InputStream& in, const juce::StringArray& strings, Track& track)
+{
+    juce::String name;
+    if (!readString(in, strings, name))
+        return false;
+
+    track.setName(name);
+    track.setTempoBpm(in.readDouble());
+    const int numerator = in.readInt();
+    track.setTimeSignature(numerator, in.readInt());
+    const int flags = (uint8)in.readByte();
+    track.setSnapEnabled((flags & trackSnapEnabled) != 0);
+    track.setSnapDivision((Track::SnapDivision)juce::jlimit(0, 6, (int)(uint8)in.readByte()));
+    track.setZoomX(in.readDouble());
+    track.setZoomY(in.readDouble());
+    track.setVolume(in.readDouble());
+    track.setPan(in.readDouble());
+    const int64 loopMarker1 = in.readInt64();
+    const int64 loopMarker2 = in.readInt64();
+    if ((flags & trackLoopMarker1) != 0)
+        track.setLoopMarker(0, loopMarker1);
+    if ((flags & trackLoopMarker2) != 0)
+        track.setLoopMarker(1, loopMarker2);
+
+    juce::Array<TrackAutomationPoint> volumePoints;
+    juce::Array<TrackAutomationPoint> panPoints;
+    if (!readAutomation(in, volumePoints) || !readAutomation(in, panPoints))
+        return false;
+    track.setVolumeAutomation(volumePoints);
+    track.setPanAutomation(panPoints);
+
+    const int numClips = readCount(in, minClipBytes);
+    if (numClips < 0)
+        return false;
+    juce::Array<TrackClip> clips;
+    clips.ensureStorageAllocated(numClips);
+    for (int i = 0; i < numClips; ++i)
+    {
+        TrackClip clip;
+        if (!readClip(in, strings, clip))
+            return false;
+        clips.add(std::move(clip));
+    }
+    track.setClips(clips);
+    return true;
+}
+}
+
+bool ProjectFile::write(juce::OutputStream& out, const ProjectSettings& settings, const juce::Array<Track>& tracks)
+{
+    // The track records fill the string table, so they are packed first and written last.
+    StringTable strings;
+    juce::MemoryOutputStream tracksData;
+    tracksData.writeCompressedInt(tracks.size());
+    for (const auto& track : tracks)
+        writeTrack(tracksData, strings, track);
+
+    juce::MemoryOutputStream settingsData;
+    settingsData.writeDouble(settings.sampleRate);
+    settingsData.writeInt(settings.exportBitDepth);
+    settingsData.writeInt((int)settings.sampleEncoding);
+    settingsData.writeInt(settings.selectedTrackIndex);
+    settingsData.writeInt(settings.selectedClipIndex);
+    settingsData.writeInt64(settings.playheadSample);
+
+    juce::MemoryOutputStream stringsData;
+    stringsData.writeCompressedInt(strings.getStrings().size());
+    for (const auto& text : strings.getStrings())
+        stringsData.writeString(text);
+
+    out.writeInt(projectMagic);
+    out.writeInt(projectVersion);
+    writeChunk(out, settingsChunkId, settingsData);
+    writeChunk(out, stringsChunkId, stringsData);
+    writeChunk(out, tracksChunkId, tracksData);
+    return true;
+}
+
+bool ProjectFile::read(juce::InputStream& in, ProjectSettings& settings, juce::Array<Track>& tracks)
+{
+    if (in.readInt() != projectMagic)
+        return false;
+    const int version = in.readInt();
+    if (version < 1 || version > projectVersion)
+        return false;
+
+    ProjectSettings loadedSettings;
+    juce::StringArray strings;
+    juce::Array<Track> loadedTracks;
+    bool hasTracks = false;
+
+    while (!in.isExhausted())
+    {
+        const int id = in.readInt();
+        const int64 size = in.readInt64();
+        if (size < 0 || size > in.getNumBytesRemaining() || size > std::numeric_limits<int>::max())
+            return false;
+
+        juce::MemoryBlock data;
+        if (in.readIntoMemoryBlock(data, (ssize_t)size) != (size_t)size)
+            return false;
+        juce::MemoryInputStream chunk(data, false);
+
+        if (id == settingsChunkId)
+        {
+            loadedSettings.sampleRate = chunk.readDouble();
+            loadedSettings.exportBitDepth = juce::jlimit(16, 32, chunk.readInt());
+            loadedSettings.sampleEncoding = (Sample::Encoding)juce::jlimit(0, 3, chunk.readInt());
+            loadedSettings.selectedTrackIndex = chunk.readInt();
+            loadedSettings.selectedClipIndex = chunk.readInt();
+            loadedSettings.playheadSample = juce::jmax<int64>(0, chunk.readInt64());
+        }
+        else if (id == stringsChunkId)
+        {
+            const int count = readCount(chunk, 1);
+            if (count < 0)
+                return false;
+            strings.ensureStorageAllocated(count);
+            for (int i = 0; i < count; ++i)
+                strings.add(chunk.readString());
+        }
+        else if (id == tracksChunkId)
+        {
+            const int count = readCount(chunk, minTrackBytes);
+            if (count < 0)
+                return false;
+            loadedTracks.ensureStorageAllocated(count);
+            for (int i = 0; i < count; ++i)
+            {
+                Track track({});
+                if (!readTrack(chunk, strings, track))
+                    return false;
+                loadedTracks.add(std::move(track));
+            }
+            hasTracks = true;
+        }
+        // Chunks from newer versions are skipped.
+    }
+
+    if (!hasTracks)
+        return false;
+
+    settings = loadedSettings;
+    tracks.swapWith(loadedTracks);
+    return true;
+}
+
+bool ProjectFile::save(const juce::File& file, const ProjectSettings& settings, const juce::Array<Track>& tracks)
+{
+    juce::TemporaryFile temp(file);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk() || !write(out, settings, tracks))
+            return false;
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool ProjectFile::load(const juce::File& file, ProjectSettings& settings, juce::Array<Track>& tracks)
+{
+    // Read in one go: parsing from memory is much faster than many small file reads.
+    juce::MemoryBlock data;
+    if (!file.loadFileAsData(data))
+        return false;
+    juce::MemoryInputStream in(data, false);
+    return read(in, settings, tracks);
+}
+
+bool ProjectFile::isBinaryProject(const juce::File& file)
+{
+    juce::FileInputStream in(file);
+    return in.openedOk() && in.getTotalLength() >= 8 && in.readInt() == projectMagic;
+}
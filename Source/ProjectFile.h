@@ -0,0 +1,37 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Track.h"
+
+// Project-wide values saved next to the tracks.
+struct ProjectSettings
+{
+    double sampleRate = 44100.0;
+    int exportBitDepth = 24;
+    Sample::Encoding sampleEncoding = Sample::Encoding::automatic;
+    int selectedTrackIndex = 0;
+    int selectedClipIndex = -1;
+    int64 playheadSample = 0;
+};
+
+// The native binary project format. A file is a magic number and version followed by
+// chunks, each a four-character id and a byte length, so readers can skip chunks they do
+// not know. Names and paths live once in a string table and are referred to by index;
+// clips, automation points and slices are packed fixed-layout records. Clips are stored
+// without their audio: the caller resolves sourceFilePath after reading.
+class ProjectFile
+{
+public:
+    static bool write(juce::OutputStream& out, const ProjectSettings& settings, const juce::Array<Track>& tracks);
+    static bool read(juce::InputStream& in, ProjectSettings& settings, juce::Array<Track>& tracks);
+
+    // Writes through a temporary file, so an interrupted save never leaves half a project.
+    static bool save(const juce::File& file, const ProjectSettings& settings, const juce::Array<Track>& tracks);
+    static bool load(const juce::File& file, ProjectSettings& settings, juce::Array<Track>& tracks);
+
+    // True when the file starts like a binary project; anything else is treated as JSON.
+    static bool isBinaryProject(const juce::File& file);
+
+private:
+    ProjectFile() = delete;
+};
@@ -0,0 +1,189 @@
+#include "RenderWorkerPool.h"
+#include <thread>
+
+namespace
+{
+constexpr int spinIterationsBeforeSleep = 4000;
+constexpr int sleepTimeoutMs = 20;
+constexpr int maxJobsPerRun = 0xffff;
+
+uint32 getGeneration(uint64 claim)
+{
+    return (uint32)(claim >> 32);
+}
+
+int getNumJobs(uint64 claim)
+{
+    return (int)((claim >> 16) & 0xffffu);
+}
+
+int getNextIndex(uint64 claim)
+{
+    return (int)(claim & 0xffffu);
+}
+}
+
+class RenderWorkerPool::Worker : public juce::Thread
+{
+public:
+    Worker(RenderWorkerPool& ownerIn, int index)
+        : juce::Thread("Render worker " + juce::String(index + 1)), owner(ownerIn)
+    {
+    }
+
+    void wake() { workAvailable.signal(); }
+
+    void run() override
+    {
+        uint32 seenGeneration = getGeneration(owner.jobClaim.load());
+        while (!threadShouldExit())
+        {
+            const uint32 generation = waitForNextGeneration(seenGeneration);
+            if (generation == seenGeneration)
+                continue;
+
+            seenGeneration = generation;
+            while (owner.runNextJob(generation))
+            {
+            }
+        }
+    }
+
+private:
+    uint32 waitForNextGeneration(uint32 seenGeneration)
+    {
+        const auto policy = owner.waitPolicy.load();
+        if (policy == WaitPolicy::spin)
+        {
+            for (uint32 i = 0;; ++i)
+            {
+                const uint32 generation = getGeneration(owner.jobClaim.load(std::memory_order_acquire));
+                if (generation != seenGeneration || threadShouldExit())
+                    return generation;
+                if ((i & 63) == 63)
+                    std::this_thread::yield();
+            }
+        }
+
+        if (policy == WaitPolicy::spinThenSleep)
+        {
+            for (int i = 0; i < spinIterationsBeforeSleep; ++i)
+            {
+                const uint32 generation = getGeneration(owner.jobClaim.load(std::memory_order_acquire));
+                if (generation != seenGeneration || threadShouldExit())
+                    return generation;
+                if ((i & 63) == 63)
+                    std::this_thread::yield();
+            }
+        }
+
+        workAvailable.wait(sleepTimeoutMs);
+        return getGeneration(owner.jobClaim.load(std::memory_order_acquire));
+    }
+
+    RenderWorkerPool& owner;
+    juce::WaitableEvent workAvailable;
+};
+
+RenderWorkerPool::RenderWorkerPool()
+{
+}
+
+RenderWorkerPool::~RenderWorkerPool()
+{
+    stopWorkers();
+}
+
+void RenderWorkerPool::setNumThreads(int numThreads)
+{
+    numThreads = juce::jlimit(0, 32, numThreads);
+    if (numThreads == numWorkers.load())
+        return;
+
+    // Holding the lock makes run() fall back to the calling thread until we are done.
+    const juce::SpinLock::ScopedLockType lock(configLock);
+    stopWorkers();
+    for (int i = 0; i < numThreads; ++i)
+    {
+        // The audio thread waits for the workers, so they must not be preempted by anything
+        // it would not be. Without the right to realtime scheduling, the highest ordinary
+        // priority is the best we can do.
+        auto* worker = workers.add(new Worker(*this, i));
+        if (!worker->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(10)))
+            worker->startThread(juce::Thread::Priority::highest);
+    }
+    numWorkers.store(numThreads);
+}
+
+void RenderWorkerPool::stopWorkers()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+    for (auto* worker : workers)
+    {
+        worker->wake();
+        worker->stopThread(1000);
+    }
+    workers.clear();
+    numWorkers.store(0);
+}
+
+bool RenderWorkerPool::runNextJob(uint32 generation)
+{
+    uint64 claim = jobClaim.load(std::memory_order_acquire);
+    for (;;)
+    {
+        if (getGeneration(claim) != generation)
+            return false;
+
+        const int index = getNextIndex(claim);
+        if (index >= getNumJobs(claim))
+            return false;
+
+        if (jobClaim.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel))
+        {
+            currentJob.load(std::memory_order_acquire)->runJob(index);
+            jobsDone.fetch_add(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+}
+
+void RenderWorkerPool::run(Job& job, int numJobs)
+{
+    if (numJobs <= 0)
+        return;
+
+    const juce::SpinLock::ScopedTryLockType lock(configLock);
+    if (!lock.isLocked() || workers.isEmpty() || numJobs == 1 || numJobs > maxJobsPerRun)
+    {
+        for (int i = 0; i < numJobs; ++i)
+            job.runJob(i);
+        return;
+    }
+
+    // The previous run has finished every job, so no worker reads these until the new
+    // generation below is published.
+    currentJob.store(&job, std::memory_order_release);
+    jobsDone.store(0, std::memory_order_release);
+
+    const uint32 generation = getGeneration(jobClaim.load()) + 1;
+    jobClaim.store(((uint64)generation << 32) | ((uint64)numJobs << 16), std::memory_order_release);
+
+    if (waitPolicy.load() != WaitPolicy::spin)
+    {
+        for (auto* worker : workers)
+            worker->wake();
+    }
+
+    while (runNextJob(generation))
+    {
+    }
+
+    // Whatever is left is already running on a worker.
+    for (int i = 0; jobsDone.load(std::memory_order_acquire) < numJobs; ++i)
+    {
+        if ((i & 63) == 63)
+            std::this_thread::yield();
+    }
+}
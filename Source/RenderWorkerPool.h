@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// A small pool of render threads driven from the audio callback. run() hands out job
+// indices to the workers and the calling thread, then spins until every job is done; it
+// never takes a lock, and simply runs everything on the caller while the pool is being
+// reconfigured.
+class RenderWorkerPool
+{
+public:
+    enum class WaitPolicy
+    {
+        spin = 1,           // workers busy-wait between blocks: lowest latency, burns cores
+        spinThenSleep = 2,  // spin briefly after each block, then sleep until woken
+        sleep = 3           // sleep until woken by the audio thread
+    };
+
+    struct Job
+    {
+        virtual ~Job() = default;
+        virtual void runJob(int index) = 0;
+    };
+
+    RenderWorkerPool();
+    ~RenderWorkerPool();
+
+    void setNumThreads(int numThreads);
+    int getNumThreads() const { return numWorkers.load(); }
+
+    void setWaitPolicy(WaitPolicy policy) { waitPolicy.store(policy); }
+    WaitPolicy getWaitPolicy() const { return waitPolicy.load(); }
+
+    void run(Job& job, int numJobs);
+
+private:
+    class Worker;
+
+    bool runNextJob(uint32 generation);
+    void stopWorkers();
+
+    juce::SpinLock configLock;
+    juce::OwnedArray<Worker> workers;
+    std::atomic<int> numWorkers {0};
+    std::atomic<WaitPolicy> waitPolicy {WaitPolicy::spinThenSleep};
+
+    // The high 32 bits are the generation of the current run() call, the next 16 the number
+    // of jobs in it and the low 16 the next job index to hand out. Claiming a job is a
+    // compare-and-swap on the whole word, so a worker that wakes late can never take a job
+    // from a newer run, nor check an old index against a newer run's job count.
+    std::atomic<uint64> jobClaim {0};
+    std::atomic<Job*> currentJob {nullptr};
+    std::atomic<int> jobsDone {0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorkerPool)
+};
@@ -1,6 +1,653 @@
 #include "Sample.h"
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
-bool Sample::loadFromFile(const juce::File& file)
+namespace
+{
+constexpr int sincTaps = 32;
+constexpr int sincHalfTaps = sincTaps / 2;
+constexpr int sincPhases = 128;
+constexpr int sincRateBands = 9;           // playback rates 1, 1.125, ... 2 and above
+constexpr double sincBandsPerUnitRate = 8.0;
+constexpr double sincCutoff = 0.85;        // fraction of the source Nyquist kept at 1x
+constexpr double kaiserBeta = 8.0;
+
+constexpr int64 maxInMemoryBytes = (int64)512 * 1024 * 1024;
+constexpr int streamingBufferSamples = 1 << 17; // per read-ahead cursor
+constexpr int streamingCursors = 4;
+constexpr int maxWindowSamples = 1 << 14;      // source span fetched per non-resident read
+constexpr int windowMargin = sincHalfTaps + 2; // widest interpolator reach beyond a position
+constexpr int maxReadChannels = 64;
+constexpr int conversionBlockSamples = 1 << 16;
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1.0e-12)
+            break;
+    }
+    return sum;
+}
+
+// Kaiser-windowed sinc kernels, one polyphase table per playback-rate band. Faster rates
+// use a lower cutoff so that material above the new Nyquist is filtered instead of
+// aliased. Each table has sincPhases + 1 rows of taps plus the difference to the next row,
+// so a fractional phase costs one multiply-add per tap. Built once and never modified.
+struct SincTables
+{
+    SincTables()
+        : coefficients((size_t)(sincRateBands * (sincPhases + 1) * sincTaps)),
+          deltas(coefficients.size())
+    {
+        const double windowNorm = besselI0(kaiserBeta);
+        for (int band = 0; band < sincRateBands; ++band)
+        {
+            const double cutoff = sincCutoff / (1.0 + band / sincBandsPerUnitRate);
+            for (int phase = 0; phase <= sincPhases; ++phase)
+            {
+                float* row = getRow(band, phase);
+                const double frac = (double)phase / (double)sincPhases;
+                double sum = 0.0;
+                for (int k = 0; k < sincTaps; ++k)
+                {
+                    // Tap k reads source sample floor(pos) - (sincHalfTaps - 1) + k.
+                    const double x = (double)(k - (sincHalfTaps - 1)) - frac;
+                    const double ratio = x / (double)sincHalfTaps;
+                    const double window = std::abs(ratio) >= 1.0
+                                              ? 0.0
+                                              : besselI0(kaiserBeta * std::sqrt(1.0 - ratio * ratio)) / windowNorm;
+                    const double arg = juce::MathConstants<double>::pi * cutoff * x;
+                    const double sinc = std::abs(arg) < 1.0e-9 ? 1.0 : std::sin(arg) / arg;
+                    row[k] = (float)(cutoff * sinc * window);
+                    sum += row[k];
+                }
+
+                // Unity gain at DC for every phase.
+                for (int k = 0; k < sincTaps; ++k)
+                    row[k] = (float)(row[k] / sum);
+            }
+
+            for (int phase = 0; phase < sincPhases; ++phase)
+            {
+                const float* row = getRow(band, phase);
+                const float* next = getRow(band, phase + 1);
+                float* delta = deltas.data() + (row - coefficients.data());
+                for (int k = 0; k < sincTaps; ++k)
+                    delta[k] = next[k] - row[k];
+            }
+        }
+    }
+
+    float* getRow(int band, int phase)
+    {
+        return coefficients.data() + ((size_t)band * (sincPhases + 1) + (size_t)phase) * sincTaps;
+    }
+
+    const float* getRow(int band, int phase) const
+    {
+        return coefficients.data() + ((size_t)band * (sincPhases + 1) + (size_t)phase) * sincTaps;
+    }
+
+    const float* getDelta(int band, int phase) const
+    {
+        return deltas.data() + ((size_t)band * (sincPhases + 1) + (size_t)phase) * sincTaps;
+    }
+
+    std::vector<float> coefficients;
+    std::vector<float> deltas;
+};
+
+const SincTables& getSincTables()
+{
+    static const SincTables tables;
+    return tables;
+}
+
+// Read-only views of one channel of decoded audio, indexed by frame. The interpolators are
+// templated on these so packed and interleaved storage is converted as it is read.
+struct FloatFrames
+{
+    const float* data;
+    float operator[](int index) const { return data[index]; }
+};
+
+struct Int16Frames
+{
+    const int16* data;
+    int stride; // samples between frames
+
+    float operator[](int index) const { return (float)data[(size_t)index * (size_t)stride] * (1.0f / 32768.0f); }
+};
+
+struct Int24Frames
+{
+    const uint8* data;
+    int stride; // bytes between frames
+
+    float operator[](int index) const
+    {
+        const uint8* p = data + (size_t)index * (size_t)stride;
+        const auto value = (int32)(((uint32)p[0] << 8) | ((uint32)p[1] << 16) | ((uint32)p[2] << 24)) >> 8;
+        return (float)value * (1.0f / 8388608.0f);
+    }
+};
+
+// How one channel of resident audio is laid out.
+struct ResidentChannel
+{
+    const void* data = nullptr;
+    Sample::Encoding encoding = Sample::Encoding::float32;
+    int stride = 1; // samples between frames
+};
+
+// Calls fn with the accessor matching the channel's layout; false when it is not resident.
+template <typename Function>
+bool withResidentFrames(const ResidentChannel& channel, Function&& fn)
+{
+    if (channel.data == nullptr)
+        return false;
+
+    switch (channel.encoding)
+    {
+        case Sample::Encoding::int16:
+            fn(Int16Frames{ static_cast<const int16*>(channel.data), channel.stride });
+            break;
+        case Sample::Encoding::int24:
+            fn(Int24Frames{ static_cast<const uint8*>(channel.data), channel.stride * 3 });
+            break;
+        case Sample::Encoding::float32:
+        case Sample::Encoding::automatic:
+        default:
+            fn(FloatFrames{ static_cast<const float*>(channel.data) });
+            break;
+    }
+    return true;
+}
+
+template <typename Frames>
+void interpolateLinear(const Frames& src, int numSamples, const double* positions, float* dest, int numPositions)
+{
+    // Clamp into [0, last] and interpolate from the left neighbour so the loop has no
+    // data-dependent branches.
+    const double lastPos = (double)(numSamples - 1);
+    const int lastLeftIndex = numSamples - 2;
+    for (int i = 0; i < numPositions; ++i)
+    {
+        const double pos = juce::jlimit(0.0, lastPos, positions[i]);
+        const int index = juce::jmin((int)pos, lastLeftIndex);
+        const float frac = (float)(pos - (double)index);
+        const float s0 = src[index];
+        const float s1 = src[index + 1];
+        dest[i] = s0 + (s1 - s0) * frac;
+    }
+}
+
+template <typename Frames>
+void interpolateCubic(const Frames& src, int numSamples, const double* positions, float* dest, int numPositions)
+{
+    const double lastPos = (double)(numSamples - 1);
+    const int last = numSamples - 1;
+    for (int i = 0; i < numPositions; ++i)
+    {
+        const double pos = juce::jlimit(0.0, lastPos, positions[i]);
+        const int index = (int)pos;
+        const float frac = (float)(pos - (double)index);
+
+        float xm1, x0, x1, x2;
+        if (index >= 1 && index + 2 <= last)
+        {
+            xm1 = src[index - 1];
+            x0 = src[index];
+            x1 = src[index + 1];
+            x2 = src[index + 2];
+        }
+        else
+        {
+            xm1 = src[juce::jmax(0, index - 1)];
+            x0 = src[index];
+            x1 = src[juce::jmin(last, index + 1)];
+            x2 = src[juce::jmin(last, index + 2)];
+        }
+
+        // Catmull-Rom Hermite spline through the four neighbours.
+        const float c1 = 0.5f * (x1 - xm1);
+        const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        dest[i] = ((c3 * frac + c2) * frac + c1) * frac + x0;
+    }
+}
+
+// ratePositions are the caller's untranslated positions, with numRatePositions readable from
+// there, and rate carries the estimate across calls, so splitting a block into several
+// calls picks the same kernels as one call would.
+template <typename Frames>
+void interpolateSinc(const Frames& src,
+                     int numSamples,
+                     const double* positions,
+                     float* dest,
+                     int numPositions,
+                     const double* ratePositions,
+                     int numRatePositions,
+                     double& rate)
+{
+    const auto& tables = getSincTables();
+    const double lastPos = (double)(numSamples - 1);
+    const int firstFastIndex = sincHalfTaps - 1;
+    const int lastFastIndex = numSamples - 1 - sincHalfTaps;
+    float edge[sincTaps];
+
+    for (int i = 0; i < numPositions; ++i)
+    {
+        // The local playback rate picks the kernel. Jumps between slices are not a rate,
+        // so they keep the previous one.
+        if (i + 1 < numRatePositions)
+        {
+            const double step = std::abs(ratePositions[i + 1] - ratePositions[i]);
+            if (step <= 4.0)
+                rate = step;
+        }
+        const int band = juce::jlimit(0, sincRateBands - 1, (int)std::ceil((rate - 1.0) * sincBandsPerUnitRate));
+
+        const double pos = juce::jlimit(0.0, lastPos, positions[i]);
+        const int index = (int)pos;
+        const double phasePos = (pos - (double)index) * (double)sincPhases;
+        const int phase = juce::jmin((int)phasePos, sincPhases - 1);
+        const float phaseFrac = (float)(phasePos - (double)phase);
+
+        // Float data is read in place; other layouts are converted into the local taps.
+        const float* taps = edge;
+        if (index < firstFastIndex || index > lastFastIndex)
+        {
+            for (int k = 0; k < sincTaps; ++k)
+                edge[k] = src[juce::jlimit(0, numSamples - 1, index - firstFastIndex + k)];
+        }
+        else if constexpr (std::is_same<Frames, FloatFrames>::value)
+        {
+            taps = src.data + index - firstFastIndex;
+        }
+        else
+        {
+            for (int k = 0; k < sincTaps; ++k)
+                edge[k] = src[index - firstFastIndex + k];
+        }
+
+        // Four independent accumulators so the compiler can keep the taps in vector lanes.
+        const float* row = tables.getRow(band, phase);
+        const float* delta = tables.getDelta(band, phase);
+        float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < sincTaps; k += 4)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+                acc[lane] += taps[k + lane] * (row[k + lane] + phaseFrac * delta[k + lane]);
+        }
+        dest[i] = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+}
+
+template <typename Frames>
+void interpolate(Sample::Interpolation interpolation,
+                 const Frames& src,
+                 int numSamples,
+                 const double* positions,
+                 float* dest,
+                 int numPositions,
+                 const double* ratePositions,
+                 int numRatePositions,
+                 double& rate)
+{
+    switch (interpolation)
+    {
+        case Sample::Interpolation::cubic:
+            interpolateCubic(src, numSamples, positions, dest, numPositions);
+            break;
+        case Sample::Interpolation::sinc:
+            interpolateSinc(src, numSamples, positions, dest, numPositions, ratePositions, numRatePositions, rate);
+            break;
+        case Sample::Interpolation::linear:
+        default:
+            interpolateLinear(src, numSamples, positions, dest, numPositions);
+            break;
+    }
+}
+
+// Streaming samples share one read-ahead thread.
+struct SampleStreamingThread : public juce::TimeSliceThread
+{
+    SampleStreamingThread() : juce::TimeSliceThread("Sample streaming") { startThread(juce::Thread::Priority::high); }
+    ~SampleStreamingThread() override { stopThread(2000); }
+};
+}
+class Sample::Source
+{
+public:
+    virtual ~Source() = default;
+
+    // The whole channel when it is held in memory, otherwise empty.
+    virtual ResidentChannel getResidentChannel(int) const { return {}; }
+
+    // Reads [startSample, startSample + numToRead), which is inside the file.
+    virtual void read(int channel, int64 startSample, int numToRead, float* dest, bool blocking) const = 0;
+
+    virtual int64 getMemoryUsageBytes() const = 0;
+};
+
+class Sample::InMemorySource : public Sample::Source
+{
+public:
+    explicit InMemorySource(juce::AudioFormatReader& reader)
+        : data((int)reader.numChannels, (int)reader.lengthInSamples)
+    {
+        reader.read(&data, 0, (int)reader.lengthInSamples, 0, true, true);
+    }
+
+    InMemorySource(int numChannels, int numSamples)
+        : data(numChannels, numSamples)
+    {
+    }
+
+    void write(const float* src, int channel, int64 startSample, int count)
+    {
+        data.copyFrom(channel, (int)startSample, src, count);
+    }
+
+    ResidentChannel getResidentChannel(int channel) const override
+    {
+        return { data.getReadPointer(channel), Encoding::float32, 1 };
+    }
+
+    void read(int channel, int64 startSample, int numToRead, float* dest, bool) const override
+    {
+        juce::FloatVectorOperations::copy(dest, data.getReadPointer(channel, (int)startSample), numToRead);
+    }
+
+    int64 getMemoryUsageBytes() const override
+    {
+        return (int64)data.getNumChannels() * data.getNumSamples() * (int64)sizeof(float);
+    }
+
+private:
+    juce::AudioBuffer<float> data;
+};
+
+// Integer audio kept at the source's bit depth, with the channels of each frame stored
+// together. Half (16-bit) or three quarters (24-bit) of the memory of float storage, and a
+// block reads both channels of a stereo clip from the same cache lines.
+class Sample::PackedSource : public Sample::Source
+{
+public:
+    PackedSource(int numChannelsIn, int64 numSamples, Encoding encodingIn)
+        : encoding(encodingIn),
+          numChannels(numChannelsIn)
+    {
+        const auto numValues = (size_t)numSamples * (size_t)numChannels;
+        if (encoding == Encoding::int16)
+            shorts.resize(numValues);
+        else
+            bytes.resize(numValues * 3);
+    }
+
+    PackedSource(juce::AudioFormatReader& reader, Encoding encodingIn)
+        : PackedSource((int)reader.numChannels, reader.lengthInSamples, encodingIn)
+    {
+        const int64 length = reader.lengthInSamples;
+        juce::AudioBuffer<float> block(numChannels, (int)juce::jmin<int64>(length, conversionBlockSamples));
+        for (int64 start = 0; start < length; start += block.getNumSamples())
+        {
+            const int count = (int)juce::jmin<int64>(block.getNumSamples(), length - start);
+            reader.read(&block, 0, count, start, true, true);
+            for (int ch = 0; ch < numChannels; ++ch)
+                write(block.getReadPointer(ch), ch, start, count);
+        }
+    }
+
+    ResidentChannel getResidentChannel(int channel) const override
+    {
+        if (encoding == Encoding::int16)
+            return { shorts.data() + channel, encoding, numChannels };
+        return { bytes.data() + (size_t)channel * 3, encoding, numChannels };
+    }
+
+    void read(int channel, int64 startSample, int numToRead, float* dest, bool) const override
+    {
+        withResidentFrames(getResidentChannel(channel), [&](const auto& frames)
+        {
+            for (int i = 0; i < numToRead; ++i)
+                dest[i] = frames[(int)startSample + i];
+        });
+    }
+
+    int64 getMemoryUsageBytes() const override
+    {
+        return (int64)(shorts.size() * sizeof(int16) + bytes.size());
+    }
+
+    void write(const float* src, int channel, int64 startSample, int count)
+    {
+        const size_t first = (size_t)startSample * (size_t)numChannels + (size_t)channel;
+        if (encoding == Encoding::int16)
+        {
+            int16* dest = shorts.data() + first;
+            for (int i = 0; i < count; ++i, dest += numChannels)
+                *dest = (int16)juce::jlimit(-32768, 32767, juce::roundToInt(src[i] * 32768.0f));
+            return;
+        }
+
+        uint8* dest = bytes.data() + first * 3;
+        for (int i = 0; i < count; ++i, dest += 3 * numChannels)
+        {
+            const int value = juce::jlimit(-8388608, 8388607, juce::roundToInt(src[i] * 8388608.0f));
+            dest[0] = (uint8)(value & 0xff);
+            dest[1] = (uint8)((value >> 8) & 0xff);
+            dest[2] = (uint8)((value >> 16) & 0xff);
+        }
+    }
+
+private:
+    Encoding encoding;
+    int numChannels = 0;
+    std::vector<int16> shorts; // int16 encoding
+    std::vector<uint8> bytes;  // int24 encoding, little-endian
+};
+
+// Reading a mapped reader only touches the mapped memory, so any thread may do it.
+class Sample::MemoryMappedSource : public Sample::Source
+{
+public:
+    explicit MemoryMappedSource(std::unique_ptr<juce::MemoryMappedAudioFormatReader> readerIn)
+        : reader(std::move(readerIn))
+    {
+    }
+
+    void read(int channel, int64 startSample, int numToRead, float* dest, bool) const override
+    {
+        readChannel(*reader, channel, startSample, numToRead, dest);
+    }
+
+    int64 getMemoryUsageBytes() const override { return 0; }
+
+    static void readChannel(juce::AudioFormatReader& reader, int channel, int64 startSample, int numToRead, float* dest)
+    {
+        float* channels[maxReadChannels] = {};
+        channel = juce::jmin(channel, maxReadChannels - 1);
+        channels[channel] = dest;
+        // Readers leave silence for anything they could not read.
+        reader.read(channels, channel + 1, startSample, numToRead);
+    }
+
+private:
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+};
+
+// Real-time reads come from read-ahead buffers and return silence for anything that has
+// not arrived yet. Blocking reads (offline rendering, drawing) go to a separate reader.
+//
+// One Sample is shared by every clip of a file, and clips may play it at different
+// positions at once, so there are several read-ahead cursors, each with its own reader. A
+// read continues on the cursor whose last read ended nearest to it, or takes over the one
+// used least recently; up to streamingCursors positions stream without disturbing each
+// other. Each cursor reads every channel of a window at once and keeps it, so the reads
+// for the other channels of the same window are copies. A real-time read never waits: a
+// cursor another thread is reading from is passed over, and when all of them are busy the
+// read returns silence.
+class Sample::StreamingSource : public Sample::Source
+{
+public:
+    StreamingSource(std::vector<std::unique_ptr<juce::AudioFormatReader>> bufferedReaders,
+                    std::unique_ptr<juce::AudioFormatReader> directReaderIn)
+        : directReader(std::move(directReaderIn)),
+          numChannels((int)juce::jmin((unsigned int)maxReadChannels, directReader->numChannels))
+    {
+        for (auto& reader : bufferedReaders)
+        {
+            auto cursor = std::make_unique<Cursor>();
+            cursor->readAhead = std::make_unique<juce::BufferingAudioReader>(reader.release(), *streamingThread, streamingBufferSamples);
+            cursor->readAhead->setReadTimeout(0);
+            cursor->window.setSize(numChannels, maxWindowSamples + 2 * windowMargin + 1);
+            bufferBytes += (int64)(streamingBufferSamples + cursor->window.getNumSamples()) * numChannels * (int64)sizeof(float);
+            cursors.push_back(std::move(cursor));
+        }
+    }
+
+    void read(int channel, int64 startSample, int numToRead, float* dest, bool blocking) const override
+    {
+        if (blocking || cursors.empty())
+        {
+            const juce::ScopedLock sl(directLock);
+            MemoryMappedSource::readChannel(*directReader, channel, startSample, numToRead, dest);
+            return;
+        }
+
+        channel = juce::jmin(channel, numChannels - 1);
+        auto* cursor = lockCursor(startSample);
+        if (cursor == nullptr)
+        {
+            juce::FloatVectorOperations::clear(dest, numToRead);
+            return;
+        }
+
+        cursor->lastUsed = ++useCounter;
+        readFromCursor(*cursor, channel, startSample, numToRead, dest);
+        cursor->lock.exit();
+    }
+
+    int64 getMemoryUsageBytes() const override { return bufferBytes; }
+
+private:
+    struct Cursor
+    {
+        std::unique_ptr<juce::BufferingAudioReader> readAhead;
+        juce::CriticalSection lock;
+        juce::AudioBuffer<float> window;  // every channel of the last complete window
+        int64 windowStart = -1;
+        int windowLength = 0;
+        std::atomic<int64> nextRead {-1};  // where the last read ended
+        std::atomic<uint32> lastUsed {0};
+    };
+
+    // Locks and returns the best cursor for a read at startSample that nobody else is
+    // reading from, or nullptr when every cursor is busy. Cursors whose last read ended
+    // within reach of the read-ahead come first, nearest first, then the others from least
+    // recently used. Two clips playing the same stretch of a file therefore end up on two
+    // neighbouring cursors instead of waiting for each other.
+    Cursor* lockCursor(int64 startSample) const
+    {
+        std::array<Cursor*, streamingCursors> order {};
+        std::array<int64, streamingCursors> distances {};
+        const int numCursors = (int)juce::jmin(cursors.size(), order.size());
+        for (int i = 0; i < numCursors; ++i)
+        {
+            auto* cursor = cursors[(size_t)i].get();
+            const int64 nextRead = cursor->nextRead.load();
+            const int64 distance = nextRead >= 0 ? std::abs(startSample - nextRead) : -1;
+            // Farther than the read-ahead reaches is a new position rather than a continuation.
+            const bool continues = distance >= 0 && distance <= streamingBufferSamples / 2;
+            const int64 rank = continues ? distance : (int64)streamingBufferSamples + (int64)cursor->lastUsed.load();
+
+            int j = i;
+            for (; j > 0 && distances[(size_t)(j - 1)] > rank; --j)
+            {
+                order[(size_t)j] = order[(size_t)(j - 1)];
+                distances[(size_t)j] = distances[(size_t)(j - 1)];
+            }
+            order[(size_t)j] = cursor;
+            distances[(size_t)j] = rank;
+        }
+
+        for (int i = 0; i < numCursors; ++i)
+            if (order[(size_t)i]->lock.tryEnter())
+                return order[(size_t)i];
+        return nullptr;
+    }
+
+    // Called with the cursor's lock held.
+    void readFromCursor(Cursor& cursor, int channel, int64 startSample, int numToRead, float* dest) const
+    {
+        if (numToRead > cursor.window.getNumSamples())
+        {
+            MemoryMappedSource::readChannel(*cursor.readAhead, channel, startSample, numToRead, dest);
+            cursor.nextRead = startSample + numToRead;
+            return;
+        }
+
+        const bool cached = startSample >= cursor.windowStart
+                            && startSample + numToRead <= cursor.windowStart + cursor.windowLength;
+        if (!cached)
+        {
+            // Anything not read ahead yet comes back as silence and is not kept, so the
+            // next read asks again once the background thread has caught up.
+            const bool complete = cursor.readAhead->read(cursor.window.getArrayOfWritePointers(), numChannels, startSample, numToRead);
+            cursor.windowStart = complete ? startSample : -1;
+            cursor.windowLength = complete ? numToRead : 0;
+            cursor.nextRead = startSample + numToRead;
+            if (!complete)
+            {
+                juce::FloatVectorOperations::copy(dest, cursor.window.getReadPointer(channel), numToRead);
+                return;
+            }
+        }
+
+        juce::FloatVectorOperations::copy(dest, cursor.window.getReadPointer(channel, (int)(startSample - cursor.windowStart)), numToRead);
+    }
+
+    juce::SharedResourcePointer<SampleStreamingThread> streamingThread;
+    std::vector<std::unique_ptr<Cursor>> cursors;
+    mutable std::atomic<uint32> useCounter {0};
+    juce::CriticalSection directLock;
+    std::unique_ptr<juce::AudioFormatReader> directReader;
+    const int numChannels;
+    int64 bufferBytes = 0;
+};
+
+void Sample::ReadContext::prepare(int maximumPositions)
+{
+    const size_t windowSize = (size_t)(maxWindowSamples + 2 * windowMargin + 1);
+    if (window.size() < windowSize)
+        window.resize(windowSize);
+    if (positions.size() < (size_t)maximumPositions)
+        positions.resize((size_t)maximumPositions);
+}
+
+Sample::Sample()
+{
+}
+
+Sample::~Sample()
+{
+}
+
+bool Sample::loadFromFile(const juce::File& file,
+                          Storage requestedStorage,
+                          Encoding requestedEncoding,
+                          std::shared_ptr<const SamplePeaks> knownPeaks)
 {
     juce::AudioFormatManager formatManager;
     formatManager.registerBasicFormats();
@@ -11,28 +658,364 @@ bool Sample::loadFromFile(const juce::File& file)
     if (reader->numChannels <= 0 || reader->lengthInSamples <= 0)
         return false;
 
-    sampleRate = reader->sampleRate;
-    data.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
-    reader->read(&data, 0, (int)reader->lengthInSamples, 0, true, true);
+    const int readerChannels = (int)reader->numChannels;
+    const int64 readerLength = reader->lengthInSamples;
+    const double readerSampleRate = reader->sampleRate;
+
+    // Integer sources keep their bit depth in memory; anything else is stored as float.
+    Encoding chosenEncoding = requestedEncoding;
+    if (chosenEncoding == Encoding::automatic)
+    {
+        if (reader->usesFloatingPointData || reader->bitsPerSample > 24)
+            chosenEncoding = Encoding::float32;
+        else
+            chosenEncoding = reader->bitsPerSample <= 16 ? Encoding::int16 : Encoding::int24;
+    }
+    const int64 bytesPerSample = chosenEncoding == Encoding::int16 ? 2 : (chosenEncoding == Encoding::int24 ? 3 : (int64)sizeof(float));
+    const int64 decodedBytes = reader->lengthInSamples * (int64)reader->numChannels * bytesPerSample;
+    const bool fitsInMemory = reader->lengthInSamples <= std::numeric_limits<int>::max();
+
+    Storage chosen = requestedStorage;
+    if (chosen == Storage::automatic)
+        chosen = fitsInMemory && decodedBytes <= maxInMemoryBytes ? Storage::inMemory : Storage::memoryMapped;
+    if (chosen == Storage::inMemory && !fitsInMemory)
+        chosen = Storage::memoryMapped;
+
+    std::unique_ptr<Source> newSource;
+    if (chosen == Storage::inMemory)
+    {
+        if (chosenEncoding == Encoding::float32)
+            newSource = std::make_unique<InMemorySource>(*reader);
+        else
+            newSource = std::make_unique<PackedSource>(*reader, chosenEncoding);
+    }
+    else if (chosen == Storage::memoryMapped)
+    {
+        // Only uncompressed formats can be mapped; everything else falls back to streaming.
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped;
+        if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+            mapped.reset(format->createMemoryMappedReader(file));
+
+        if (mapped != nullptr && mapped->mapEntireFile() && mapped->getMappedSection().getLength() >= reader->lengthInSamples)
+            newSource = std::make_unique<MemoryMappedSource>(std::move(mapped));
+        else
+            chosen = Storage::streaming;
+    }
+
+    if (chosen == Storage::streaming)
+    {
+        std::unique_ptr<juce::AudioFormatReader> directReader(formatManager.createReaderFor(file));
+        if (directReader == nullptr)
+            return false;
+
+        std::vector<std::unique_ptr<juce::AudioFormatReader>> bufferedReaders;
+        bufferedReaders.push_back(std::move(reader));
+        for (int i = 1; i < streamingCursors; ++i)
+            if (auto* cursorReader = formatManager.createReaderFor(file))
+                bufferedReaders.emplace_back(cursorReader);
+        newSource = std::make_unique<StreamingSource>(std::move(bufferedReaders), std::move(directReader));
+    }
+
+    source = std::move(newSource);
+    storage = chosen;
+    encoding = chosen == Storage::inMemory ? chosenEncoding : Encoding::float32;
+    numChannels = readerChannels;
+    numSamples = readerLength;
+    sampleRate = readerSampleRate;
+    if (knownPeaks != nullptr && knownPeaks->getNumChannels() == numChannels && knownPeaks->getNumSamples() == numSamples)
+        peaks = std::move(knownPeaks);
+    else
+        buildPeaks();
+    zeroCrossings.reset();
+    if (storage == Storage::inMemory)
+        buildZeroCrossings();
     return true;
 }
 
+bool Sample::loadResampled(const Sample& original, double newSampleRate)
+{
+    if (original.source == nullptr || original.storage != Storage::inMemory || newSampleRate <= 0.0)
+        return false;
+
+    const double step = original.sampleRate / newSampleRate;
+    const int64 newLength = juce::jmax<int64>(1, (int64)std::ceil((double)original.numSamples / step));
+    if (newLength > std::numeric_limits<int>::max())
+        return false;
+
+    // The sinc interpolator low-passes by the playback rate, so downsampling is band-limited.
+    auto convert = [&](auto& target)
+    {
+        std::vector<double> positions((size_t)conversionBlockSamples);
+        std::vector<float> converted((size_t)conversionBlockSamples);
+        for (int64 start = 0; start < newLength; start += conversionBlockSamples)
+        {
+            const int count = (int)juce::jmin<int64>(conversionBlockSamples, newLength - start);
+            for (int i = 0; i < count; ++i)
+                positions[(size_t)i] = (double)(start + i) * step;
+
+            for (int ch = 0; ch < original.numChannels; ++ch)
+            {
+                original.getSamples(ch, positions.data(), converted.data(), count, Interpolation::sinc);
+                target.write(converted.data(), ch, start, count);
+            }
+        }
+    };
+
+    if (original.encoding == Encoding::float32)
+    {
+        auto target = std::make_unique<InMemorySource>(original.numChannels, (int)newLength);
+        convert(*target);
+        source = std::move(target);
+    }
+    else
+    {
+        auto target = std::make_unique<PackedSource>(original.numChannels, newLength, original.encoding);
+        convert(*target);
+        source = std::move(target);
+    }
+
+    storage = Storage::inMemory;
+    encoding = original.encoding;
+    numChannels = original.numChannels;
+    numSamples = newLength;
+    sampleRate = newSampleRate;
+    buildPeaks();
+    zeroCrossings.reset();
+    buildZeroCrossings();
+    return true;
+}
+
+void Sample::buildPeaks()
+{
+    peaks = SamplePeaks::build(numChannels, numSamples, [this](int channel, int64 startSample, int count, float* dest)
+    {
+        source->read(channel, startSample, count, dest, true);
+    });
+}
+
+void Sample::buildZeroCrossings() const
+{
+    auto index = ZeroCrossingIndex::build(numChannels, numSamples, [this](int channel, int64 startSample, int count, float* dest)
+    {
+        source->read(channel, startSample, count, dest, true);
+    });
+
+    const juce::ScopedLock lock(zeroCrossingLock);
+    zeroCrossings = std::move(index);
+}
+
+std::shared_ptr<const ZeroCrossingIndex> Sample::getZeroCrossings() const
+{
+    {
+        const juce::ScopedLock lock(zeroCrossingLock);
+        if (zeroCrossings != nullptr || source == nullptr)
+            return zeroCrossings;
+    }
+
+    // Two threads may both build it the first time; the result is the same either way.
+    buildZeroCrossings();
+    const juce::ScopedLock lock(zeroCrossingLock);
+    return zeroCrossings;
+}
+
+int64 Sample::snapToZeroCrossing(int64 position, int64 maxDistance) const
+{
+    std::shared_ptr<const ZeroCrossingIndex> index;
+    {
+        const juce::ScopedLock lock(zeroCrossingLock);
+        index = zeroCrossings;
+    }
+    if (index != nullptr)
+        return index->snap(position, maxDistance);
+    if (source == nullptr)
+        return position;
+
+    // Not indexed yet: look only at the frames the cut may move to, rather than build the
+    // index here with a read of the whole file.
+    return ZeroCrossingIndex::scan(numChannels, numSamples, [this](int channel, int64 startSample, int count, float* dest)
+    {
+        source->read(channel, startSample, count, dest, true);
+    }, position, maxDistance);
+}
+
+int64 Sample::getMemoryUsageBytes() const
+{
+    int64 bytes = source != nullptr ? source->getMemoryUsageBytes() : 0;
+    if (peaks != nullptr)
+        bytes += peaks->getMemoryUsageBytes();
+    const juce::ScopedLock lock(zeroCrossingLock);
+    if (zeroCrossings != nullptr)
+        bytes += zeroCrossings->getMemoryUsageBytes();
+    return bytes;
+}
+
+void Sample::readClamped(int channel, int64 startSample, int numToRead, float* dest, bool blocking) const
+{
+    // Frames outside the file repeat the edge frame, matching how the interpolators clamp.
+    const int64 validStart = juce::jlimit<int64>(0, numSamples - 1, startSample);
+    const int64 validEnd = juce::jlimit<int64>(validStart + 1, numSamples, startSample + numToRead);
+    const int before = (int)juce::jlimit<int64>(0, numToRead, validStart - startSample);
+    const int valid = (int)juce::jmin<int64>(validEnd - validStart, numToRead - before);
+
+    float* validDest = dest + before;
+    float edge = 0.0f;
+    if (valid > 0)
+    {
+        source->read(channel, validStart, valid, validDest, blocking);
+    }
+    else
+    {
+        source->read(channel, validStart, 1, &edge, blocking);
+        juce::FloatVectorOperations::fill(dest, edge, numToRead);
+        return;
+    }
+
+    if (before > 0)
+        juce::FloatVectorOperations::fill(dest, validDest[0], before);
+    const int after = numToRead - before - valid;
+    if (after > 0)
+        juce::FloatVectorOperations::fill(validDest + valid, validDest[valid - 1], after);
+}
+
+std::shared_ptr<const OnsetAnalysis> Sample::getOnsetAnalysis() const
+{
+    const juce::SpinLock::ScopedLockType lock(analysisLock);
+    return onsetAnalysis;
+}
+
+void Sample::setOnsetAnalysis(std::shared_ptr<const OnsetAnalysis> analysis) const
+{
+    const juce::SpinLock::ScopedLockType lock(analysisLock);
+    onsetAnalysis = std::move(analysis);
+}
+
+void Sample::readFrames(int channel, int64 startSample, int numToRead, float* dest) const
+{
+    if (numToRead <= 0)
+        return;
+    if (numSamples == 0 || numChannels == 0)
+    {
+        juce::FloatVectorOperations::clear(dest, numToRead);
+        return;
+    }
+    readClamped(juce::jlimit(0, numChannels - 1, channel), startSample, numToRead, dest, true);
+}
+
+SamplePeaks::Peak Sample::getPeak(int channel, double startSample, double endSample) const
+{
+    if (numSamples == 0 || numChannels == 0)
+        return {};
+
+    channel = juce::jlimit(0, numChannels - 1, channel);
+    const int64 first = juce::jlimit<int64>(0, numSamples - 1, (int64)std::floor(juce::jmin(startSample, endSample)));
+    const int64 end = juce::jlimit<int64>(first + 1, numSamples, (int64)std::ceil(juce::jmax(startSample, endSample)));
+    const int span = (int)juce::jmin<int64>(end - first, 4 * SamplePeaks::baseBlockSize);
+
+    if (peaks != nullptr && end - first > span)
+        return peaks->getPeak(channel, first, end);
+
+    float frames[4 * SamplePeaks::baseBlockSize];
+    readClamped(channel, first, span, frames, true);
+    const auto range = juce::FloatVectorOperations::findMinAndMax(frames, span);
+    float sumSquares = 0.0f;
+    for (int i = 0; i < span; ++i)
+        sumSquares += frames[i] * frames[i];
+    return { range.getStart(), range.getEnd(), sumSquares / (float)span };
+}
+
 float Sample::getSampleAt(int channel, double samplePos) const
 {
-    if (data.getNumSamples() == 0 || data.getNumChannels() == 0)
+    if (numSamples == 0 || numChannels == 0)
         return 0.0f;
 
-    channel = juce::jlimit(0, data.getNumChannels() - 1, channel);
+    channel = juce::jlimit(0, numChannels - 1, channel);
 
-    const int numSamples = data.getNumSamples();
     if (samplePos <= 0.0)
-        return data.getSample(channel, 0);
+        samplePos = 0.0;
     if (samplePos >= (double)(numSamples - 1))
-        return data.getSample(channel, numSamples - 1);
+        samplePos = (double)(numSamples - 1);
 
-    const int index = (int)samplePos;
+    const int64 index = (int64)samplePos;
     const float frac = (float)(samplePos - (double)index);
-    const float s0 = data.getSample(channel, index);
-    const float s1 = data.getSample(channel, index + 1);
-    return s0 + (s1 - s0) * frac;
+    float frames[2];
+    const bool resident = withResidentFrames(source->getResidentChannel(channel), [&](const auto& src)
+    {
+        frames[0] = src[(int)index];
+        frames[1] = src[(int)juce::jmin(index + 1, numSamples - 1)];
+    });
+    if (!resident)
+        readClamped(channel, index, 2, frames, true);
+    return frames[0] + (frames[1] - frames[0]) * frac;
+}
+
+void Sample::getSamples(int channel,
+                        const double* samplePositions,
+                        float* dest,
+                        int numPositions,
+                        Interpolation interpolation,
+                        ReadContext* context) const
+{
+    if (numPositions <= 0)
+        return;
+
+    if (numSamples == 0 || numChannels == 0)
+    {
+        juce::FloatVectorOperations::clear(dest, numPositions);
+        return;
+    }
+
+    channel = juce::jlimit(0, numChannels - 1, channel);
+    if (numSamples == 1)
+    {
+        juce::FloatVectorOperations::fill(dest, getSampleAt(channel, 0.0), numPositions);
+        return;
+    }
+
+    double rate = 1.0;
+    const bool resident = withResidentFrames(source->getResidentChannel(channel), [&](const auto& src)
+    {
+        interpolate(interpolation, src, (int)numSamples, samplePositions, dest, numPositions, samplePositions, numPositions, rate);
+    });
+    if (resident)
+        return;
+
+    // Not resident: fetch the source span under each run of positions into the context's
+    // window, then interpolate from that as if it were the whole file.
+    thread_local ReadContext fallbackContext;
+    auto& ctx = context != nullptr ? *context : fallbackContext;
+    ctx.prepare(numPositions);
+
+    const double lastPos = (double)(numSamples - 1);
+    for (int runStart = 0; runStart < numPositions;)
+    {
+        double lo = juce::jlimit(0.0, lastPos, samplePositions[runStart]);
+        double hi = lo;
+        int runEnd = runStart + 1;
+        for (; runEnd < numPositions; ++runEnd)
+        {
+            const double pos = juce::jlimit(0.0, lastPos, samplePositions[runEnd]);
+            if (juce::jmax(hi, pos) - juce::jmin(lo, pos) >= (double)maxWindowSamples)
+                break;
+            lo = juce::jmin(lo, pos);
+            hi = juce::jmax(hi, pos);
+        }
+
+        const int64 windowStart = (int64)lo - windowMargin;
+        const int windowLength = (int)((int64)hi - (int64)lo) + 2 * windowMargin + 1;
+        readClamped(channel, windowStart, windowLength, ctx.window.data(), ctx.blocking);
+
+        for (int i = runStart; i < runEnd; ++i)
+            ctx.positions[(size_t)(i - runStart)] = juce::jlimit(0.0, lastPos, samplePositions[i]) - (double)windowStart;
+
+        interpolate(interpolation,
+                    FloatFrames{ ctx.window.data() },
+                    windowLength,
+                    ctx.positions.data(),
+                    dest + runStart,
+                    runEnd - runStart,
+                    samplePositions + runStart,
+                    numPositions - runStart,
+                    rate);
+        runStart = runEnd;
+    }
 }
@@ -1,19 +1,130 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "SamplePeaks.h"
+#include "ZeroCrossingIndex.h"
+
+class OnsetAnalysis;
 
 class Sample
 {
 public:
-    bool loadFromFile(const juce::File& file);
+    // Interpolation used by getSamples(). The ids are stable so they can be stored in settings.
+    enum class Interpolation
+    {
+        linear = 1,  // two-point linear
+        cubic = 2,   // four-point Hermite
+        sinc = 3     // 32-tap windowed sinc, low-passed when playing faster than 1x
+    };
+
+    // Where the audio lives. Automatic decodes files of moderate size into memory, maps
+    // larger uncompressed WAV/AIFF files, and streams anything else.
+    enum class Storage
+    {
+        automatic,
+        inMemory,      // decoded to float
+        memoryMapped,  // pages of the file are loaded on demand by the OS
+        streaming      // read ahead on a background thread
+    };
+
+    // Sample format of audio held in memory. Automatic keeps integer sources at their own
+    // bit depth (16 or 24) and stores float sources as float. The ids are stored in projects.
+    enum class Encoding
+    {
+        automatic = 0,
+        float32 = 1,  // planar 32-bit float
+        int16 = 2,    // interleaved 16-bit integer
+        int24 = 3     // interleaved packed 24-bit integer
+    };
+
+    // Working memory for reading a sample that is not held in memory. Each rendering
+    // thread keeps its own, so many threads can read one Sample at once.
+    struct ReadContext
+    {
+        std::vector<float> window;
+        std::vector<double> positions;
+        bool blocking = false;  // wait for streamed audio instead of reading silence
+
+        void prepare(int maximumPositions);
+    };
+
+    Sample();
+    ~Sample();
+
+    // knownPeaks, when given and matching the file, are used instead of scanning the audio.
+    bool loadFromFile(const juce::File& file,
+                      Storage storage = Storage::automatic,
+                      Encoding encoding = Encoding::automatic,
+                      std::shared_ptr<const SamplePeaks> knownPeaks = nullptr);
+    Storage getStorage() const { return storage; }
+    Encoding getEncoding() const { return encoding; }
+
+    // Fills this sample with original converted to newSampleRate, using the same encoding.
+    // Only samples held in memory can be converted.
+    bool loadResampled(const Sample& original, double newSampleRate);
 
-    int getNumChannels() const { return data.getNumChannels(); }
-    int getNumSamples() const { return data.getNumSamples(); }
+    int getNumChannels() const { return numChannels; }
+    int64 getNumSamples() const { return numSamples; }
     double getSampleRate() const { return sampleRate; }
 
+    // Heap memory held for the audio and its peaks; mapped files are paged by the OS and
+    // not counted.
+    int64 getMemoryUsageBytes() const;
+
+    // Lowest, highest and RMS level of a channel over [startSample, endSample). Ranges wider
+    // than a few peak blocks come from the peak summary, so the cost does not grow with
+    // the range; narrower ones read the audio.
+    SamplePeaks::Peak getPeak(int channel, double startSample, double endSample) const;
+    const std::shared_ptr<const SamplePeaks>& getPeaks() const { return peaks; }
+
     float getSampleAt(int channel, double samplePos) const;
+    // Copies frames [startSample, startSample + numToRead) of a channel, repeating the edge
+    // frame outside the sample. Waits for streamed audio, so keep it off the audio thread.
+    void readFrames(int channel, int64 startSample, int numToRead, float* dest) const;
+    void getSamples(int channel,
+                    const double* samplePositions,
+                    float* dest,
+                    int numPositions,
+                    Interpolation interpolation = Interpolation::linear,
+                    ReadContext* context = nullptr) const;
+
+    // Zero crossings of the audio. Built when audio held in memory is loaded; for mapped and
+    // streamed audio on first use, which reads the whole file, so SampleLoader does that
+    // before handing the sample over.
+    std::shared_ptr<const ZeroCrossingIndex> getZeroCrossings() const;
+    // The nearest zero crossing to a frame within maxDistance frames, or the frame itself.
+    // Never builds the index; without one it reads only the frames around position.
+    int64 snapToZeroCrossing(int64 position, int64 maxDistance) const;
+
+    // Onset analysis of the audio, or nullptr until SampleAnalyser has run it. It is a cache
+    // of what the audio already holds, so it can be attached to a const Sample, from any thread.
+    std::shared_ptr<const OnsetAnalysis> getOnsetAnalysis() const;
+    void setOnsetAnalysis(std::shared_ptr<const OnsetAnalysis> analysis) const;
 
 private:
-    juce::AudioBuffer<float> data;
+    class Source;
+    class InMemorySource;
+    class PackedSource;
+    class MemoryMappedSource;
+    class StreamingSource;
+
+    void readClamped(int channel, int64 startSample, int numToRead, float* dest, bool blocking) const;
+    void buildPeaks();
+    void buildZeroCrossings() const;
+
+    std::unique_ptr<Source> source;
+    std::shared_ptr<const SamplePeaks> peaks;
+    mutable juce::CriticalSection zeroCrossingLock;
+    mutable std::shared_ptr<const ZeroCrossingIndex> zeroCrossings;
+    mutable juce::SpinLock analysisLock;
+    mutable std::shared_ptr<const OnsetAnalysis> onsetAnalysis;
+    Storage storage = Storage::inMemory;
+    Encoding encoding = Encoding::float32;
+    int numChannels = 0;
+    int64 numSamples = 0;
     double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Sample)
 };
@@ -0,0 +1,161 @@
+#include "SampleAnalyser.h"
+
+// Each queued request adds one job; a job runs whichever request is most urgent when it
+// starts, not necessarily the one it was added for.
+class SampleAnalyser::AnalysisJob : public juce::ThreadPoolJob
+{
+public:
+    explicit AnalysisJob(SampleAnalyser& ownerIn)
+        : juce::ThreadPoolJob("Sample analysis"),
+          owner(ownerIn)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        owner.runNextRequest();
+        return jobHasFinished;
+    }
+
+private:
+    SampleAnalyser& owner;
+};
+
+SampleAnalyser::SampleAnalyser(int numThreadsIn)
+    : numThreads(juce::jmax(1, numThreadsIn)),
+      pool(juce::ThreadPoolOptions{}
+               .withThreadName("Sample analysis")
+               .withNumberOfThreads(numThreads))
+{
+}
+
+SampleAnalyser::~SampleAnalyser()
+{
+    pool.removeAllJobs(true, -1);
+}
+
+void SampleAnalyser::requestOnsets(const std::shared_ptr<const Sample>& sample, Priority priority, OnsetsReady onReady)
+{
+    if (sample == nullptr)
+        return;
+
+    if (auto onsets = sample->getOnsetAnalysis())
+    {
+        if (onReady)
+            onReady(std::move(onsets));
+        return;
+    }
+
+    const juce::ScopedLock sl(lock);
+    auto found = requests.find(sample.get());
+    if (found != requests.end())
+    {
+        auto& request = found->second;
+        if (priority > request.priority)
+            request.priority = priority;
+        if (onReady)
+            request.callbacks.push_back(std::move(onReady));
+        return;
+    }
+
+    Request request;
+    request.sample = sample;
+    request.priority = priority;
+    request.order = nextOrder++;
+    if (onReady)
+        request.callbacks.push_back(std::move(onReady));
+    requests.emplace(sample.get(), std::move(request));
+    pool.addJob(new AnalysisJob(*this), true);
+}
+
+void SampleAnalyser::cancel(const Sample* sample)
+{
+    const juce::ScopedLock sl(lock);
+    auto found = requests.find(sample);
+    if (found == requests.end())
+        return;
+
+    if (found->second.running)
+        found->second.callbacks.clear();
+    else
+        requests.erase(found);
+}
+
+void SampleAnalyser::cancelAllExcept(const std::set<const Sample*>& samplesInUse)
+{
+    const juce::ScopedLock sl(lock);
+    for (auto it = requests.begin(); it != requests.end();)
+    {
+        if (samplesInUse.count(it->first) != 0)
+        {
+            ++it;
+        }
+        else if (it->second.running)
+        {
+            it->second.callbacks.clear();
+            ++it;
+        }
+        else
+        {
+            it = requests.erase(it);
+        }
+    }
+}
+
+bool SampleAnalyser::isPending(const Sample* sample) const
+{
+    const juce::ScopedLock sl(lock);
+    return requests.find(sample) != requests.end();
+}
+
+void SampleAnalyser::runNextRequest()
+{
+    std::shared_ptr<const Sample> sample;
+    Priority priority = Priority::background;
+    {
+        const juce::ScopedLock sl(lock);
+        const Request* next = nullptr;
+        for (const auto& entry : requests)
+        {
+            const auto& request = entry.second;
+            if (request.running)
+                continue;
+            if (next == nullptr || request.priority > next->priority
+                || (request.priority == next->priority && request.order < next->order))
+                next = &request;
+        }
+        // Cancelled requests leave their job behind with nothing to do.
+        if (next == nullptr)
+            return;
+
+        sample = next->sample;
+        priority = next->priority;
+        requests[sample.get()].running = true;
+    }
+
+    // Somebody is waiting on an interactive request, so it may use every core.
+    const int analysisThreads = priority == Priority::interactive ? juce::SystemStats::getNumCpus() : 1;
+    std::shared_ptr<const OnsetAnalysis> onsets = OnsetAnalysis::analyse(*sample, analysisThreads);
+    if (onsets != nullptr)
+        sample->setOnsetAnalysis(onsets);
+
+    std::vector<OnsetsReady> callbacks;
+    {
+        const juce::ScopedLock sl(lock);
+        auto found = requests.find(sample.get());
+        if (found != requests.end())
+        {
+            callbacks = std::move(found->second.callbacks);
+            requests.erase(found);
+        }
+    }
+
+    if (callbacks.empty())
+        return;
+
+    juce::MessageManager::callAsync([callbacks = std::move(callbacks), onsets]()
+    {
+        for (const auto& callback : callbacks)
+            callback(onsets);
+    });
+}
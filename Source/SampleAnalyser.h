@@ -0,0 +1,68 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include "OnsetAnalysis.h"
+#include "Sample.h"
+
+// Runs sample analysis on a thread pool and attaches the results to the Sample, so every
+// view, the slicer and the tempo fit share one analysis per sample. Requests for a sample
+// that is already queued or running join that analysis instead of starting another.
+// Interactive requests, such as a click in the slicer, jump ahead of background ones.
+//
+// All calls are made on the message thread, and results are delivered there too.
+class SampleAnalyser
+{
+public:
+    enum class Priority
+    {
+        background = 0,
+        interactive = 1
+    };
+
+    // Called with nullptr when the sample holds no audio.
+    using OnsetsReady = std::function<void(std::shared_ptr<const OnsetAnalysis> onsets)>;
+
+    explicit SampleAnalyser(int numThreads);
+    ~SampleAnalyser();
+
+    // Calls onReady straight away when the sample has been analysed already, otherwise
+    // once the analysis has run.
+    void requestOnsets(const std::shared_ptr<const Sample>& sample, Priority priority, OnsetsReady onReady);
+
+    // Forgets the requests for a sample, e.g. when its last clip is deleted. An analysis
+    // already running is left to finish and attached, but nobody is called.
+    void cancel(const Sample* sample);
+    // Cancels every request whose sample is not in samplesInUse, e.g. after a track is
+    // deleted, a project is loaded or an edit is undone.
+    void cancelAllExcept(const std::set<const Sample*>& samplesInUse);
+
+    bool isPending(const Sample* sample) const;
+
+private:
+    class AnalysisJob;
+
+    struct Request
+    {
+        std::shared_ptr<const Sample> sample;
+        Priority priority = Priority::background;
+        uint64 order = 0;  // first come, first served within a priority
+        bool running = false;
+        std::vector<OnsetsReady> callbacks;
+    };
+
+    // Picks the most urgent queued request and analyses it; called from pool threads.
+    void runNextRequest();
+
+    juce::CriticalSection lock;
+    std::map<const Sample*, Request> requests;
+    uint64 nextOrder = 0;
+    const int numThreads;
+    juce::ThreadPool pool;  // last, so it stops before the requests go
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleAnalyser)
+};
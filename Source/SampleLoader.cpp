@@ -0,0 +1,155 @@
+#include "SampleLoader.h"
+
+class SampleLoader::PeaksJob : public juce::ThreadPoolJob
+{
+public:
+    PeaksJob(SampleLoader& ownerIn, FileState& fileIn)
+        : juce::ThreadPoolJob("Read peaks " + juce::File(fileIn.filePath).getFileName()),
+          owner(ownerIn),
+          file(fileIn)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        if (!shouldExit())
+        {
+            file.cachedPeaks = owner.samplePool.getCachedPeaks(juce::File(file.filePath));
+            if (file.cachedPeaks != nullptr)
+                owner.addResult({ file.filePath, nullptr, file.cachedPeaks });
+        }
+
+        // Signalled even when cancelled, so the decode job never waits for nothing.
+        file.peaksRead.signal();
+        return jobHasFinished;
+    }
+
+private:
+    SampleLoader& owner;
+    FileState& file;
+};
+
+class SampleLoader::DecodeJob : public juce::ThreadPoolJob
+{
+public:
+    DecodeJob(SampleLoader& ownerIn, FileState& fileIn)
+        : juce::ThreadPoolJob("Decode " + juce::File(fileIn.filePath).getFileName()),
+          owner(ownerIn),
+          file(fileIn)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        // The file's peaks job was queued first, so it has been started by now and this
+        // wait is no longer than the lookup it is doing.
+        while (!file.peaksRead.wait(20))
+            if (shouldExit())
+                return jobHasFinished;
+
+        if (shouldExit())
+            return jobHasFinished;
+
+        auto sample = owner.samplePool.getSample(juce::File(file.filePath), std::move(file.cachedPeaks));
+        // Mapped and streamed audio builds its zero crossings on first use, which reads the
+        // whole file; do it here rather than on the first split or slice drag.
+        if (sample != nullptr)
+            sample->getZeroCrossings();
+        owner.addResult({ file.filePath, std::move(sample), nullptr });
+        return jobHasFinished;
+    }
+
+private:
+    SampleLoader& owner;
+    FileState& file;
+};
+
+SampleLoader::SampleLoader(SamplePool& poolIn, const juce::StringArray& filePaths, int numThreads)
+    : samplePool(poolIn),
+      threadPool(juce::ThreadPoolOptions{}
+                     .withThreadName("Sample decoder")
+                     .withNumberOfThreads(juce::jmax(1, numThreads))),
+      numFiles(filePaths.size())
+{
+    for (const auto& path : filePaths)
+    {
+        files.push_back(std::make_unique<FileState>());
+        files.back()->filePath = path;
+    }
+
+    // Every peak lookup is queued ahead of every decode. With several threads the two
+    // overlap, so a waveform may still arrive after some other file's audio; each decode
+    // waits only for its own file's lookup and reuses the peaks it found.
+    for (auto& file : files)
+        threadPool.addJob(new PeaksJob(*this, *file), true);
+    for (auto& file : files)
+        threadPool.addJob(new DecodeJob(*this, *file), true);
+
+    if (numFiles == 0)
+        triggerAsyncUpdate();
+}
+
+SampleLoader::~SampleLoader()
+{
+    // Jobs write into this object, so they must all be gone before it is.
+    threadPool.removeAllJobs(true, -1);
+    cancelPendingUpdate();
+}
+
+void SampleLoader::cancel()
+{
+    if (finished)
+        return;
+
+    threadPool.removeAllJobs(true, 0);
+    finish(true);
+}
+
+void SampleLoader::addResult(Result result)
+{
+    {
+        const juce::ScopedLock sl(resultLock);
+        results.push_back(std::move(result));
+    }
+    triggerAsyncUpdate();
+}
+
+void SampleLoader::handleAsyncUpdate()
+{
+    if (finished)
+        return;
+
+    std::vector<Result> arrived;
+    {
+        const juce::ScopedLock sl(resultLock);
+        arrived.swap(results);
+    }
+
+    for (auto& result : arrived)
+    {
+        if (result.peaks != nullptr)
+        {
+            if (onPeaksLoaded != nullptr)
+                onPeaksLoaded(result.filePath, std::move(result.peaks));
+            continue;
+        }
+
+        ++numDelivered;
+        if (onSampleLoaded != nullptr)
+            onSampleLoaded(result.filePath, std::move(result.sample));
+
+        // The callback may have cancelled us.
+        if (finished)
+            return;
+    }
+
+    if (numDelivered >= numFiles)
+        finish(false);
+}
+
+void SampleLoader::finish(bool wasCancelled)
+{
+    finished = true;
+    if (onFinished != nullptr)
+        onFinished(wasCancelled);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "SamplePool.h"
+
+// Decodes a set of sample files in parallel on a thread pool, so a project can be shown
+// before its audio is ready. Cached peak summaries are looked up first and handed to
+// onPeaksLoaded, so waveforms can be drawn while the audio is still decoding. Each decoded
+// sample is then handed to onSampleLoaded on the message thread as soon as it arrives;
+// failed files are reported with a null sample.
+class SampleLoader : private juce::AsyncUpdater
+{
+public:
+    SampleLoader(SamplePool& poolIn, const juce::StringArray& filePaths, int numThreads);
+    ~SampleLoader() override;
+
+    // Called on the message thread.
+    std::function<void(const juce::String& filePath, std::shared_ptr<const SamplePeaks> peaks)> onPeaksLoaded;
+    std::function<void(const juce::String& filePath, std::shared_ptr<const Sample> sample)> onSampleLoaded;
+    std::function<void(bool wasCancelled)> onFinished;
+
+    // Drops files that have not been decoded yet. Decodes already running are left to
+    // finish but their results are discarded; onFinished is called straight away.
+    void cancel();
+
+    bool isFinished() const { return finished; }
+    int getNumFiles() const { return numFiles; }
+    int getNumDelivered() const { return numDelivered; }
+    double getProgress() const { return numFiles > 0 ? (double)numDelivered / (double)numFiles : 1.0; }
+
+private:
+    class PeaksJob;
+    class DecodeJob;
+
+    // What the peak cache held for a file, shared by its two jobs so the decode does not
+    // look it up again.
+    struct FileState
+    {
+        juce::String filePath;
+        juce::WaitableEvent peaksRead {true};
+        std::shared_ptr<const SamplePeaks> cachedPeaks;
+    };
+
+    struct Result
+    {
+        juce::String filePath;
+        std::shared_ptr<const Sample> sample;
+        std::shared_ptr<const SamplePeaks> peaks; // set for cached peaks, which come first
+    };
+
+    void addResult(Result result);
+    void handleAsyncUpdate() override;
+    void finish(bool wasCancelled);
+
+    SamplePool& samplePool;
+    std::vector<std::unique_ptr<FileState>> files;
+    juce::ThreadPool threadPool;
+    juce::CriticalSection resultLock;
+    std::vector<Result> results;
+    int numFiles = 0;
+    int numDelivered = 0;
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleLoader)
+};
@@ -0,0 +1,144 @@
+#include "SamplePeaks.h"
+#include <limits>
+
+namespace
+{
+constexpr int readBlockSamples = 1 << 16; // a multiple of baseBlockSize
+}
+
+SamplePeaks::SamplePeaks(int numChannelsIn, int64 numSamplesIn)
+    : numChannels(numChannelsIn),
+      numSamples(numSamplesIn)
+{
+}
+
+std::unique_ptr<SamplePeaks> SamplePeaks::build(int numChannels, int64 numSamples, const ReadFunction& read)
+{
+    if (numChannels <= 0 || numSamples <= 0)
+        return nullptr;
+
+    std::unique_ptr<SamplePeaks> peaks(new SamplePeaks(numChannels, numSamples));
+    const int64 numBlocks = (numSamples + baseBlockSize - 1) / baseBlockSize;
+    auto& base = peaks->levels.emplace_back((size_t)(numBlocks * numChannels));
+
+    std::vector<float> frames((size_t)juce::jmin<int64>(numSamples, readBlockSamples));
+    for (int64 start = 0; start < numSamples; start += readBlockSamples)
+    {
+        const int count = (int)juce::jmin<int64>(readBlockSamples, numSamples - start);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            read(ch, start, count, frames.data());
+            for (int offset = 0; offset < count; offset += baseBlockSize)
+            {
+                const int blockLength = juce::jmin(baseBlockSize, count - offset);
+                const auto range = juce::FloatVectorOperations::findMinAndMax(frames.data() + offset, blockLength);
+                float sumSquares = 0.0f;
+                for (int i = 0; i < blockLength; ++i)
+                    sumSquares += frames[(size_t)(offset + i)] * frames[(size_t)(offset + i)];
+
+                const int64 block = (start + offset) / baseBlockSize;
+                base[(size_t)(block * numChannels + ch)] = { range.getStart(), range.getEnd(), sumSquares / (float)blockLength };
+            }
+        }
+    }
+
+    peaks->buildLevels();
+    return peaks;
+}
+
+void SamplePeaks::writeTo(juce::OutputStream& out) const
+{
+    const auto& base = levels.front();
+    out.writeInt(numChannels);
+    out.writeInt64(numSamples);
+    out.writeInt(baseBlockSize);
+    out.writeInt64((int64)base.size());
+    out.write(base.data(), base.size() * sizeof(Peak));
+}
+
+std::unique_ptr<SamplePeaks> SamplePeaks::readFrom(juce::InputStream& in)
+{
+    const int channels = in.readInt();
+    const int64 length = in.readInt64();
+    const int blockSize = in.readInt();
+    const int64 numPeaks = in.readInt64();
+    if (channels <= 0 || length <= 0 || blockSize != baseBlockSize
+        || numPeaks != ((length + baseBlockSize - 1) / baseBlockSize) * channels)
+        return nullptr;
+
+    const auto numBytes = (size_t)numPeaks * sizeof(Peak);
+    if (numBytes > (size_t)std::numeric_limits<int>::max()
+        || (in.getNumBytesRemaining() >= 0 && (int64)numBytes > in.getNumBytesRemaining()))
+        return nullptr;
+
+    std::unique_ptr<SamplePeaks> peaks(new SamplePeaks(channels, length));
+    auto& base = peaks->levels.emplace_back((size_t)numPeaks);
+    if (in.read(base.data(), numBytes) != (int)numBytes)
+        return nullptr;
+
+    peaks->buildLevels();
+    return peaks;
+}
+
+void SamplePeaks::buildLevels()
+{
+    while (levels.back().size() > (size_t)numChannels)
+    {
+        const auto& finer = levels.back();
+        const size_t finerBlocks = finer.size() / (size_t)numChannels;
+        std::vector<Peak> coarser(((finerBlocks + 1) / 2) * (size_t)numChannels);
+        for (size_t block = 0; block < finerBlocks; block += 2)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const auto& a = finer[block * (size_t)numChannels + (size_t)ch];
+                auto& dest = coarser[(block / 2) * (size_t)numChannels + (size_t)ch];
+                dest = block + 1 < finerBlocks ? merge(a, finer[(block + 1) * (size_t)numChannels + (size_t)ch]) : a;
+            }
+        }
+        levels.push_back(std::move(coarser));
+    }
+}
+
+SamplePeaks::Peak SamplePeaks::merge(const Peak& a, const Peak& b)
+{
+    return { juce::jmin(a.min, b.min), juce::jmax(a.max, b.max), 0.5f * (a.meanSquare + b.meanSquare) };
+}
+
+SamplePeaks::Peak SamplePeaks::getPeak(int channel, int64 startSample, int64 endSample) const
+{
+    channel = juce::jlimit(0, numChannels - 1, channel);
+    startSample = juce::jlimit<int64>(0, numSamples - 1, startSample);
+    endSample = juce::jlimit<int64>(startSample + 1, numSamples, endSample);
+
+    // Use blocks at most half the range long, so at most a few are merged and widening the
+    // range to whole blocks at most doubles it.
+    const int64 span = endSample - startSample;
+    int level = 0;
+    while (level + 1 < (int)levels.size() && ((int64)baseBlockSize << (level + 1)) * 2 <= span)
+        ++level;
+
+    const int64 blockSize = (int64)baseBlockSize << level;
+    const auto& blocks = levels[(size_t)level];
+    const int64 firstBlock = startSample / blockSize;
+    const int64 lastBlock = (endSample - 1) / blockSize;
+
+    Peak result = blocks[(size_t)(firstBlock * numChannels + channel)];
+    for (int64 block = firstBlock + 1; block <= lastBlock; ++block)
+    {
+        const auto& next = blocks[(size_t)(block * numChannels + channel)];
+        result.min = juce::jmin(result.min, next.min);
+        result.max = juce::jmax(result.max, next.max);
+        result.meanSquare += next.meanSquare;
+    }
+    result.meanSquare /= (float)(lastBlock - firstBlock + 1);
+    return result;
+}
+
+int64 SamplePeaks::getMemoryUsageBytes() const
+{
+    int64 bytes = 0;
+    for (const auto& level : levels)
+        bytes += (int64)(level.size() * sizeof(Peak));
+    return bytes;
+}
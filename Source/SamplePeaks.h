@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Min/max/RMS summary of a sample's audio at successively halved resolutions, so drawing a
+// waveform costs the same however long the file is. The finest level summarises blocks of
+// baseBlockSize frames; each level above merges pairs of blocks from the one below.
+class SamplePeaks
+{
+public:
+    struct Peak
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+        float meanSquare = 0.0f;
+
+        float getMagnitude() const { return juce::jmax(std::abs(min), std::abs(max)); }
+        float getRms() const { return std::sqrt(meanSquare); }
+    };
+
+    static constexpr int baseBlockSize = 64;
+
+    // Reads frames [startSample, startSample + numSamples) of one channel into dest.
+    using ReadFunction = std::function<void(int channel, int64 startSample, int numSamples, float* dest)>;
+
+    static std::unique_ptr<SamplePeaks> build(int numChannels, int64 numSamples, const ReadFunction& read);
+
+    // Stores the finest level; the coarser ones are rebuilt when it is read back.
+    void writeTo(juce::OutputStream& out) const;
+    static std::unique_ptr<SamplePeaks> readFrom(juce::InputStream& in);
+
+    int getNumChannels() const { return numChannels; }
+    int64 getNumSamples() const { return numSamples; }
+
+    // Summary of [startSample, endSample) from the coarsest level that still resolves it,
+    // widened to whole blocks of that level.
+    Peak getPeak(int channel, int64 startSample, int64 endSample) const;
+
+    int64 getMemoryUsageBytes() const;
+
+private:
+    SamplePeaks(int numChannelsIn, int64 numSamplesIn);
+
+    void buildLevels();
+    static Peak merge(const Peak& a, const Peak& b);
+
+    int numChannels = 0;
+    int64 numSamples = 0;
+    std::vector<std::vector<Peak>> levels; // [level][block * numChannels + channel]
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePeaks)
+};
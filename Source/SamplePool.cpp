@@ -0,0 +1,135 @@
+#include "SamplePool.h"
+
+SamplePool::Key SamplePool::makeKey(const juce::File& file, Sample::Encoding encoding)
+{
+    const auto target = file.getLinkedTarget();
+    return { target.getFullPathName(), target.getLastModificationTime().toMilliseconds(), target.getSize(), encoding };
+}
+
+std::shared_ptr<const Sample> SamplePool::getSample(const juce::File& file)
+{
+    return getSampleUsingPeaks(file, nullptr);
+}
+
+std::shared_ptr<const Sample> SamplePool::getSample(const juce::File& file, std::shared_ptr<const SamplePeaks> cachedPeaks)
+{
+    return getSampleUsingPeaks(file, &cachedPeaks);
+}
+
+std::shared_ptr<const Sample> SamplePool::getSampleUsingPeaks(const juce::File& file, const std::shared_ptr<const SamplePeaks>* cachedPeaks)
+{
+    const double sampleRate = playbackSampleRate.load();
+    auto key = makeKey(file, encoding.load());
+    key.sampleRate = sampleRate;
+    if (sampleRate > 0.0)
+        if (auto existing = findEntry(key))
+            return existing;
+
+    auto original = getSourceSampleUsingPeaks(file, cachedPeaks);
+    if (original == nullptr || !needsConversion(*original, sampleRate))
+        return original;
+
+    auto converted = std::make_shared<Sample>();
+    if (!converted->loadResampled(*original, sampleRate))
+        return original;
+
+    return addEntry(key, std::move(converted));
+}
+
+std::shared_ptr<const Sample> SamplePool::getSourceSample(const juce::File& file)
+{
+    return getSourceSampleUsingPeaks(file, nullptr);
+}
+
+std::shared_ptr<const Sample> SamplePool::getSourceSampleUsingPeaks(const juce::File& file, const std::shared_ptr<const SamplePeaks>* cachedPeaks)
+{
+    const auto key = makeKey(file, encoding.load());
+    if (auto existing = findEntry(key))
+        return existing;
+
+    // Decode outside the lock so other files can be looked up meanwhile.
+    auto peaks = cachedPeaks != nullptr ? *cachedPeaks : peakCache.load(file);
+    auto sample = std::make_shared<Sample>();
+    if (!sample->loadFromFile(file, Sample::Storage::automatic, key.encoding, peaks))
+        return nullptr;
+    if (sample->getPeaks() != nullptr && sample->getPeaks() != peaks)
+        peakCache.store(file, *sample->getPeaks());
+
+    return addEntry(key, std::move(sample));
+}
+
+std::shared_ptr<const Sample> SamplePool::findSample(const juce::File& file) const
+{
+    auto key = makeKey(file, encoding.load());
+    key.sampleRate = playbackSampleRate.load();
+    if (key.sampleRate > 0.0)
+        if (auto converted = findEntry(key))
+            return converted;
+
+    key.sampleRate = 0.0;
+    return findEntry(key);
+}
+
+bool SamplePool::needsConversion(const Sample& sample) const
+{
+    return needsConversion(sample, playbackSampleRate.load());
+}
+
+bool SamplePool::needsConversion(const Sample& sample, double sampleRate)
+{
+    return sampleRate > 0.0
+           && sample.getStorage() == Sample::Storage::inMemory
+           && std::abs(sample.getSampleRate() - sampleRate) > 0.01;
+}
+
+std::shared_ptr<const Sample> SamplePool::findEntry(const Key& key) const
+{
+    const juce::ScopedLock sl(lock);
+    auto it = entries.find(key);
+    return it != entries.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<const Sample> SamplePool::addEntry(const Key& key, std::shared_ptr<const Sample> sample)
+{
+    const juce::ScopedLock sl(lock);
+    removeExpiredEntries();
+
+    // Another thread may have made the same sample in the meantime; keep the first copy.
+    auto& entry = entries[key];
+    if (auto existing = entry.lock())
+        return existing;
+
+    entry = sample;
+    return sample;
+}
+
+int SamplePool::getNumSamples() const
+{
+    const juce::ScopedLock sl(lock);
+    int count = 0;
+    for (const auto& entry : entries)
+        if (!entry.second.expired())
+            ++count;
+    return count;
+}
+
+int64 SamplePool::getMemoryUsageBytes() const
+{
+    const juce::ScopedLock sl(lock);
+    int64 bytes = 0;
+    for (const auto& entry : entries)
+        if (auto sample = entry.second.lock())
+            bytes += sample->getMemoryUsageBytes();
+    return bytes;
+}
+
+void SamplePool::removeExpiredEntries()
+{
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->second.expired())
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include "PeakCache.h"
+#include "Sample.h"
+
+// Hands out decoded samples shared by every clip that uses the same source file. Entries
+// are keyed by canonical path, modification time, size, in-memory encoding and sample rate,
+// so an edited file is decoded again. The pool only holds weak references: audio no clip
+// uses any more is freed.
+//
+// Files recorded at a different rate from the playback rate are converted once and the
+// converted copy is cached next to the original, so rendering and analysis never have to
+// account for the file's own rate. Peak summaries are kept in an on-disk PeakCache, so a
+// file seen before is not scanned again.
+class SamplePool
+{
+public:
+    SamplePool() = default;
+
+    // The sample at the playback rate, decoding and converting it if needed. Slow for a
+    // file that is not cached yet, so call it from a background thread.
+    std::shared_ptr<const Sample> getSample(const juce::File& file);
+    // The same, for a caller that has already looked the file up in the peak cache with
+    // getCachedPeaks(); cachedPeaks is what that found, nullptr included.
+    std::shared_ptr<const Sample> getSample(const juce::File& file, std::shared_ptr<const SamplePeaks> cachedPeaks);
+    // The sample at the file's own rate.
+    std::shared_ptr<const Sample> getSourceSample(const juce::File& file);
+    // Returns an already decoded sample without touching the disk beyond reading the file's
+    // attributes: the playback-rate copy if there is one, otherwise the original.
+    std::shared_ptr<const Sample> findSample(const juce::File& file) const;
+
+    // Directory for cached peak summaries; nothing is cached until it is set.
+    void setPeakCacheDirectory(const juce::File& directory) { peakCache.setDirectory(directory); }
+    // Peaks of the file from the on-disk cache, or nullptr. Much faster than getSample().
+    std::shared_ptr<const SamplePeaks> getCachedPeaks(const juce::File& file) const { return peakCache.load(file); }
+
+    // Rate samples are converted to; 0 turns conversion off.
+    void setPlaybackSampleRate(double newSampleRate) { playbackSampleRate = newSampleRate; }
+    double getPlaybackSampleRate() const { return playbackSampleRate; }
+    // True when getSample() would return a converted copy instead of this sample.
+    bool needsConversion(const Sample& sample) const;
+
+    // Encoding used for samples decoded from now on; samples already handed out keep theirs.
+    void setEncoding(Sample::Encoding newEncoding) { encoding = newEncoding; }
+    Sample::Encoding getEncoding() const { return encoding; }
+
+    int getNumSamples() const;
+    int64 getMemoryUsageBytes() const;
+
+private:
+    struct Key
+    {
+        juce::String path;
+        int64 modificationTime = 0;
+        int64 size = 0;
+        Sample::Encoding encoding = Sample::Encoding::automatic;
+        double sampleRate = 0.0; // 0 for the file's own rate
+
+        bool operator<(const Key& other) const
+        {
+            if (path != other.path)
+                return path < other.path;
+            if (modificationTime != other.modificationTime)
+                return modificationTime < other.modificationTime;
+            if (size != other.size)
+                return size < other.size;
+            if (encoding != other.encoding)
+                return encoding < other.encoding;
+            return sampleRate < other.sampleRate;
+        }
+    };
+
+    // cachedPeaks is nullptr when the peak cache has not been read yet.
+    std::shared_ptr<const Sample> getSampleUsingPeaks(const juce::File& file, const std::shared_ptr<const SamplePeaks>* cachedPeaks);
+    std::shared_ptr<const Sample> getSourceSampleUsingPeaks(const juce::File& file, const std::shared_ptr<const SamplePeaks>* cachedPeaks);
+    static Key makeKey(const juce::File& file, Sample::Encoding encoding);
+    static bool needsConversion(const Sample& sample, double sampleRate);
+    std::shared_ptr<const Sample> findEntry(const Key& key) const;
+    std::shared_ptr<const Sample> addEntry(const Key& key, std::shared_ptr<const Sample> sample);
+    void removeExpiredEntries();
+
+    PeakCache peakCache;
+    juce::CriticalSection lock;
+    std::map<Key, std::weak_ptr<const Sample>> entries;
+    std::atomic<Sample::Encoding> encoding {Sample::Encoding::automatic};
+    std::atomic<double> playbackSampleRate {0.0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePool)
+};
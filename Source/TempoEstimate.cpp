@@ -0,0 +1,104 @@
+#include "TempoEstimate.h"
+#include <cmath>
+#include <vector>
+
+namespace
+{
+// Harmonics of the beat period summed into each candidate's score.
+constexpr int combHarmonics = 4;
+// Scores below this mean the sample has no steady pulse worth fitting to.
+constexpr double minConfidence = 0.15;
+
+double readInterpolated(const std::vector<double>& values, double position)
+{
+    const int index = (int)position;
+    if (index < 0 || index + 1 >= (int)values.size())
+        return 0.0;
+    const double frac = position - (double)index;
+    return values[(size_t)index] + (values[(size_t)(index + 1)] - values[(size_t)index]) * frac;
+}
+}
+
+TempoEstimate TempoEstimate::fromOnsets(const OnsetAnalysis& onsets, int beatsPerBar)
+{
+    TempoEstimate result;
+    const int numFrames = onsets.getNumFrames();
+    const double sampleRate = onsets.getSampleRate();
+    const double framesPerSecond = sampleRate / (double)OnsetAnalysis::hopSize;
+    const double lengthSeconds = (double)onsets.getNumSamples() / sampleRate;
+    if (numFrames < 8 || lengthSeconds <= 0.0)
+        return result;
+
+    // Autocorrelation of the mean-removed strength, up to the longest lag the comb reads.
+    const int maxLag = juce::jmin(numFrames - 1,
+                                  (int)std::ceil(framesPerSecond * 60.0 / minBpm * combHarmonics) + 1);
+    // Kicks and snares mark the beat while hi-hats often run at twice its rate, so the low
+    // and mid bands outweigh the full-range strength; otherwise the tempo doubles too often.
+    const auto& strength = onsets.getStrength();
+    const auto& low = onsets.getBandStrength(0);
+    const auto& mid = onsets.getBandStrength(1);
+    std::vector<double> centred((size_t)numFrames);
+    double mean = 0.0;
+    for (int i = 0; i < numFrames; ++i)
+    {
+        centred[(size_t)i] = (double)low[(size_t)i] + (double)mid[(size_t)i] + 0.25 * (double)strength[(size_t)i];
+        mean += centred[(size_t)i];
+    }
+    mean /= (double)numFrames;
+    for (auto& value : centred)
+        value -= mean;
+
+    std::vector<double> correlation((size_t)maxLag + 1, 0.0);
+    for (int lag = 0; lag <= maxLag; ++lag)
+    {
+        double sum = 0.0;
+        for (int i = lag; i < numFrames; ++i)
+            sum += centred[(size_t)i] * centred[(size_t)(i - lag)];
+        // Unbiased, so long lags are not penalised for overlapping less of the sample.
+        correlation[(size_t)lag] = sum / (double)(numFrames - lag);
+    }
+    const double energy = correlation[0];
+    if (energy <= 0.0)
+        return result;
+    for (auto& value : correlation)
+        value /= energy;
+
+    const int beatsPerBarToUse = juce::jmax(1, beatsPerBar);
+    const int minBeats = juce::jmax(1, (int)std::ceil(lengthSeconds * minBpm / 60.0));
+    const int maxBeats = (int)std::floor(lengthSeconds * maxBpm / 60.0);
+
+    double bestScore = 0.0;
+    for (int beats = minBeats; beats <= maxBeats; ++beats)
+    {
+        const double bpm = 60.0 * (double)beats / lengthSeconds;
+        const double period = framesPerSecond * 60.0 / bpm;
+
+        double comb = 0.0;
+        double weight = 0.0;
+        for (int h = 1; h <= combHarmonics; ++h)
+        {
+            if (period * h >= (double)maxLag)
+                break;
+            comb += readInterpolated(correlation, period * h) / (double)h;
+            weight += 1.0 / (double)h;
+        }
+        if (weight <= 0.0)
+            continue;
+        comb /= weight;
+
+        const double octavesFrom120 = std::log2(bpm / 120.0);
+        const double tempoPrior = std::exp(-0.5 * octavesFrom120 * octavesFrom120 / (0.6 * 0.6));
+        const double barPrior = beats % beatsPerBarToUse == 0 ? 1.0 : 0.8;
+        const double score = comb * (0.5 + 0.5 * tempoPrior) * barPrior;
+        if (score > bestScore)
+        {
+            bestScore = score;
+            result.bpm = bpm;
+            result.numBeats = beats;
+        }
+    }
+
+    result.confidence = juce::jlimit(0.0, 1.0, bestScore);
+    result.valid = result.numBeats > 0 && bestScore >= minConfidence;
+    return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "OnsetAnalysis.h"
+
+// Tempo and length in beats of a sample, estimated from its onset strength. The sample is
+// assumed to hold a whole number of beats, as loops do, so each beat count that gives a
+// plausible tempo is tried and scored by how well onsets repeat at that beat period and
+// its multiples (the autocorrelation of the onset strength, read as a comb). Counts that
+// fill whole bars and tempos near 120 BPM win ties.
+struct TempoEstimate
+{
+    bool valid = false;
+    double bpm = 0.0;
+    int numBeats = 0;
+    double confidence = 0.0;  // 0 to 1
+
+    static TempoEstimate fromOnsets(const OnsetAnalysis& onsets, int beatsPerBar);
+
+    static constexpr double minBpm = 60.0;
+    static constexpr double maxBpm = 200.0;
+};
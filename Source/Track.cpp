@@ -2,6 +2,9 @@
 #include <cmath>
 #include <algorithm>
 #include <vector>
+#include <limits>
+#include <map>
+#include <tuple>
 
 namespace
 {
@@ -38,12 +41,145 @@ juce::Array<TrackAutomationPoint> normalizeAutomation(const juce::Array<TrackAut
     }
     return dedup;
 }
+
+// Automation is piecewise linear. Segment k covers positions after point k - 1 up to and
+// including point k; segment 0 holds the first value and segment size() the last.
+int seekAutomationSegment(const juce::Array<TrackAutomationPoint>& automation, int64 samplePosition, int hint)
+{
+    const int size = automation.size();
+    auto isBefore = [&automation, samplePosition](int i) { return automation.getReference(i).samplePosition < samplePosition; };
+    auto isCurrent = [&](int k) { return (k == 0 || isBefore(k - 1)) && (k == size || !isBefore(k)); };
+
+    const int index = juce::jlimit(0, size, hint);
+    if (isCurrent(index))
+        return index;
+    if (index < size && isCurrent(index + 1))
+        return index + 1;
+
+    const auto found = std::lower_bound(automation.begin(), automation.end(), samplePosition,
+                                        [](const TrackAutomationPoint& p, int64 position) { return p.samplePosition < position; });
+    return (int)(found - automation.begin());
+}
+
+int64 getAutomationSegmentEnd(const juce::Array<TrackAutomationPoint>& automation, int segment)
+{
+    if (segment >= automation.size())
+        return std::numeric_limits<int64>::max();
+    return automation.getReference(segment).samplePosition + 1;
+}
+
+double getAutomationValue(const juce::Array<TrackAutomationPoint>& automation,
+                          int segment,
+                          int64 samplePosition,
+                          double defaultValue,
+                          double minValue,
+                          double maxValue)
+{
+    if (automation.isEmpty())
+        return juce::jlimit(minValue, maxValue, defaultValue);
+    if (segment <= 0)
+        return juce::jlimit(minValue, maxValue, automation.getReference(0).value);
+    if (segment >= automation.size())
+        return juce::jlimit(minValue, maxValue, automation.getReference(automation.size() - 1).value);
+
+    const auto& a = automation.getReference(segment - 1);
+    const auto& b = automation.getReference(segment);
+    const int64 span = juce::jmax<int64>(1, b.samplePosition - a.samplePosition);
+    const double t = (double)(samplePosition - a.samplePosition) / (double)span;
+    return juce::jlimit(minValue, maxValue, juce::jmap(t, a.value, b.value));
+}
+
+bool isAutomationSegmentRamp(const juce::Array<TrackAutomationPoint>& automation, int segment)
+{
+    return segment > 0 && segment < automation.size()
+           && automation.getReference(segment - 1).value != automation.getReference(segment).value;
+}
+
+// Pan ramps are evaluated with the equal-power law at this spacing and interpolated
+// linearly in between.
+constexpr int panRampStepSamples = 32;
+
+bool sameAutomation(const juce::Array<TrackAutomationPoint>& a, const juce::Array<TrackAutomationPoint>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (int i = 0; i < a.size(); ++i)
+        if (a.getReference(i).samplePosition != b.getReference(i).samplePosition
+            || a.getReference(i).value != b.getReference(i).value)
+            return false;
+    return true;
+}
+
+bool sameWarpCurve(const WarpCurve& a, const WarpCurve& b)
+{
+    if (a.isRelativeMode() != b.isRelativeMode()
+        || a.getSmoothRateChanges() != b.getSmoothRateChanges())
+        return false;
+    const auto& pa = a.getPoints();
+    const auto& pb = b.getPoints();
+    if (pa.size() != pb.size())
+        return false;
+    for (int i = 0; i < pa.size(); ++i)
+        if (pa.getReference(i).t != pb.getReference(i).t || pa.getReference(i).v != pb.getReference(i).v)
+            return false;
+    return true;
+}
+
+bool sameSlicing(const BeatSlicingSettings& a, const BeatSlicingSettings& b)
+{
+    if (a.enabled != b.enabled || a.mode != b.mode || a.slices.size() != b.slices.size())
+        return false;
+    for (int i = 0; i < a.slices.size(); ++i)
+    {
+        const auto& sa = a.slices.getReference(i);
+        const auto& sb = b.slices.getReference(i);
+        if (sa.startNorm != sb.startNorm || sa.endNorm != sb.endNorm
+            || sa.playProbability != sb.playProbability || sa.ratchetRepeats != sb.ratchetRepeats
+            || sa.repeatProbability != sb.repeatProbability)
+            return false;
+    }
+    return true;
+}
+
+bool sameClip(const TrackClip& a, const TrackClip& b)
+{
+    return a.sample == b.sample
+        && a.startSample == b.startSample
+        && a.lengthSamples == b.lengthSamples
+        && a.sourceStartNorm == b.sourceStartNorm
+        && a.sourceEndNorm == b.sourceEndNorm
+        && a.fitLengthUnits == b.fitLengthUnits
+        && a.fitToSnapDivision == b.fitToSnapDivision
+        && a.gain == b.gain
+        && a.fadeInNorm == b.fadeInNorm
+        && a.fadeOutNorm == b.fadeOutNorm
+        && a.muted == b.muted
+        && a.name == b.name
+        && a.sourceFilePath == b.sourceFilePath
+        && sameWarpCurve(a.warpCurve, b.warpCurve)
+        && sameSlicing(a.slicing, b.slicing);
+}
 }
 
 void Track::addClip(const TrackClip& clip)
 {
     clips.add(clip);
     ensurePlaybackStateSize();
+    renderPlans.add(ClipRenderPlan{});
+    rebuildRenderPlan(clips.size() - 1);
+    rebuildClipIndex();
+}
+
+void Track::setClips(const juce::Array<TrackClip>& newClips)
+{
+    clips = newClips;
+    playbackStates.clear();
+    ensurePlaybackStateSize();
+    renderPlans.clearQuick();
+    renderPlans.insertMultiple(0, ClipRenderPlan{}, clips.size());
+    for (int i = 0; i < clips.size(); ++i)
+        rebuildRenderPlan(i);
+    rebuildClipIndex();
 }
 
 void Track::updateClip(int index, const TrackClip& clip)
@@ -52,12 +188,64 @@ void Track::updateClip(int index, const TrackClip& clip)
         return;
     clips.set(index, clip);
     ensurePlaybackStateSize();
+    rebuildRenderPlan(index);
+    rebuildClipIndex();
 }
 
 void Track::clear()
 {
     clips.clear();
     playbackStates.clear();
+    renderPlans.clear();
+    clipsByStart.clear();
+    clipsByStartMaxEnd.clear();
+}
+
+bool Track::hasSameContent(const Track& other) const
+{
+    if (muted != other.muted
+        || clips.size() != other.clips.size()
+        || tempoBpm != other.tempoBpm
+        || timeSigNumerator != other.timeSigNumerator
+        || timeSigDenominator != other.timeSigDenominator
+        || snapEnabled != other.snapEnabled
+        || snapDivision != other.snapDivision
+        || zoomX != other.zoomX
+        || zoomY != other.zoomY
+        || volume != other.volume
+        || pan != other.pan
+        || name != other.name)
+        return false;
+
+    for (int m = 0; m < 2; ++m)
+        if (loopMarkerEnabled[m] != other.loopMarkerEnabled[m] || loopMarkerSamples[m] != other.loopMarkerSamples[m])
+            return false;
+
+    if (!sameAutomation(volumeAutomation, other.volumeAutomation)
+        || !sameAutomation(panAutomation, other.panAutomation))
+        return false;
+
+    for (int i = 0; i < clips.size(); ++i)
+        if (!sameClip(clips.getReference(i), other.clips.getReference(i)))
+            return false;
+    return true;
+}
+
+int64 Track::getMemoryUsageBytes() const
+{
+    int64 bytes = (int64)sizeof(Track) + name.getNumBytesAsUTF8();
+    bytes += (int64)(volumeAutomation.size() + panAutomation.size()) * (int64)sizeof(TrackAutomationPoint);
+    bytes += (int64)clips.size() * (int64)(sizeof(TrackClip) + sizeof(ClipPlaybackState) + sizeof(ClipRenderPlan));
+    bytes += (int64)clipsByStart.size() * (int64)(sizeof(int) + sizeof(int64));
+    for (const auto& clip : clips)
+    {
+        bytes += clip.name.getNumBytesAsUTF8() + clip.sourceFilePath.getNumBytesAsUTF8();
+        bytes += (int64)clip.warpCurve.getPoints().size() * (int64)sizeof(WarpCurve::Point);
+        bytes += (int64)clip.slicing.slices.size() * (int64)(sizeof(BeatSlice) + sizeof(SliceWindow));
+    }
+    for (const auto& state : playbackStates)
+        bytes += (int64)(state.segmentSliceOrder.size() + state.segmentActive.size() + state.repeatActive.size() * 16) * 4;
+    return bytes;
 }
 
 void Track::setVolumeAutomation(const juce::Array<TrackAutomationPoint>& points)
@@ -219,6 +407,71 @@ void Track::ensurePlaybackStateSize()
         playbackStates.removeLast();
 }
 
+void Track::rebuildRenderPlan(int clipIndex)
+{
+    const auto& clip = clips.getReference(clipIndex);
+    auto& plan = renderPlans.getReference(clipIndex);
+    plan = ClipRenderPlan{};
+
+    plan.active = !clip.muted && clip.sample != nullptr && clip.lengthSamples > 0;
+    if (!plan.active)
+        return;
+
+    plan.hasAudio = clip.sample->getNumSamples() > 0 && clip.sample->getNumChannels() > 0;
+    plan.sliced = clip.slicing.enabled && !clip.slicing.slices.isEmpty();
+    plan.startSample = clip.startSample;
+    plan.endSample = clip.startSample + clip.lengthSamples;
+    plan.lengthSamples = (double)clip.lengthSamples;
+
+    plan.sourceStartNorm = juce::jlimit(0.0, 1.0, (double)clip.sourceStartNorm);
+    plan.sourceEndNorm = juce::jlimit(plan.sourceStartNorm, 1.0, (double)clip.sourceEndNorm);
+    plan.sourceRangeNorm = juce::jmax(0.000001, plan.sourceEndNorm - plan.sourceStartNorm);
+    for (const auto& slice : clip.slicing.slices)
+    {
+        SliceWindow window;
+        window.startNorm = juce::jlimit(0.0, 1.0, slice.startNorm);
+        window.endNorm = juce::jlimit(window.startNorm, 1.0, slice.endNorm);
+        window.repeats = juce::jmax(1, slice.ratchetRepeats);
+        plan.slices.add(window);
+    }
+
+    const float fadeIn = juce::jlimit(0.0f, 0.98f, clip.fadeInNorm);
+    const float fadeOut = juce::jlimit(0.0f, 0.98f - fadeIn, clip.fadeOutNorm);
+    plan.fadeInScale = fadeIn > 0.0f ? 1.0 / (double)fadeIn : 0.0;
+    plan.fadeOutScale = fadeOut > 0.0f ? 1.0 / (double)fadeOut : 0.0;
+    plan.gain = clip.gain;
+    plan.warpLookup = clip.warpCurve.getLookupTable();
+
+    if (plan.hasAudio)
+    {
+        plan.lastSourceChannel = clip.sample->getNumChannels() - 1;
+        plan.lastSourceSample = (double)(clip.sample->getNumSamples() - 1);
+    }
+}
+
+void Track::rebuildClipIndex()
+{
+    clipsByStart.clear();
+    for (int i = 0; i < renderPlans.size(); ++i)
+    {
+        if (renderPlans.getReference(i).active)
+            clipsByStart.push_back(i);
+    }
+
+    std::stable_sort(clipsByStart.begin(), clipsByStart.end(), [this](int a, int b)
+    {
+        return renderPlans.getReference(a).startSample < renderPlans.getReference(b).startSample;
+    });
+
+    clipsByStartMaxEnd.resize(clipsByStart.size());
+    int64 maxEnd = std::numeric_limits<int64>::min();
+    for (size_t i = 0; i < clipsByStart.size(); ++i)
+    {
+        maxEnd = juce::jmax(maxEnd, renderPlans.getReference(clipsByStart[i]).endSample);
+        clipsByStartMaxEnd[i] = maxEnd;
+    }
+}
+
 void Track::preparePlaybackPlan(int clipIndex)
 {
     if (clipIndex < 0 || clipIndex >= clips.size())
@@ -281,79 +534,157 @@ void Track::preparePlaybackPlan(int clipIndex)
     }
 }
 
-float Track::renderSlicedSample(const TrackClip& clip, const ClipPlaybackState& state, double localNorm, int channel) const
+bool Track::getSlicedSourceNorm(const ClipRenderPlan& plan, const ClipPlaybackState& state, double localNorm, double& clipNorm) const
 {
-    const auto& slices = clip.slicing.slices;
-    const int numSlices = slices.size();
+    const int numSlices = plan.slices.size();
     if (numSlices == 0)
-        return 0.0f;
+        return false;
 
     const double scaled = juce::jlimit(0.0, 0.999999, localNorm) * (double)numSlices;
     const int segmentIndex = juce::jlimit(0, numSlices - 1, (int)scaled);
     const double segmentLocal = scaled - (double)segmentIndex;
 
     if (segmentIndex >= state.segmentActive.size() || !state.segmentActive[segmentIndex])
-        return 0.0f;
+        return false;
 
     if (segmentIndex >= state.segmentSliceOrder.size())
-        return 0.0f;
+        return false;
 
     const int sliceIndex = state.segmentSliceOrder[segmentIndex];
-    if (sliceIndex < 0 || sliceIndex >= slices.size())
-        return 0.0f;
+    if (sliceIndex < 0 || sliceIndex >= numSlices)
+        return false;
 
-    const auto& slice = slices.getReference(sliceIndex);
-    const int repeats = juce::jmax(1, slice.ratchetRepeats);
+    const auto& slice = plan.slices.getReference(sliceIndex);
+    const int repeats = slice.repeats;
     const int repeatIndex = juce::jlimit(0, repeats - 1, (int)(segmentLocal * (double)repeats));
 
     if (segmentIndex < state.repeatActive.size())
     {
         const auto& repeatFlags = state.repeatActive.getReference(segmentIndex);
         if (repeatIndex < repeatFlags.size() && !repeatFlags[repeatIndex])
-            return 0.0f;
+            return false;
     }
 
     const double repeatLocal = juce::jlimit(0.0, 1.0, segmentLocal * (double)repeats - (double)repeatIndex);
-    const double clipSourceStart = juce::jlimit(0.0, 1.0, (double)clip.sourceStartNorm);
-    const double clipSourceEnd = juce::jlimit(clipSourceStart, 1.0, (double)clip.sourceEndNorm);
-    const double clipSourceRange = juce::jmax(0.000001, clipSourceEnd - clipSourceStart);
-    const double startNorm = juce::jlimit(0.0, 1.0, slice.startNorm);
-    const double endNorm = juce::jlimit(startNorm, 1.0, slice.endNorm);
-    const double sliceNorm = juce::jmap(repeatLocal, startNorm, endNorm);
-    const double clipNorm = clipSourceStart + clipSourceRange * sliceNorm;
-    const double warpedNorm = clip.warpCurve.evaluate(clipNorm);
-    const double samplePos = warpedNorm * (double)(clip.sample->getNumSamples() - 1);
-    return clip.sample->getSampleAt(channel, samplePos);
-}
-
-double Track::evaluateAutomation(const juce::Array<TrackAutomationPoint>& automation,
-                                 int64 samplePosition,
-                                 double defaultValue,
-                                 double minValue,
-                                 double maxValue) const
+    const double sliceNorm = juce::jmap(repeatLocal, slice.startNorm, slice.endNorm);
+    clipNorm = plan.sourceStartNorm + plan.sourceRangeNorm * sliceNorm;
+    return true;
+}
+
+int64 Track::getContiguousTrackSampleCount(int64 transportSample) const
 {
-    if (automation.isEmpty())
-        return juce::jlimit(minValue, maxValue, defaultValue);
+    if (transportSample < 0)
+        return 1;
 
-    if (samplePosition <= automation.getReference(0).samplePosition)
-        return juce::jlimit(minValue, maxValue, automation.getReference(0).value);
+    const int count = getLoopMarkerCount();
+    if (count == 0)
+        return std::numeric_limits<int64>::max();
+
+    if (count == 1)
+    {
+        const int idx = loopMarkerEnabled[0] ? 0 : 1;
+        const int64 loopEnd = juce::jmax<int64>(1, loopMarkerSamples[idx]);
+        return loopEnd - (transportSample % loopEnd);
+    }
+
+    const int64 loopLength = juce::jmax<int64>(1, std::abs(loopMarkerSamples[1] - loopMarkerSamples[0]));
+    return loopLength - (transportSample % loopLength);
+}
+
+void Track::ensureRenderScratchSize(int numChannels, int numSamples)
+{
+    auto& scratch = renderScratch;
+    scratch.bus.setSize(numChannels, numSamples, false, false, true);
+
+    const auto needed = (size_t)numSamples;
+    if (scratch.sourcePositions.size() < needed)
+    {
+        scratch.sourcePositions.resize(needed);
+        scratch.clipGains.resize(needed);
+        scratch.interpolated.resize(needed);
+        scratch.leftGains.resize(needed);
+        scratch.rightGains.resize(needed);
+        scratch.monoGains.resize(needed);
+    }
+
+    scratch.spans.reserve((size_t)clips.size());
+    scratch.entries.reserve((size_t)clips.size());
+    scratch.sampleRead.prepare(numSamples);
+}
+
+void Track::prepareToRender(int numChannels, int maximumBlockSize)
+{
+    ensurePlaybackStateSize();
+    ensureRenderScratchSize(juce::jmax(1, numChannels), juce::jmax(1, maximumBlockSize));
+}
+
+juce::Array<int> Track::findPlaybackStateSources(const Track& previous) const
+{
+    using SlicingKey = std::tuple<const Sample*, int64, int, int>;
+    const auto slicingKey = [](const TrackClip& clip)
+    {
+        return SlicingKey(clip.sample.get(), clip.startSample, (int)clip.slicing.mode, clip.slicing.slices.size());
+    };
+
+    juce::Array<int> sources;
+    sources.insertMultiple(0, -1, clips.size());
+    std::vector<bool> taken((size_t)previous.clips.size(), false);
 
-    for (int i = 1; i < automation.size(); ++i)
+    // Most edits leave the clip order alone, so clips still at the same index go first.
+    bool anyUnmatched = false;
+    for (int i = 0; i < clips.size(); ++i)
     {
-        const auto& a = automation.getReference(i - 1);
-        const auto& b = automation.getReference(i);
-        if (samplePosition <= b.samplePosition)
+        const auto& clip = clips.getReference(i);
+        if (!clip.slicing.enabled)
+            continue;
+        if (i < previous.clips.size() && previous.clips.getReference(i).slicing.enabled
+            && slicingKey(clip) == slicingKey(previous.clips.getReference(i)))
         {
-            const int64 span = juce::jmax<int64>(1, b.samplePosition - a.samplePosition);
-            const double t = (double)(samplePosition - a.samplePosition) / (double)span;
-            return juce::jlimit(minValue, maxValue, juce::jmap(t, a.value, b.value));
+            sources.set(i, i);
+            taken[(size_t)i] = true;
+        }
+        else
+        {
+            anyUnmatched = true;
         }
     }
+    if (!anyUnmatched)
+        return sources;
+
+    std::map<SlicingKey, std::vector<int>> candidates;
+    for (int j = previous.clips.size(); --j >= 0;)
+        if (!taken[(size_t)j] && previous.clips.getReference(j).slicing.enabled)
+            candidates[slicingKey(previous.clips.getReference(j))].push_back(j);
 
-    return juce::jlimit(minValue, maxValue, automation.getReference(automation.size() - 1).value);
+    for (int i = 0; i < clips.size(); ++i)
+    {
+        const auto& clip = clips.getReference(i);
+        if (!clip.slicing.enabled || sources[i] >= 0)
+            continue;
+        auto found = candidates.find(slicingKey(clip));
+        if (found == candidates.end() || found->second.empty())
+            continue;
+        // Listed backwards, so the earliest clip of previous is at the back.
+        sources.set(i, found->second.back());
+        found->second.pop_back();
+    }
+    return sources;
 }
 
-void Track::render(juce::AudioBuffer<float>& buffer, int64 bufferStartSample, double sampleRate)
+void Track::takePlaybackStateFrom(Track& previous, const juce::Array<int>& sources)
+{
+    ensurePlaybackStateSize();
+    previous.ensurePlaybackStateSize();
+    const int numClips = juce::jmin(clips.size(), sources.size());
+    for (int i = 0; i < numClips; ++i)
+    {
+        const int source = sources.getUnchecked(i);
+        if (source >= 0 && source < previous.playbackStates.size())
+            std::swap(playbackStates.getReference(i), previous.playbackStates.getReference(source));
+    }
+}
+
+void Track::render(juce::AudioBuffer<float>& buffer, int64 bufferStartSample, double)
 {
     if (muted)
         return;
@@ -362,98 +693,230 @@ void Track::render(juce::AudioBuffer<float>& buffer, int64 bufferStartSample, do
 
     const int numOutChannels = buffer.getNumChannels();
     const int numOutSamples = buffer.getNumSamples();
-    if (numOutSamples <= 0 || clips.isEmpty())
+    if (numOutSamples <= 0 || numOutChannels <= 0 || clips.isEmpty())
         return;
 
-    std::vector<char> wasInside((size_t)clips.size(), 0);
-    const int64 prevTrackSample = mapTransportSampleToTrackSample(juce::jmax<int64>(0, bufferStartSample - 1));
-    for (int ci = 0; ci < clips.size(); ++ci)
+    ensureRenderScratchSize(numOutChannels, numOutSamples);
+    renderScratch.sampleRead.blocking = blockingSampleReads;
+
+    // Split the block into runs where the track position advances one sample at a time,
+    // i.e. break only where a loop marker wraps playback.
+    int64 previousTrackSample = mapTransportSampleToTrackSample(juce::jmax<int64>(0, bufferStartSample - 1));
+    int outIndex = 0;
+    while (outIndex < numOutSamples)
     {
-        const auto& clip = clips.getReference(ci);
-        const int64 clipLenSamples = getClipPlaybackLengthSamples(clip, sampleRate);
-        const int64 clipEnd = clip.startSample + clipLenSamples;
-        wasInside[(size_t)ci] = (prevTrackSample >= clip.startSample && prevTrackSample < clipEnd) ? 1 : 0;
+        const int64 transportSample = bufferStartSample + outIndex;
+        const int64 runStartTrackSample = mapTransportSampleToTrackSample(transportSample);
+        const int runLength = (int)juce::jmin<int64>(numOutSamples - outIndex,
+                                                     getContiguousTrackSampleCount(transportSample));
+
+        renderRun(buffer, outIndex, runLength, runStartTrackSample, previousTrackSample);
+
+        previousTrackSample = runStartTrackSample + runLength - 1;
+        outIndex += runLength;
     }
+}
 
-    for (int outIndex = 0; outIndex < numOutSamples; ++outIndex)
+void Track::renderRun(juce::AudioBuffer<float>& buffer,
+                      int outOffset,
+                      int numSamples,
+                      int64 runStartTrackSample,
+                      int64 previousTrackSample)
+{
+    auto& scratch = renderScratch;
+    scratch.spans.clear();
+    scratch.entries.clear();
+
+    // Candidates start before the run ends; the running maximum end skips every earlier
+    // clip that finished before the run begins.
+    const int64 runEndTrackSample = runStartTrackSample + numSamples;
+    const auto firstCandidate = std::upper_bound(clipsByStartMaxEnd.begin(), clipsByStartMaxEnd.end(), runStartTrackSample)
+                                - clipsByStartMaxEnd.begin();
+    for (auto i = (size_t)firstCandidate; i < clipsByStart.size(); ++i)
     {
-        const int64 transportSample = bufferStartSample + outIndex;
-        const int64 trackSample = mapTransportSampleToTrackSample(transportSample);
-        const double volNow = evaluateAutomation(volumeAutomation, trackSample, volume, 0.0, 2.0);
-        const double panNow = evaluateAutomation(panAutomation, trackSample, pan, -1.0, 1.0);
-        const double panAngle = (panNow + 1.0) * juce::MathConstants<double>::pi * 0.25;
-        const float leftTrackGain = (float)(std::cos(panAngle) * volNow);
-        const float rightTrackGain = (float)(std::sin(panAngle) * volNow);
-
-        for (int clipIndex = 0; clipIndex < clips.size(); ++clipIndex)
+        const int clipIndex = clipsByStart[i];
+        const auto& plan = renderPlans.getReference(clipIndex);
+        if (plan.startSample >= runEndTrackSample)
+            break;
+
+        const int64 spanStart = juce::jmax(plan.startSample, runStartTrackSample);
+        const int64 spanEnd = juce::jmin(plan.endSample, runEndTrackSample);
+        if (spanStart >= spanEnd)
+            continue;
+
+        ClipSpan span;
+        span.clipIndex = clipIndex;
+        span.offset = (int)(spanStart - runStartTrackSample);
+        span.numSamples = (int)(spanEnd - spanStart);
+
+        // A clip that is already playing but has no plan yet (first block, or a freshly
+        // published edit) is treated as just entered.
+        const bool wasInside = span.offset == 0
+                               && previousTrackSample >= plan.startSample
+                               && previousTrackSample < plan.endSample
+                               && !playbackStates.getReference(clipIndex).segmentSliceOrder.isEmpty();
+        if (!wasInside && plan.sliced)
+            scratch.entries.push_back(span);
+
+        if (plan.hasAudio)
+            scratch.spans.push_back(span);
+    }
+
+    // Re-roll slice plans in playback order so random draws match sample-by-sample entry order.
+    std::sort(scratch.entries.begin(), scratch.entries.end(), [](const ClipSpan& a, const ClipSpan& b)
+    {
+        return a.offset != b.offset ? a.offset < b.offset : a.clipIndex < b.clipIndex;
+    });
+    for (const auto& entry : scratch.entries)
+        preparePlaybackPlan(entry.clipIndex);
+
+    if (scratch.spans.empty())
+        return;
+
+    const int numOutChannels = buffer.getNumChannels();
+    for (int ch = 0; ch < numOutChannels; ++ch)
+        juce::FloatVectorOperations::clear(scratch.bus.getWritePointer(ch), numSamples);
+
+    for (const auto& span : scratch.spans)
+        renderClipSpan(span, runStartTrackSample, numOutChannels);
+
+    renderTrackGains(runStartTrackSample, numSamples);
+
+    for (int ch = 0; ch < numOutChannels; ++ch)
+    {
+        const float* gains = scratch.monoGains.data();
+        if (numOutChannels >= 2 && ch == 0)
+            gains = scratch.leftGains.data();
+        else if (numOutChannels >= 2 && ch == 1)
+            gains = scratch.rightGains.data();
+
+        juce::FloatVectorOperations::addWithMultiply(buffer.getWritePointer(ch, outOffset),
+                                                     scratch.bus.getReadPointer(ch),
+                                                     gains,
+                                                     numSamples);
+    }
+}
+
+void Track::renderTrackGains(int64 runStartTrackSample, int numSamples)
+{
+    auto& scratch = renderScratch;
+    float* leftGains = scratch.leftGains.data();
+    float* rightGains = scratch.rightGains.data();
+    float* monoGains = scratch.monoGains.data();
+
+    auto panGains = [](double panValue, double& left, double& right)
+    {
+        const double panAngle = (juce::jlimit(-1.0, 1.0, panValue) + 1.0) * juce::MathConstants<double>::pi * 0.25;
+        left = std::cos(panAngle);
+        right = std::sin(panAngle);
+    };
+
+    // Walk the run one linear segment (of either lane) at a time.
+    const int64 runEndTrackSample = runStartTrackSample + numSamples;
+    int64 position = runStartTrackSample;
+    while (position < runEndTrackSample)
+    {
+        const int volSegment = seekAutomationSegment(volumeAutomation, position, scratch.volumeCursor);
+        const int panSegment = seekAutomationSegment(panAutomation, position, scratch.panCursor);
+        scratch.volumeCursor = volSegment;
+        scratch.panCursor = panSegment;
+
+        const int64 segmentEnd = juce::jmin(runEndTrackSample,
+                                            getAutomationSegmentEnd(volumeAutomation, volSegment),
+                                            getAutomationSegmentEnd(panAutomation, panSegment));
+
+        const double volStart = getAutomationValue(volumeAutomation, volSegment, position, volume, 0.0, 2.0);
+        const double volStep = isAutomationSegmentRamp(volumeAutomation, volSegment)
+                                   ? getAutomationValue(volumeAutomation, volSegment, position + 1, volume, 0.0, 2.0) - volStart
+                                   : 0.0;
+        const bool panRamps = isAutomationSegmentRamp(panAutomation, panSegment);
+        const int stepSamples = panRamps ? panRampStepSamples : (int)(segmentEnd - position);
+
+        double left = 0.0, right = 0.0;
+        panGains(getAutomationValue(panAutomation, panSegment, position, pan, -1.0, 1.0), left, right);
+
+        int64 stepStart = position;
+        while (stepStart < segmentEnd)
         {
-            const auto& clip = clips.getReference(clipIndex);
-            if (clip.muted || clip.sample == nullptr || clip.lengthSamples <= 0)
+            const int stepLength = (int)juce::jmin<int64>(stepSamples, segmentEnd - stepStart);
+            double nextLeft = left, nextRight = right;
+            if (panRamps)
+                panGains(getAutomationValue(panAutomation, panSegment, stepStart + stepLength, pan, -1.0, 1.0), nextLeft, nextRight);
+
+            const double leftStep = (nextLeft - left) / (double)stepLength;
+            const double rightStep = (nextRight - right) / (double)stepLength;
+            const int offset = (int)(stepStart - runStartTrackSample);
+            for (int i = 0; i < stepLength; ++i)
             {
-                wasInside[(size_t)clipIndex] = 0;
-                continue;
+                const double volNow = volStart + volStep * (double)(stepStart + i - position);
+                monoGains[offset + i] = (float)volNow;
+                leftGains[offset + i] = (float)((left + leftStep * (double)i) * volNow);
+                rightGains[offset + i] = (float)((right + rightStep * (double)i) * volNow);
             }
 
-            const int64 clipLenSamples = getClipPlaybackLengthSamples(clip, sampleRate);
+            left = nextLeft;
+            right = nextRight;
+            stepStart += stepLength;
+        }
 
-            const int64 clipEnd = clip.startSample + clipLenSamples;
-            const bool inside = (trackSample >= clip.startSample && trackSample < clipEnd);
-            if (inside && !wasInside[(size_t)clipIndex] && clip.slicing.enabled && !clip.slicing.slices.isEmpty())
-                preparePlaybackPlan(clipIndex);
+        position = segmentEnd;
+    }
+}
 
-            if (!inside)
-            {
-                wasInside[(size_t)clipIndex] = 0;
-                continue;
-            }
+void Track::renderClipSpan(const ClipSpan& span, int64 runStartTrackSample, int numBusChannels)
+{
+    auto& scratch = renderScratch;
+    const auto& clip = clips.getReference(span.clipIndex);
+    const auto& plan = renderPlans.getReference(span.clipIndex);
+    const auto& playbackState = playbackStates.getReference(span.clipIndex);
+
+    const auto& warpLookup = *plan.warpLookup;
+    double* positions = scratch.sourcePositions.data();
+    float* clipGains = scratch.clipGains.data();
+    const int64 firstLocalSample = runStartTrackSample + span.offset - plan.startSample;
+    for (int i = 0; i < span.numSamples; ++i)
+    {
+        const double local = (double)(firstLocalSample + i) / plan.lengthSamples;
 
-            const int sampleCount = clip.sample->getNumSamples();
-            const int sampleChannels = clip.sample->getNumChannels();
-            if (sampleCount <= 0 || sampleChannels <= 0)
+        double clipNorm = 0.0;
+        if (plan.sliced)
+        {
+            if (!getSlicedSourceNorm(plan, playbackState, local, clipNorm))
             {
-                wasInside[(size_t)clipIndex] = 1;
+                positions[i] = 0.0;
+                clipGains[i] = 0.0f;
                 continue;
             }
+        }
+        else
+        {
+            clipNorm = plan.sourceStartNorm + (plan.sourceEndNorm - plan.sourceStartNorm) * local;
+        }
 
-            const double local = (double)(trackSample - clip.startSample) / (double)clipLenSamples;
-            const auto& playbackState = playbackStates.getReference(clipIndex);
+        positions[i] = WarpCurve::evaluateLookup(warpLookup, clipNorm) * plan.lastSourceSample;
 
-            for (int ch = 0; ch < numOutChannels; ++ch)
-            {
-                const int sampleChannel = juce::jmin(ch, sampleChannels - 1);
-                float s = 0.0f;
-                if (clip.slicing.enabled && !clip.slicing.slices.isEmpty())
-                {
-                    s = renderSlicedSample(clip, playbackState, local, sampleChannel);
-                }
-                else
-                {
-                    const double clipSourceStart = juce::jlimit(0.0, 1.0, (double)clip.sourceStartNorm);
-                    const double clipSourceEnd = juce::jlimit(clipSourceStart, 1.0, (double)clip.sourceEndNorm);
-                    const double clipNorm = juce::jmap(local, clipSourceStart, clipSourceEnd);
-                    const double inputNorm = clip.warpCurve.evaluate(clipNorm);
-                    const double inputPos = inputNorm * (double)(sampleCount - 1);
-                    s = clip.sample->getSampleAt(sampleChannel, inputPos);
-                }
-
-                float trackGain = 1.0f;
-                if (numOutChannels >= 2)
-                    trackGain = (ch == 0 ? leftTrackGain : (ch == 1 ? rightTrackGain : (float)volNow));
-                else
-                    trackGain = (float)volNow;
-
-                const float fadeIn = juce::jlimit(0.0f, 0.98f, clip.fadeInNorm);
-                const float fadeOut = juce::jlimit(0.0f, 0.98f - fadeIn, clip.fadeOutNorm);
-                float fadeGain = 1.0f;
-                if (fadeIn > 0.0f)
-                    fadeGain = juce::jmin(fadeGain, (float)juce::jlimit(0.0, 1.0, local / (double)fadeIn));
-                if (fadeOut > 0.0f)
-                    fadeGain = juce::jmin(fadeGain, (float)juce::jlimit(0.0, 1.0, (1.0 - local) / (double)fadeOut));
-
-                buffer.addSample(ch, outIndex, s * clip.gain * fadeGain * trackGain);
-            }
+        float fadeGain = 1.0f;
+        if (plan.fadeInScale > 0.0)
+            fadeGain = juce::jmin(fadeGain, (float)juce::jlimit(0.0, 1.0, local * plan.fadeInScale));
+        if (plan.fadeOutScale > 0.0)
+            fadeGain = juce::jmin(fadeGain, (float)juce::jlimit(0.0, 1.0, (1.0 - local) * plan.fadeOutScale));
+        clipGains[i] = plan.gain * fadeGain;
+    }
 
-            wasInside[(size_t)clipIndex] = 1;
+    float* interpolated = scratch.interpolated.data();
+    int interpolatedChannel = -1;
+    for (int ch = 0; ch < numBusChannels; ++ch)
+    {
+        const int sampleChannel = juce::jmin(ch, plan.lastSourceChannel);
+        if (sampleChannel != interpolatedChannel)
+        {
+            clip.sample->getSamples(sampleChannel, positions, interpolated, span.numSamples, interpolation, &scratch.sampleRead);
+            interpolatedChannel = sampleChannel;
         }
+
+        juce::FloatVectorOperations::addWithMultiply(scratch.bus.getWritePointer(ch, span.offset),
+                                                     interpolated,
+                                                     clipGains,
+                                                     span.numSamples);
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <vector>
 #include "Sample.h"
 #include "WarpCurve.h"
 
@@ -37,7 +38,7 @@ struct TrackClip
 {
     juce::String name;
     juce::String sourceFilePath;
-    std::shared_ptr<Sample> sample;
+    std::shared_ptr<const Sample> sample;
     WarpCurve warpCurve;
     BeatSlicingSettings slicing;
     int64 startSample = 0;      // timeline sample offset
@@ -69,6 +70,8 @@ public:
     Track(const juce::String& nameIn) : name(nameIn) {}
 
     void addClip(const TrackClip& clip);
+    // Replaces every clip at once, rebuilding the playback state a single time.
+    void setClips(const juce::Array<TrackClip>& newClips);
     void updateClip(int index, const TrackClip& clip);
     void clear();
 
@@ -113,6 +116,29 @@ public:
     int64 mapTransportSampleToTrackSample(int64 transportSample) const;
     int64 getClipPlaybackLengthSamples(const TrackClip& clip, double sampleRate) const;
 
+    // True when both tracks hold the same saved state and clip audio; playback and render
+    // state are ignored.
+    bool hasSameContent(const Track& other) const;
+    // Rough size of the track and its clips, not counting the clips' audio.
+    int64 getMemoryUsageBytes() const;
+
+    // Resampling quality used by render(). A render setting, not saved with the project.
+    void setInterpolation(Sample::Interpolation newInterpolation) { interpolation = newInterpolation; }
+    Sample::Interpolation getInterpolation() const { return interpolation; }
+    // Offline renders wait for streamed sample audio; real-time renders read silence instead.
+    void setBlockingSampleReads(bool shouldBlock) { blockingSampleReads = shouldBlock; }
+
+    void prepareToRender(int numChannels, int maximumBlockSize);
+    // For each clip, the index of the sliced clip in previous whose slice order and
+    // probability rolls it should keep, or -1. Clips match when they play the same audio
+    // from the same start with the same slicing layout, and each clip of previous is
+    // matched at most once. Called on the message thread when a snapshot is published.
+    juce::Array<int> findPlaybackStateSources(const Track& previous) const;
+    // Takes over the playback state of the clips of previous named by sources, as found by
+    // findPlaybackStateSources(), so republishing an edit does not re-roll sliced clips
+    // mid-bar. The states are swapped, not copied, so this does not allocate on the audio
+    // thread.
+    void takePlaybackStateFrom(Track& previous, const juce::Array<int>& sources);
     void render(juce::AudioBuffer<float>& buffer, int64 bufferStartSample, double sampleRate);
 
     bool muted = false;
@@ -126,18 +152,82 @@ private:
         juce::Array<juce::Array<bool>> repeatActive;
     };
 
+    struct SliceWindow
+    {
+        double startNorm = 0.0;
+        double endNorm = 1.0;
+        int repeats = 1;
+    };
+
+    // Everything render() needs from a clip, resolved once whenever the clip is edited.
+    struct ClipRenderPlan
+    {
+        bool active = false;        // unmuted, has a sample and a timeline length
+        bool hasAudio = false;      // sample has frames and channels to read
+        bool sliced = false;
+        int64 startSample = 0;
+        int64 endSample = 0;
+        double lengthSamples = 1.0;
+        double sourceStartNorm = 0.0;
+        double sourceEndNorm = 1.0;
+        double sourceRangeNorm = 1.0;
+        juce::Array<SliceWindow> slices;
+        double fadeInScale = 0.0;   // 1 / fade length in local clip units, 0 when disabled
+        double fadeOutScale = 0.0;
+        float gain = 1.0f;
+        std::shared_ptr<const WarpCurve::LookupTable> warpLookup;
+        int lastSourceChannel = 0;  // output channels beyond this reuse it
+        double lastSourceSample = 0.0;
+    };
+
+    struct ClipSpan
+    {
+        int clipIndex = 0;
+        int offset = 0;     // first sample of the run covered by the clip
+        int numSamples = 0;
+    };
+
+    // Per-track working memory for render(); grown on demand and reused between blocks.
+    struct RenderScratch
+    {
+        juce::AudioBuffer<float> bus;
+        std::vector<double> sourcePositions;
+        std::vector<float> clipGains;
+        std::vector<float> interpolated;
+        std::vector<float> leftGains;
+        std::vector<float> rightGains;
+        std::vector<float> monoGains;
+        std::vector<ClipSpan> spans;
+        std::vector<ClipSpan> entries;
+        Sample::ReadContext sampleRead;
+        int volumeCursor = 0;   // automation segment used by the previous run
+        int panCursor = 0;
+    };
+
     void ensurePlaybackStateSize();
+    void rebuildRenderPlan(int clipIndex);
+    void rebuildClipIndex();
+    void ensureRenderScratchSize(int numChannels, int numSamples);
     void preparePlaybackPlan(int clipIndex);
-    float renderSlicedSample(const TrackClip& clip, const ClipPlaybackState& state, double localNorm, int channel) const;
-    double evaluateAutomation(const juce::Array<TrackAutomationPoint>& automation,
-                              int64 samplePosition,
-                              double defaultValue,
-                              double minValue,
-                              double maxValue) const;
+    int64 getContiguousTrackSampleCount(int64 transportSample) const;
+    void renderRun(juce::AudioBuffer<float>& buffer,
+                   int outOffset,
+                   int numSamples,
+                   int64 runStartTrackSample,
+                   int64 previousTrackSample);
+    void renderClipSpan(const ClipSpan& span, int64 runStartTrackSample, int numBusChannels);
+    bool getSlicedSourceNorm(const ClipRenderPlan& plan, const ClipPlaybackState& state, double localNorm, double& clipNorm) const;
+    void renderTrackGains(int64 runStartTrackSample, int numSamples);
 
     juce::String name;
     juce::Array<TrackClip> clips;
     juce::Array<ClipPlaybackState> playbackStates;
+    juce::Array<ClipRenderPlan> renderPlans;
+    std::vector<int> clipsByStart;          // active clips ordered by start sample
+    std::vector<int64> clipsByStartMaxEnd;  // running maximum of end sample over clipsByStart
+    RenderScratch renderScratch;
+    Sample::Interpolation interpolation = Sample::Interpolation::linear;
+    bool blockingSampleReads = false;
     mutable juce::Random random;
     double tempoBpm = 120.0;
     int timeSigNumerator = 4;
@@ -0,0 +1,245 @@
+#include "UndoHistory.h"
+#include <algorithm>
+
+namespace
+{
+bool sameSettings(const ProjectSettings& a, const ProjectSettings& b)
+{
+    return a.sampleRate == b.sampleRate
+        && a.exportBitDepth == b.exportBitDepth
+        && a.sampleEncoding == b.sampleEncoding
+        && a.selectedTrackIndex == b.selectedTrackIndex
+        && a.selectedClipIndex == b.selectedClipIndex
+        && a.playheadSample == b.playheadSample;
+}
+}
+
+UndoHistory::UndoHistory(int64 memoryBudgetBytesIn)
+    : memoryBudgetBytes(juce::jmax<int64>(0, memoryBudgetBytesIn))
+{
+}
+
+UndoHistory::~UndoHistory()
+{
+    clear();
+}
+
+void UndoHistory::push(const ProjectSettings& settings, const juce::Array<Track>& tracks)
+{
+    if (!undoStates.empty() && isSameState(undoStates.back(), settings, tracks))
+        return;
+
+    for (const auto& state : redoStates)
+        release(state);
+    redoStates.clear();
+
+    undoStates.push_back(makeState(settings, tracks, undoStates.empty() ? nullptr : &undoStates.back()));
+    retain(undoStates.back());
+    trimToBudget(tracks);
+}
+
+bool UndoHistory::undo(const ProjectSettings& currentSettings, const juce::Array<Track>& currentTracks, State& restored)
+{
+    if (undoStates.empty())
+        return false;
+
+    restored = std::move(undoStates.back());
+    undoStates.pop_back();
+
+    redoStates.push_back(makeState(currentSettings, currentTracks, &restored));
+    retain(redoStates.back());
+    release(restored);
+    return true;
+}
+
+bool UndoHistory::redo(const ProjectSettings& currentSettings, const juce::Array<Track>& currentTracks, State& restored)
+{
+    if (redoStates.empty())
+        return false;
+
+    restored = std::move(redoStates.back());
+    redoStates.pop_back();
+
+    undoStates.push_back(makeState(currentSettings, currentTracks, &restored));
+    retain(undoStates.back());
+    release(restored);
+    return true;
+}
+
+void UndoHistory::clear()
+{
+    undoStates.clear();
+    redoStates.clear();
+    trackEntries.clear();
+    sampleEntries.clear();
+    trackBytes = 0;
+}
+
+void UndoHistory::replaceSamples(const std::map<const Sample*, std::shared_ptr<const Sample>>& replacements)
+{
+    if (replacements.empty())
+        return;
+
+    for (const auto& state : undoStates)
+        release(state);
+    for (const auto& state : redoStates)
+        release(state);
+
+    // A track shared by several steps is replaced once, so they go on sharing it.
+    std::map<std::shared_ptr<const Track>, std::shared_ptr<const Track>> replacedTracks;
+    const auto replaceTracks = [&](State& state)
+    {
+        for (auto& track : state.tracks)
+        {
+            auto found = replacedTracks.find(track);
+            if (found == replacedTracks.end())
+            {
+                std::shared_ptr<Track> copy;
+                const auto& clips = track->getClips();
+                for (int c = 0; c < clips.size(); ++c)
+                {
+                    const auto sample = replacements.find(clips.getReference(c).sample.get());
+                    if (sample == replacements.end())
+                        continue;
+
+                    if (copy == nullptr)
+                        copy = std::make_shared<Track>(*track);
+                    auto clip = clips.getReference(c);
+                    clip.sample = sample->second;
+                    copy->updateClip(c, clip);
+                }
+                found = replacedTracks.emplace(track, copy != nullptr ? std::shared_ptr<const Track>(std::move(copy)) : track).first;
+            }
+            track = found->second;
+        }
+    };
+
+    for (auto& state : undoStates)
+        replaceTracks(state);
+    for (auto& state : redoStates)
+        replaceTracks(state);
+
+    for (const auto& state : undoStates)
+        retain(state);
+    for (const auto& state : redoStates)
+        retain(state);
+}
+
+void UndoHistory::setMemoryBudgetBytes(int64 newBudget)
+{
+    memoryBudgetBytes = juce::jmax<int64>(0, newBudget);
+}
+
+int64 UndoHistory::getMemoryUsageBytes(const juce::Array<Track>& currentTracks) const
+{
+    return getMemoryUsageBytes(getSamplesInUse(currentTracks));
+}
+
+std::set<const Sample*> UndoHistory::getSamplesInUse(const juce::Array<Track>& tracks)
+{
+    std::set<const Sample*> inUse;
+    for (const auto& track : tracks)
+        for (const auto& clip : track.getClips())
+            inUse.insert(clip.sample.get());
+    return inUse;
+}
+
+int64 UndoHistory::getMemoryUsageBytes(const std::set<const Sample*>& samplesInUse) const
+{
+    int64 bytes = trackBytes;
+    for (const auto& entry : sampleEntries)
+        if (samplesInUse.count(entry.first) == 0)
+            bytes += entry.second.bytes;
+    return bytes;
+}
+
+UndoHistory::State UndoHistory::makeState(const ProjectSettings& settings, const juce::Array<Track>& tracks, const State* neighbour) const
+{
+    State state;
+    state.settings = settings;
+    state.tracks.reserve((size_t)tracks.size());
+
+    const int numNeighbourTracks = neighbour != nullptr ? (int)neighbour->tracks.size() : 0;
+    for (int i = 0; i < tracks.size(); ++i)
+    {
+        const auto& track = tracks.getReference(i);
+        std::shared_ptr<const Track> shared;
+
+        // Tracks usually keep their place, so the same index is tried before the others.
+        for (int n = 0; n < numNeighbourTracks && shared == nullptr; ++n)
+        {
+            const int candidate = (i + n) % numNeighbourTracks;
+            if (neighbour->tracks[(size_t)candidate]->hasSameContent(track))
+                shared = neighbour->tracks[(size_t)candidate];
+        }
+
+        state.tracks.push_back(shared != nullptr ? std::move(shared) : std::make_shared<const Track>(track));
+    }
+    return state;
+}
+
+bool UndoHistory::isSameState(const State& state, const ProjectSettings& settings, const juce::Array<Track>& tracks)
+{
+    if (!sameSettings(state.settings, settings) || (int)state.tracks.size() != tracks.size())
+        return false;
+
+    for (int i = 0; i < tracks.size(); ++i)
+        if (!state.tracks[(size_t)i]->hasSameContent(tracks.getReference(i)))
+            return false;
+    return true;
+}
+
+void UndoHistory::retain(const State& state)
+{
+    for (const auto& track : state.tracks)
+    {
+        auto& entry = trackEntries[track.get()];
+        if (entry.refs++ > 0)
+            continue;
+
+        entry.bytes = track->getMemoryUsageBytes();
+        trackBytes += entry.bytes;
+        for (const auto& clip : track->getClips())
+        {
+            const auto* sample = clip.sample.get();
+            if (sample == nullptr || std::find(entry.samples.begin(), entry.samples.end(), sample) != entry.samples.end())
+                continue;
+
+            entry.samples.push_back(sample);
+            auto& sampleEntry = sampleEntries[sample];
+            if (sampleEntry.refs++ == 0)
+                sampleEntry.bytes = sample->getMemoryUsageBytes();
+        }
+    }
+}
+
+void UndoHistory::release(const State& state)
+{
+    for (const auto& track : state.tracks)
+    {
+        const auto found = trackEntries.find(track.get());
+        if (found == trackEntries.end() || --found->second.refs > 0)
+            continue;
+
+        trackBytes -= found->second.bytes;
+        for (const auto* sample : found->second.samples)
+        {
+            const auto sampleFound = sampleEntries.find(sample);
+            if (sampleFound != sampleEntries.end() && --sampleFound->second.refs == 0)
+                sampleEntries.erase(sampleFound);
+        }
+        trackEntries.erase(found);
+    }
+}
+
+void UndoHistory::trimToBudget(const juce::Array<Track>& currentTracks)
+{
+    // Only called right after a push, when there is nothing to redo. The most recent undo
+    // step is always kept, however large.
+    const auto samplesInUse = getSamplesInUse(currentTracks);
+    while (undoStates.size() > 1 && getMemoryUsageBytes(samplesInUse) > memoryBudgetBytes)
+    {
+        release(undoStates.front());
+        undoStates.pop_front();
+    }
+}
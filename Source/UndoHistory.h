@@ -0,0 +1,85 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include "ProjectFile.h"
+
+// Undo and redo steps kept as immutable copies of the project. Each step holds its tracks
+// through shared pointers, and a track that did not change since the neighbouring step is
+// shared with it rather than copied, so an edit to one track costs a copy of that track
+// only. Clips keep their decoded audio, so stepping back and forth never touches the disk.
+//
+// Steps are not limited in number; the oldest ones are dropped once the history uses more
+// than its memory budget. Audio counts towards the budget only while no clip in the
+// current project plays it.
+class UndoHistory
+{
+public:
+    struct State
+    {
+        ProjectSettings settings;
+        std::vector<std::shared_ptr<const Track>> tracks;
+    };
+
+    explicit UndoHistory(int64 memoryBudgetBytesIn = 128 * 1024 * 1024);
+    ~UndoHistory();
+
+    // Records the project as it is before an edit and forgets every redo step. Does nothing
+    // when the project has not changed since the last recorded step.
+    void push(const ProjectSettings& settings, const juce::Array<Track>& tracks);
+
+    // Moves one step back or forward. The current project is kept for the opposite
+    // direction, and the state to apply is written to restored.
+    bool undo(const ProjectSettings& currentSettings, const juce::Array<Track>& currentTracks, State& restored);
+    bool redo(const ProjectSettings& currentSettings, const juce::Array<Track>& currentTracks, State& restored);
+
+    bool canUndo() const { return !undoStates.empty(); }
+    bool canRedo() const { return !redoStates.empty(); }
+    int getNumUndoSteps() const { return (int)undoStates.size(); }
+    int getNumRedoSteps() const { return (int)redoStates.size(); }
+
+    void clear();
+    // Points every clip in the history that plays one of the keys at its value instead, so
+    // audio the project has replaced (re-encoded or converted) is not kept alive by undo.
+    void replaceSamples(const std::map<const Sample*, std::shared_ptr<const Sample>>& replacements);
+
+    void setMemoryBudgetBytes(int64 newBudget);
+    int64 getMemoryBudgetBytes() const { return memoryBudgetBytes; }
+    // Memory held by the history beyond what the given project uses itself.
+    int64 getMemoryUsageBytes(const juce::Array<Track>& currentTracks) const;
+
+private:
+    struct TrackEntry
+    {
+        int refs = 0;
+        int64 bytes = 0;
+        std::vector<const Sample*> samples; // distinct clip audio of the track
+    };
+
+    struct SampleEntry
+    {
+        int refs = 0;
+        int64 bytes = 0;
+    };
+
+    State makeState(const ProjectSettings& settings, const juce::Array<Track>& tracks, const State* neighbour) const;
+    static std::set<const Sample*> getSamplesInUse(const juce::Array<Track>& tracks);
+    int64 getMemoryUsageBytes(const std::set<const Sample*>& samplesInUse) const;
+    static bool isSameState(const State& state, const ProjectSettings& settings, const juce::Array<Track>& tracks);
+    void retain(const State& state);
+    void release(const State& state);
+    void trimToBudget(const juce::Array<Track>& currentTracks);
+
+    std::deque<State> undoStates; // oldest first
+    std::deque<State> redoStates; // most recent undo last
+    std::map<const Track*, TrackEntry> trackEntries;
+    std::map<const Sample*, SampleEntry> sampleEntries;
+    int64 trackBytes = 0;
+    int64 memoryBudgetBytes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UndoHistory)
+};
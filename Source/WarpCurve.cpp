@@ -6,6 +6,7 @@ WarpCurve::WarpCurve()
 {
     points.add({0.0, 0.5});
     points.add({1.0, 0.5});
+    rebuildLookup();
 }
 
 void WarpCurve::setPoints(const juce::Array<Point>& newPoints)
@@ -15,7 +16,7 @@ void WarpCurve::setPoints(const juce::Array<Point>& newPoints)
     {
         points.add({0.0, 0.5});
         points.add({1.0, 0.5});
-        markDirty();
+        rebuildLookup();
         return;
     }
 
@@ -37,7 +38,7 @@ void WarpCurve::setPoints(const juce::Array<Point>& newPoints)
 
     points.getReference(0).t = 0.0;
     points.getReference(points.size() - 1).t = 1.0;
-    markDirty();
+    rebuildLookup();
 }
 
 void WarpCurve::setRelativeMode(bool enabled)
@@ -45,7 +46,7 @@ void WarpCurve::setRelativeMode(bool enabled)
     if (relativeMode == enabled)
         return;
     relativeMode = enabled;
-    markDirty();
+    rebuildLookup();
 }
 
 void WarpCurve::setSmoothRateChanges(bool enabled)
@@ -53,7 +54,7 @@ void WarpCurve::setSmoothRateChanges(bool enabled)
     if (smoothRateChanges == enabled)
         return;
     smoothRateChanges = enabled;
-    markDirty();
+    rebuildLookup();
 }
 
 double WarpCurve::evaluatePoints(const juce::Array<Point>& pointsIn, double t, bool smoothSegments)
@@ -87,51 +88,58 @@ double WarpCurve::pointValueToRate(double v)
     return 0.5 + vv;
 }
 
-void WarpCurve::markDirty()
+void WarpCurve::rebuildLookup()
 {
-    lookupDirty = true;
+    // Most clips keep the flat default curve, so its table is built once and shared. This
+    // keeps creating and loading clips cheap.
+    const bool isDefaultCurve = relativeMode && !smoothRateChanges && points.size() == 2
+                                && points.getReference(0).t == 0.0 && points.getReference(0).v == 0.5
+                                && points.getReference(1).t == 1.0 && points.getReference(1).v == 0.5;
+    if (isDefaultCurve)
+    {
+        static const auto defaultLookup = buildLookup(points, relativeMode, smoothRateChanges);
+        lookup = defaultLookup;
+        return;
+    }
+
+    lookup = buildLookup(points, relativeMode, smoothRateChanges);
 }
 
-void WarpCurve::rebuildLookupIfNeeded() const
+std::shared_ptr<const WarpCurve::LookupTable> WarpCurve::buildLookup(const juce::Array<Point>& pointsIn, bool relative, bool smooth)
 {
-    if (!lookupDirty)
-        return;
-
-    lookup.clear();
     constexpr int tableSize = 1025;
-    lookup.resize(tableSize);
+    auto table = std::make_shared<LookupTable>();
+    table->resize(tableSize);
 
-    if (points.isEmpty())
+    if (pointsIn.isEmpty())
     {
         for (int i = 0; i < tableSize; ++i)
-            lookup.set(i, (double)i / (double)(tableSize - 1));
-        lookupDirty = false;
-        return;
+            table->set(i, (double)i / (double)(tableSize - 1));
+        return table;
     }
 
-    if (!relativeMode)
+    if (!relative)
     {
         for (int i = 0; i < tableSize; ++i)
         {
             const double t = (double)i / (double)(tableSize - 1);
-            lookup.set(i, juce::jlimit(0.0, 1.0, evaluatePoints(points, t, false)));
+            table->set(i, juce::jlimit(0.0, 1.0, evaluatePoints(pointsIn, t, false)));
         }
-        lookup.set(0, 0.0);
-        lookup.set(tableSize - 1, 1.0);
-        lookupDirty = false;
-        return;
+        table->set(0, 0.0);
+        table->set(tableSize - 1, 1.0);
+        return table;
     }
 
     juce::Array<double> cumulative;
     cumulative.resize(tableSize);
     cumulative.set(0, 0.0);
 
-    double lastRate = pointValueToRate(evaluatePoints(points, 0.0, smoothRateChanges));
+    double lastRate = pointValueToRate(evaluatePoints(pointsIn, 0.0, smooth));
     double sum = 0.0;
     for (int i = 1; i < tableSize; ++i)
     {
         const double t = (double)i / (double)(tableSize - 1);
-        const double rate = pointValueToRate(evaluatePoints(points, t, smoothRateChanges));
+        const double rate = pointValueToRate(evaluatePoints(pointsIn, t, smooth));
         sum += 0.5 * (lastRate + rate);
         cumulative.set(i, sum);
         lastRate = rate;
@@ -139,25 +147,24 @@ void WarpCurve::rebuildLookupIfNeeded() const
 
     const double total = juce::jmax(0.000001, cumulative.getLast());
     for (int i = 0; i < tableSize; ++i)
-        lookup.set(i, juce::jlimit(0.0, 1.0, cumulative.getReference(i) / total));
+        table->set(i, juce::jlimit(0.0, 1.0, cumulative.getReference(i) / total));
 
-    lookup.set(0, 0.0);
-    lookup.set(tableSize - 1, 1.0);
-    lookupDirty = false;
+    table->set(0, 0.0);
+    table->set(tableSize - 1, 1.0);
+    return table;
 }
 
-double WarpCurve::evaluate(double t) const
+double WarpCurve::evaluateLookup(const LookupTable& table, double t)
 {
-    rebuildLookupIfNeeded();
-    if (lookup.isEmpty())
+    if (table.size() < 2)
         return juce::jlimit(0.0, 1.0, t);
 
     const double tt = juce::jlimit(0.0, 1.0, t);
-    const double pos = tt * (double)(lookup.size() - 1);
-    const int idx = juce::jlimit(0, lookup.size() - 2, (int)std::floor(pos));
+    const double pos = tt * (double)(table.size() - 1);
+    const int idx = juce::jlimit(0, table.size() - 2, (int)std::floor(pos));
     const double frac = pos - (double)idx;
-    const double a = lookup.getReference(idx);
-    const double b = lookup.getReference(idx + 1);
+    const double a = table.getReference(idx);
+    const double b = table.getReference(idx + 1);
     return juce::jmap(frac, a, b);
 }
 
@@ -11,6 +11,10 @@ public:
         double v = 0.0;  // input time  [0..1]
     };
 
+    // Output time -> input time table, rebuilt eagerly on every change and never modified
+    // afterwards, so copies share it and any thread may read it without locking.
+    using LookupTable = juce::Array<double>;
+
     WarpCurve();
 
     void setPoints(const juce::Array<Point>& newPoints);
@@ -21,21 +25,22 @@ public:
     void setSmoothRateChanges(bool enabled);
     bool getSmoothRateChanges() const { return smoothRateChanges; }
 
-    double evaluate(double t) const;
+    double evaluate(double t) const { return evaluateLookup(*lookup, t); }
+    std::shared_ptr<const LookupTable> getLookupTable() const { return lookup; }
+    static double evaluateLookup(const LookupTable& table, double t);
 
     static WarpCurve linear();
     static WarpCurve slowToFast();
     static WarpCurve fastToSlow();
 
 private:
-    void markDirty();
-    void rebuildLookupIfNeeded() const;
+    void rebuildLookup();
+    static std::shared_ptr<const LookupTable> buildLookup(const juce::Array<Point>& pointsIn, bool relative, bool smooth);
     static double evaluatePoints(const juce::Array<Point>& pointsIn, double t, bool smoothSegments);
     static double pointValueToRate(double v);
 
     juce::Array<Point> points;
     bool relativeMode = true;
     bool smoothRateChanges = false;
-    mutable bool lookupDirty = true;
-    mutable juce::Array<double> lookup;
+    std::shared_ptr<const LookupTable> lookup;
 };
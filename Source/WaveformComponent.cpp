@@ -1,6 +1,6 @@
 #include "WaveformComponent.h"
 
-void WaveformComponent::setSample(const std::shared_ptr<Sample>& sampleIn)
+void WaveformComponent::setSample(const std::shared_ptr<const Sample>& sampleIn)
 {
     sample = sampleIn;
     repaint();
@@ -14,17 +14,15 @@ void WaveformComponent::paint(juce::Graphics& g)
     if (sample == nullptr || sample->getNumSamples() == 0)
         return;
 
-    const int numSamples = sample->getNumSamples();
-    const int width = getWidth();
+    const int width = juce::jmax(1, getWidth());
     const int height = getHeight();
-    const int mid = height / 2;
+    const float mid = (float)(height / 2);
+    const float radius = (float)(height / 2 - 4);
+    const double samplesPerPixel = (double)sample->getNumSamples() / (double)width;
 
     for (int x = 0; x < width; ++x)
     {
-        const double t = (double)x / (double)(width - 1);
-        const double samplePos = t * (double)(numSamples - 1);
-        const float s = sample->getSampleAt(0, samplePos);
-        const int y = (int)(s * (float)(mid - 4));
-        g.drawLine((float)x, (float)(mid - y), (float)x, (float)(mid + y));
+        const auto peak = sample->getPeak(0, (double)x * samplesPerPixel, (double)(x + 1) * samplesPerPixel);
+        g.drawLine((float)x, mid - peak.max * radius, (float)x, mid - peak.min * radius);
     }
 }
@@ -6,9 +6,9 @@
 class WaveformComponent : public juce::Component
 {
 public:
-    void setSample(const std::shared_ptr<Sample>& sampleIn);
+    void setSample(const std::shared_ptr<const Sample>& sampleIn);
     void paint(juce::Graphics& g) override;
 
 private:
-    std::shared_ptr<Sample> sample;
+    std::shared_ptr<const Sample> sample;
 };
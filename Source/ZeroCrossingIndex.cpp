@@ -0,0 +1,135 @@
+#include "ZeroCrossingIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr int readBlockSamples = 1 << 16;
+
+// A frame that is exactly zero counts once, as the frame the signal reaches.
+bool crossesZero(float previous, float current)
+{
+    return (previous < 0.0f && current >= 0.0f) || (previous > 0.0f && current <= 0.0f);
+}
+
+// Of the two frames either side of a crossing, the one closer to zero.
+int64 nearerFrame(int64 position, float previous, float current)
+{
+    return std::abs(previous) < std::abs(current) ? position - 1 : position;
+}
+
+void readMono(int numChannels, int64 start, int count, const SamplePeaks::ReadFunction& read,
+              std::vector<float>& mono, std::vector<float>& frames)
+{
+    read(0, start, count, mono.data());
+    for (int ch = 1; ch < numChannels; ++ch)
+    {
+        read(ch, start, count, frames.data());
+        juce::FloatVectorOperations::add(mono.data(), frames.data(), count);
+    }
+}
+}
+
+std::unique_ptr<ZeroCrossingIndex> ZeroCrossingIndex::build(int numChannels, int64 numSamples, const SamplePeaks::ReadFunction& read)
+{
+    if (numChannels <= 0 || numSamples <= 0)
+        return nullptr;
+
+    std::unique_ptr<ZeroCrossingIndex> index(new ZeroCrossingIndex());
+    const int blockLength = (int)juce::jmin<int64>(numSamples, readBlockSamples);
+    std::vector<float> mono((size_t)blockLength);
+    std::vector<float> frames((size_t)blockLength);
+
+    float previous = 0.0f;
+    int64 bucket = -1;
+    int64 bestPosition = -1;
+    float bestStep = 0.0f;
+
+    for (int64 start = 0; start < numSamples; start += readBlockSamples)
+    {
+        const int count = (int)juce::jmin<int64>(readBlockSamples, numSamples - start);
+        readMono(numChannels, start, count, read, mono, frames);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const int64 position = start + i;
+            const float current = mono[(size_t)i];
+            if (position > 0 && crossesZero(previous, current))
+            {
+                const float step = std::abs(previous) + std::abs(current);
+                const int64 nearer = nearerFrame(position, previous, current);
+                if (nearer / bucketSize != bucket)
+                {
+                    if (bestPosition >= 0)
+                        index->crossings.push_back(bestPosition);
+                    bucket = nearer / bucketSize;
+                    bestPosition = nearer;
+                    bestStep = step;
+                }
+                else if (step < bestStep)
+                {
+                    bestPosition = nearer;
+                    bestStep = step;
+                }
+            }
+            previous = current;
+        }
+    }
+
+    if (bestPosition >= 0)
+        index->crossings.push_back(bestPosition);
+    index->crossings.shrink_to_fit();
+    return index;
+}
+
+int64 ZeroCrossingIndex::snap(int64 position, int64 maxDistance) const
+{
+    const auto after = std::lower_bound(crossings.begin(), crossings.end(), position);
+    int64 best = position;
+    int64 bestDistance = maxDistance + 1;
+    if (after != crossings.end() && *after - position < bestDistance)
+    {
+        best = *after;
+        bestDistance = *after - position;
+    }
+    if (after != crossings.begin() && position - *(after - 1) < bestDistance)
+        best = *(after - 1);
+    return best;
+}
+
+int64 ZeroCrossingIndex::scan(int numChannels, int64 numSamples, const SamplePeaks::ReadFunction& read,
+                              int64 position, int64 maxDistance)
+{
+    if (numChannels <= 0 || numSamples <= 0 || maxDistance <= 0)
+        return position;
+
+    // One frame more on the left, so a crossing into the first frame of the range is seen.
+    const int64 start = juce::jmax<int64>(0, position - maxDistance - 1);
+    const int64 end = juce::jmin(numSamples, position + maxDistance + 1);
+    if (end - start < 2 || end - start > readBlockSamples)
+        return position;
+
+    const int count = (int)(end - start);
+    std::vector<float> mono((size_t)count);
+    std::vector<float> frames((size_t)count);
+    readMono(numChannels, start, count, read, mono, frames);
+
+    int64 best = position;
+    int64 bestDistance = maxDistance + 1;
+    for (int i = 1; i < count; ++i)
+    {
+        const float previous = mono[(size_t)(i - 1)];
+        const float current = mono[(size_t)i];
+        if (!crossesZero(previous, current))
+            continue;
+
+        const int64 nearer = nearerFrame(start + i, previous, current);
+        const int64 distance = std::abs(nearer - position);
+        if (distance < bestDistance)
+        {
+            best = nearer;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
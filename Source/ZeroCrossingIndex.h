@@ -0,0 +1,40 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "SamplePeaks.h"
+
+// Sorted positions where a sample's audio crosses zero, so a cut can be moved to the
+// nearest quiet point with a binary search instead of a scan. The channels are mixed to
+// mono first, and of the crossings in each run of bucketSize frames only the gentlest one
+// (the smallest step across zero) is kept, which bounds the index for noisy audio.
+class ZeroCrossingIndex
+{
+public:
+    static constexpr int bucketSize = 32;
+    // How far a cut may move to reach a crossing: about a period of 200 Hz, short enough
+    // not to be heard as a timing change.
+    static constexpr double snapSeconds = 0.005;
+
+    static std::unique_ptr<ZeroCrossingIndex> build(int numChannels, int64 numSamples, const SamplePeaks::ReadFunction& read);
+
+    // The crossing nearest to position no more than maxDistance frames away, or position
+    // itself when there is none.
+    int64 snap(int64 position, int64 maxDistance) const;
+
+    // The same, for audio that has no index yet: reads and scans only the frames within
+    // maxDistance of position.
+    static int64 scan(int numChannels, int64 numSamples, const SamplePeaks::ReadFunction& read,
+                      int64 position, int64 maxDistance);
+
+    int getNumCrossings() const { return (int)crossings.size(); }
+    int64 getMemoryUsageBytes() const { return (int64)(crossings.capacity() * sizeof(int64)); }
+
+private:
+    ZeroCrossingIndex() = default;
+
+    std::vector<int64> crossings;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ZeroCrossingIndex)
+};